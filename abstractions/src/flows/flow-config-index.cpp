@@ -0,0 +1,39 @@
+#include "edgelink/edgelink.hpp"
+
+namespace edgelink {
+
+FlowConfigIndex::FlowConfigIndex(const JsonArray& flows_config) {
+    _by_id.reserve(flows_config.size());
+    for (const auto& elem_value : flows_config) {
+        const auto& elem = elem_value.as_object();
+        const std::string_view elem_type = elem.at("type").as_string();
+        const std::string_view elem_id = elem.at("id").as_string();
+        _by_id.insert_or_assign(elem_id, &elem);
+
+        if (elem_type == "tab" || elem_type == "flow") {
+            _flows.push_back(&elem);
+        } else if (auto z = elem.if_contains("z")) {
+            // 注释不参与流程的构建
+            if (elem_type != "comment") {
+                _by_flow[z->as_string()].push_back(&elem);
+            }
+        } else {
+            _global_nodes.push_back(&elem);
+        }
+    }
+}
+
+std::span<const JsonObject* const> FlowConfigIndex::flow_elements(const std::string_view flow_id) const {
+    auto it = _by_flow.find(flow_id);
+    if (it == _by_flow.end()) {
+        return {};
+    }
+    return it->second;
+}
+
+const JsonObject* FlowConfigIndex::find(const std::string_view id) const {
+    auto it = _by_id.find(id);
+    return it != _by_id.end() ? it->second : nullptr;
+}
+
+}; // namespace edgelink
@@ -0,0 +1,156 @@
+#include "edgelink/edgelink.hpp"
+
+namespace asio = boost::asio;
+
+namespace edgelink {
+
+OverflowPolicy parse_overflow_policy(const std::string_view text) {
+    if (text == "block") {
+        return OverflowPolicy::BLOCK;
+    } else if (text == "drop-oldest") {
+        return OverflowPolicy::DROP_OLDEST;
+    } else if (text == "drop-newest") {
+        return OverflowPolicy::DROP_NEWEST;
+    } else {
+        throw InvalidDataException(fmt::format("不支持的邮箱溢出策略：'{0}'", text));
+    }
+}
+
+Mailbox::Mailbox(const MailboxOptions& options) : _overflow(options.overflow), _queue(options.capacity) {}
+
+Awaitable<bool> Mailbox::async_push(Envelope&& envelope) {
+    if (_overflow != OverflowPolicy::BLOCK) {
+        co_return this->try_push(std::move(envelope));
+    }
+
+    for (;;) {
+        if (this->is_closed()) {
+            co_return false;
+        }
+
+        if (_queue.try_push(envelope)) {
+            this->notify(_consumers_waiting, _consumer_waiters);
+            co_return true;
+        }
+
+        co_await this->async_wait_not_full();
+    }
+}
+
+bool Mailbox::try_push(Envelope&& envelope) {
+    for (;;) {
+        if (this->is_closed()) {
+            return false;
+        }
+
+        if (_queue.try_push(envelope)) {
+            this->notify(_consumers_waiting, _consumer_waiters);
+            return true;
+        }
+
+        if (_overflow != OverflowPolicy::DROP_OLDEST) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if (_queue.try_pop()) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            this->notify(_producers_waiting, _producer_waiters);
+        }
+    }
+}
+
+std::optional<Envelope> Mailbox::try_pop() {
+    auto envelope = _queue.try_pop();
+    if (envelope) {
+        this->notify(_producers_waiting, _producer_waiters);
+    }
+    return envelope;
+}
+
+Awaitable<std::optional<Envelope>> Mailbox::async_pop() {
+    for (;;) {
+        if (auto envelope = _queue.try_pop()) {
+            this->notify(_producers_waiting, _producer_waiters);
+            co_return envelope;
+        }
+        if (this->is_closed()) {
+            co_return std::nullopt;
+        }
+        co_await this->async_wait_not_empty();
+    }
+}
+
+void Mailbox::close() {
+    _closed.store(true, std::memory_order_release);
+
+    std::deque<Waiter> waiters;
+    {
+        std::lock_guard lock(_mutex);
+        waiters.swap(_producer_waiters);
+        for (auto& w : _consumer_waiters) {
+            waiters.emplace_back(std::move(w));
+        }
+        _consumer_waiters.clear();
+        _producers_waiting.store(0);
+        _consumers_waiting.store(0);
+    }
+    for (auto& w : waiters) {
+        asio::post(std::move(w));
+    }
+}
+
+Awaitable<void> Mailbox::async_wait_not_full() {
+    co_await asio::async_initiate<decltype(asio::use_awaitable), void()>(
+        [this](Waiter handler) {
+            std::unique_lock lock(_mutex);
+            _producers_waiting.fetch_add(1);
+            // 登记以后再检查一次，避免在检查和登记之间错过消费者的通知
+            if (_queue.size_approx() < _queue.capacity() || this->is_closed()) {
+                _producers_waiting.fetch_sub(1);
+                lock.unlock();
+                asio::post(std::move(handler));
+                return;
+            }
+            _producer_waiters.emplace_back(std::move(handler));
+        },
+        asio::use_awaitable);
+}
+
+Awaitable<void> Mailbox::async_wait_not_empty() {
+    co_await asio::async_initiate<decltype(asio::use_awaitable), void()>(
+        [this](Waiter handler) {
+            std::unique_lock lock(_mutex);
+            _consumers_waiting.fetch_add(1);
+            if (_queue.size_approx() > 0 || this->is_closed()) {
+                _consumers_waiting.fetch_sub(1);
+                lock.unlock();
+                asio::post(std::move(handler));
+                return;
+            }
+            _consumer_waiters.emplace_back(std::move(handler));
+        },
+        asio::use_awaitable);
+}
+
+void Mailbox::notify(std::atomic<size_t>& waiting, std::deque<Waiter>& waiters) {
+    // 与等待方登记后的再次检查配对：先让队列的修改可见，再看有没有等待者
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    Waiter waiter;
+    {
+        std::lock_guard lock(_mutex);
+        if (waiters.empty()) {
+            return;
+        }
+        waiter = std::move(waiters.front());
+        waiters.pop_front();
+        waiting.fetch_sub(1);
+    }
+    asio::post(std::move(waiter));
+}
+
+}; // namespace edgelink
@@ -0,0 +1,216 @@
+#include "edgelink/edgelink.hpp"
+
+namespace edgelink {
+
+namespace {
+
+/// @brief 每个线程第一次记录指标时分配一个分片号
+size_t this_thread_shard() {
+    static std::atomic<size_t> next_shard = 0;
+    thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % NodeMetrics::SHARD_COUNT;
+    return shard;
+}
+
+}; // namespace
+
+size_t LatencyHistogram::bucket_index(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return static_cast<size_t>(value);
+    }
+    unsigned exponent = std::bit_width(value) - 1;
+    if (exponent > MAX_EXPONENT) {
+        return BUCKET_COUNT - 1;
+    }
+    unsigned shift = exponent - SUB_BUCKET_BITS;
+    size_t sub = static_cast<size_t>((value >> shift) & (SUB_BUCKET_COUNT - 1));
+    return (shift + 1) * SUB_BUCKET_COUNT + sub;
+}
+
+uint64_t LatencyHistogram::bucket_lower_bound(size_t index) {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    size_t shift = index / SUB_BUCKET_COUNT - 1;
+    size_t sub = index % SUB_BUCKET_COUNT;
+    return (SUB_BUCKET_COUNT + sub) << shift;
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+    _buckets[bucket_index(ns)].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(ns, std::memory_order_relaxed);
+
+    auto current_max = _max.load(std::memory_order_relaxed);
+    while (ns > current_max && !_max.compare_exchange_weak(current_max, ns, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        if (auto n = other._buckets[i].load(std::memory_order_relaxed)) {
+            _buckets[i].fetch_add(n, std::memory_order_relaxed);
+        }
+    }
+    _count.fetch_add(other.count(), std::memory_order_relaxed);
+    _sum.fetch_add(other._sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    auto const other_max = other.max();
+    auto current_max = _max.load(std::memory_order_relaxed);
+    while (other_max > current_max && !_max.compare_exchange_weak(current_max, other_max, std::memory_order_relaxed)) {
+    }
+}
+
+double LatencyHistogram::mean() const {
+    auto n = this->count();
+    return n == 0 ? 0.0 : static_cast<double>(_sum.load(std::memory_order_relaxed)) / static_cast<double>(n);
+}
+
+uint64_t LatencyHistogram::percentile(double q) const {
+    // 各个桶是分别读取的，并发记录的时候总数可能和 `_count` 对不上，以桶的合计为准
+    std::array<uint64_t, BUCKET_COUNT> counts;
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        counts[i] = _buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    auto rank = static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(total)));
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return std::min(bucket_upper_bound(i), this->max());
+        }
+    }
+    return this->max();
+}
+
+JsonObject NodeMetricsSnapshot::to_json() const {
+    JsonObject latency{
+        {"count", latency_count},       {"mean_ns", latency_mean_ns}, {"p50_ns", latency_p50_ns},
+        {"p90_ns", latency_p90_ns},     {"p99_ns", latency_p99_ns},   {"max_ns", latency_max_ns},
+    };
+    return JsonObject{
+        {"id", node_id},   {"type", node_type},   {"flow", flow_id},           {"in", msgs_in},
+        {"out", msgs_out}, {"dropped", dropped}, {"errors", errors},           {"queueDepth", queue_depth},
+        {"latency", std::move(latency)},
+    };
+}
+
+NodeMetrics::NodeMetrics(std::string node_id, std::string node_type, std::string flow_id)
+    : _node_id(std::move(node_id)), _node_type(std::move(node_type)), _flow_id(std::move(flow_id)) {}
+
+NodeMetrics::Shard& NodeMetrics::shard() { return _shards[this_thread_shard()]; }
+
+void NodeMetrics::set_mailbox(const Mailbox* mailbox) {
+    std::lock_guard lock(_mailbox_mutex);
+    _mailbox = mailbox;
+}
+
+NodeMetricsSnapshot NodeMetrics::snapshot() const {
+    NodeMetricsSnapshot snap{
+        .node_id = _node_id,
+        .node_type = _node_type,
+        .flow_id = _flow_id,
+    };
+    for (auto const& shard : _shards) {
+        snap.msgs_in += shard.msgs_in.load(std::memory_order_relaxed);
+        snap.msgs_out += shard.msgs_out.load(std::memory_order_relaxed);
+        snap.dropped += shard.dropped.load(std::memory_order_relaxed);
+        snap.errors += shard.errors.load(std::memory_order_relaxed);
+    }
+    {
+        // 持有锁读取邮箱，流程在销毁邮箱之前清空指针时会等这里读完
+        std::lock_guard lock(_mailbox_mutex);
+        if (_mailbox) {
+            snap.queue_depth = _mailbox->depth();
+            snap.dropped += _mailbox->dropped_count();
+        }
+    }
+    snap.latency_count = _latency.count();
+    snap.latency_mean_ns = _latency.mean();
+    snap.latency_p50_ns = _latency.percentile(0.50);
+    snap.latency_p90_ns = _latency.percentile(0.90);
+    snap.latency_p99_ns = _latency.percentile(0.99);
+    snap.latency_max_ns = _latency.max();
+    return snap;
+}
+
+std::shared_ptr<NodeMetrics> MetricsRegistry::get_or_create(const std::string_view node_id,
+                                                            const std::string_view node_type,
+                                                            const std::string_view flow_id) {
+    std::lock_guard lock(_mutex);
+    auto it = _nodes.find(node_id);
+    if (it == _nodes.end()) {
+        auto metrics = std::make_shared<NodeMetrics>(std::string(node_id), std::string(node_type),
+                                                     std::string(flow_id));
+        it = _nodes.emplace(std::string(node_id), std::move(metrics)).first;
+    }
+    return it->second;
+}
+
+void MetricsRegistry::remove(const NodeMetrics& metrics) {
+    std::lock_guard lock(_mutex);
+    auto it = _nodes.find(metrics.node_id());
+    if (it != _nodes.end() && it->second.get() == &metrics) {
+        _nodes.erase(it);
+    }
+}
+
+std::optional<NodeMetricsSnapshot> MetricsRegistry::query(const std::string_view node_id) const {
+    std::shared_ptr<NodeMetrics> metrics;
+    {
+        std::lock_guard lock(_mutex);
+        auto it = _nodes.find(node_id);
+        if (it == _nodes.end()) {
+            return std::nullopt;
+        }
+        metrics = it->second;
+    }
+    return metrics->snapshot();
+}
+
+std::vector<NodeMetricsSnapshot> MetricsRegistry::query_all() const {
+    std::vector<std::shared_ptr<NodeMetrics>> nodes;
+    {
+        std::lock_guard lock(_mutex);
+        nodes.reserve(_nodes.size());
+        for (auto const& [_, metrics] : _nodes) {
+            nodes.push_back(metrics);
+        }
+    }
+
+    std::vector<NodeMetricsSnapshot> snapshots;
+    snapshots.reserve(nodes.size());
+    for (auto const& metrics : nodes) {
+        snapshots.emplace_back(metrics->snapshot());
+    }
+    return snapshots;
+}
+
+JsonArray MetricsRegistry::to_json() const {
+    JsonArray array;
+    for (auto const& snap : this->query_all()) {
+        array.emplace_back(snap.to_json());
+    }
+    return array;
+}
+
+void MetricsRegistry::dump(const std::filesystem::path& path) const {
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw IOException(fmt::format("无法写入指标文件：'{0}'", tmp_path.string()));
+        }
+        file << boost::json::serialize(this->to_json());
+    }
+    std::filesystem::rename(tmp_path, path);
+}
+
+}; // namespace edgelink
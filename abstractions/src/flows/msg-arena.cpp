@@ -0,0 +1,148 @@
+#include "edgelink/edgelink.hpp"
+
+namespace edgelink {
+
+/// @brief 一块可重复使用的 arena 内存
+struct MsgArena {
+    explicit MsgArena(size_t size) : buffer(new unsigned char[size]), capacity(size) {}
+
+    std::unique_ptr<unsigned char[]> buffer;
+    size_t capacity;
+};
+
+/// @brief 消息对 arena 的租约，作为消息的 `boost::json` 存储
+///
+/// 所有分配都在 arena 里顺序进行，释放是空操作；租约本身销毁时（也就是消息的最后一个 JSON 值释放时）
+/// 整块 arena 归还到池里
+class MsgArenaLease final : public boost::json::memory_resource {
+  public:
+    MsgArenaLease(std::shared_ptr<MsgArenaPool> pool, MsgArena* arena, std::shared_ptr<MsgArenaHistogram> histogram)
+        : _pool(std::move(pool)), _arena(arena), _histogram(std::move(histogram)),
+          _resource(arena->buffer.get(), arena->capacity) {}
+
+    ~MsgArenaLease() {
+        if (_histogram) {
+            _histogram->record(_used);
+        }
+        _resource.release();
+        _pool->give_back(_arena);
+    }
+
+  private:
+    void* do_allocate(std::size_t n, std::size_t align) override {
+        _used += n;
+        return _resource.allocate(n, align);
+    }
+
+    void do_deallocate(void*, std::size_t, std::size_t) override {
+        // 不逐个释放，租约结束时整块回收
+    }
+
+    bool do_is_equal(const boost::json::memory_resource& mr) const noexcept override { return this == &mr; }
+
+  private:
+    std::shared_ptr<MsgArenaPool> _pool;
+    MsgArena* _arena;
+    std::shared_ptr<MsgArenaHistogram> _histogram;
+    boost::json::monotonic_resource _resource;
+    size_t _used = 0;
+};
+
+}; // namespace edgelink
+
+namespace boost::json {
+
+// 释放是空操作，容器析构的时候可以跳过逐个节点的释放
+template <> struct is_deallocate_trivial<edgelink::MsgArenaLease> : std::true_type {};
+
+}; // namespace boost::json
+
+namespace edgelink {
+
+namespace {
+
+inline size_t bucket_of(size_t bytes) {
+    size_t bucket = 0;
+    size_t upper = MsgArenaHistogram::MIN_SIZE;
+    while (upper < bytes && bucket < MsgArenaHistogram::BUCKET_COUNT - 1) {
+        upper <<= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+/// @brief 直方图每记录这么多次才重新计算一次建议值
+constexpr uint64_t SUGGESTION_INTERVAL = 64;
+
+}; // namespace
+
+void MsgArenaHistogram::record(size_t bytes) {
+    _buckets[bucket_of(bytes)].fetch_add(1, std::memory_order_relaxed);
+    if ((_count.fetch_add(1, std::memory_order_relaxed) + 1) % SUGGESTION_INTERVAL == 0) {
+        this->update_suggestion();
+    }
+}
+
+void MsgArenaHistogram::update_suggestion() {
+    std::array<uint64_t, BUCKET_COUNT> snapshot;
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        snapshot[i] = _buckets[i].load(std::memory_order_relaxed);
+        total += snapshot[i];
+    }
+    if (total == 0) {
+        return;
+    }
+
+    // 取第 90 百分位所在的桶的上界
+    const uint64_t threshold = total - total / 10;
+    uint64_t accumulated = 0;
+    size_t size = MIN_SIZE;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        accumulated += snapshot[i];
+        if (accumulated >= threshold) {
+            break;
+        }
+        size <<= 1;
+    }
+    _suggested_size.store(size, std::memory_order_relaxed);
+}
+
+MsgArenaPool::MsgArenaPool(size_t max_pooled) : _free_list(max_pooled) {}
+
+MsgArenaPool::~MsgArenaPool() {
+    MsgArena* arena = nullptr;
+    while (_free_list.pop(arena)) {
+        delete arena;
+    }
+}
+
+boost::json::storage_ptr MsgArenaPool::acquire(std::shared_ptr<MsgArenaHistogram> histogram) {
+    auto size = histogram ? histogram->suggest_size() : MsgArenaHistogram::DEFAULT_SIZE;
+    auto arena = this->rent(size);
+    return boost::json::make_shared_resource<MsgArenaLease>(this->shared_from_this(), arena, std::move(histogram));
+}
+
+MsgArena* MsgArenaPool::rent(size_t size) {
+    MsgArena* arena = nullptr;
+    if (_free_list.pop(arena)) {
+        _pooled_count.fetch_sub(1, std::memory_order_relaxed);
+        if (arena->capacity >= size) {
+            return arena;
+        }
+        // 太小了，换一块符合当前统计的
+        delete arena;
+    }
+    return new MsgArena(size);
+}
+
+void MsgArenaPool::give_back(MsgArena* arena) {
+    // 池子满了就直接释放，`bounded_push` 不会分配新的链表节点
+    if (_free_list.bounded_push(arena)) {
+        _pooled_count.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        delete arena;
+    }
+}
+
+}; // namespace edgelink
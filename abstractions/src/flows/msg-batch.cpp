@@ -0,0 +1,78 @@
+#include "edgelink/edgelink.hpp"
+
+namespace edgelink {
+
+void MsgBatch::reserve(size_t n) {
+    _payloads.reserve(n);
+    _topic_ids.reserve(n);
+}
+
+void MsgBatch::push_back(double payload, std::optional<std::string_view> topic, uint32_t time_offset) {
+    if (time_offset != 0 && _time_offsets.empty()) {
+        _time_offsets.resize(_payloads.size(), 0);
+    }
+    _payloads.push_back(payload);
+    _topic_ids.push_back(topic ? this->intern_topic(*topic) : NO_TOPIC);
+    if (!_time_offsets.empty()) {
+        _time_offsets.push_back(time_offset);
+    }
+}
+
+std::optional<std::string_view> MsgBatch::topic_at(size_t index) const {
+    auto id = _topic_ids.at(index);
+    if (id == NO_TOPIC) {
+        return std::nullopt;
+    }
+    return std::string_view(_topics[id]);
+}
+
+int64_t MsgBatch::timestamp_at(size_t index) const {
+    if (index >= _payloads.size()) {
+        throw std::out_of_range("批量消息的下标越界");
+    }
+    return _time_offsets.empty() ? _timestamp : _timestamp + _time_offsets[index];
+}
+
+uint32_t MsgBatch::intern_topic(const std::string_view topic) {
+    if (auto it = _topic_index.find(topic); it != _topic_index.end()) {
+        return it->second;
+    }
+    auto id = static_cast<uint32_t>(_topics.size());
+    _topics.emplace_back(topic);
+    _topic_index.emplace(_topics.back(), id);
+    return id;
+}
+
+MsgPtr MsgBatch::to_msg(size_t index, IFlowNode* birth_place) const {
+    auto msg = std::make_shared<Msg>(birth_place);
+    msg->set_payload(JsonValue(_payloads.at(index)));
+    if (auto topic = this->topic_at(index)) {
+        msg->set_topic(*topic);
+    }
+    msg->insert_or_assign("timestamp", JsonValue(this->timestamp_at(index)));
+    return msg;
+}
+
+JsonObject MsgBatch::to_json() const {
+    JsonArray payloads(_payloads.begin(), _payloads.end());
+    JsonArray topics;
+    topics.reserve(_topic_ids.size());
+    for (size_t i = 0; i < _topic_ids.size(); i++) {
+        if (auto topic = this->topic_at(i)) {
+            topics.emplace_back(*topic);
+        } else {
+            topics.emplace_back(nullptr);
+        }
+    }
+    JsonObject json{
+        {"timestamp", _timestamp},
+        {"payload", std::move(payloads)},
+        {"topic", std::move(topics)},
+    };
+    if (!_time_offsets.empty()) {
+        json.emplace("timeOffset", JsonArray(_time_offsets.begin(), _time_offsets.end()));
+    }
+    return json;
+}
+
+}; // namespace edgelink
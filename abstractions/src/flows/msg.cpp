@@ -2,40 +2,402 @@
 
 namespace edgelink {
 
+namespace {
+
+/// @brief 有独立存储位置的属性
+enum class MsgSlot {
+    ID,
+    PAYLOAD,
+    TOPIC,
+    OTHER,
+};
+
+inline MsgSlot slot_of(const std::string_view prop) {
+    if (prop == "payload") {
+        return MsgSlot::PAYLOAD;
+    } else if (prop == "topic") {
+        return MsgSlot::TOPIC;
+    } else if (prop == "_msgid") {
+        return MsgSlot::ID;
+    } else {
+        return MsgSlot::OTHER;
+    }
+}
+
+inline auto find_prop(MsgBody& body, const std::string_view prop) {
+    return std::find_if(body.props.begin(), body.props.end(), [prop](const MsgProperty& p) { return p.key == prop; });
+}
+
+inline auto find_prop(const MsgBody& body, const std::string_view prop) {
+    return std::find_if(body.props.cbegin(), body.props.cend(),
+                        [prop](const MsgProperty& p) { return p.key == prop; });
+}
+
+/// @brief 确保属性值为本消息独占，并且位于本消息自己的存储里
+///
+/// arena 不是线程安全的，只能由创建它的消息写入；克隆出来的消息即使独占了某个值，
+/// 只要它还在原消息的 arena 里，也要先复制出来再修改
+inline JsonValue& detach_value(std::shared_ptr<JsonValue>& value, const boost::json::storage_ptr& storage) {
+    if (value.use_count() > 1 || value->storage().get() != storage.get()) {
+        value = std::make_shared<JsonValue>(*value, storage);
+    }
+    return *value;
+}
+
+[[noreturn]] void throw_prop_not_found(const std::string_view prop) {
+    throw std::out_of_range(fmt::format("消息中找不到属性：'{0}'", prop));
+}
+
+}; // namespace
+
+MsgBuffer::MsgBuffer(Bytes&& bytes) {
+    auto owner = std::make_shared<const Bytes>(std::move(bytes));
+    _view = std::span<const uint8_t>(owner->data(), owner->size());
+    _owner = std::move(owner);
+    _json_cache = std::make_shared<JsonCache>();
+}
+
+const JsonValue& MsgBuffer::as_json() const {
+    std::call_once(_json_cache->once, [this] {
+        JsonArray bytes;
+        bytes.reserve(_view.size());
+        for (auto b : _view) {
+            bytes.emplace_back(static_cast<uint64_t>(b));
+        }
+        _json_cache->json = std::move(bytes);
+    });
+    return _json_cache->json;
+}
+
+Msg::Msg(MsgID id, IFlowNode* birth_place)
+    : _birth_place(birth_place), _id(id), _id_value(id), _body(std::make_shared<MsgBody>()) {
+    _body->payload = std::make_shared<JsonValue>(nullptr);
+}
+
+Msg::Msg(boost::json::storage_ptr storage, IFlowNode* birth_place)
+    : _birth_place(birth_place), _id(Msg::generate_msg_id()), _id_value(_id), _storage(std::move(storage)),
+      _body(std::make_shared<MsgBody>()) {
+    _body->payload = std::make_shared<JsonValue>(nullptr, _storage);
+}
+
+Msg::Msg(JsonObject const& data, IFlowNode* birth_place)
+    : _birth_place(birth_place), _id(0), _body(std::make_shared<MsgBody>()) {
+    bool has_id = false;
+    for (auto const& kv : data) {
+        if (kv.key() == "_msgid") {
+            // Node-RED 的消息 ID 是字符串，这种情况下重新生成一个
+            if (kv.value().is_number()) {
+                this->set_id(kv.value().to_number<MsgID>());
+                has_id = true;
+            }
+        } else {
+            this->assign_json_property(kv.key(), JsonValue(kv.value()));
+        }
+    }
+    if (!has_id) {
+        this->set_id(generate_msg_id());
+    }
+}
+
+Msg::Msg(JsonObject&& data, IFlowNode* birth_place)
+    : _birth_place(birth_place), _id(0), _storage(data.storage()), _body(std::make_shared<MsgBody>()) {
+    bool has_id = false;
+    for (auto& kv : data) {
+        if (kv.key() == "_msgid") {
+            // Node-RED 的消息 ID 是字符串，这种情况下重新生成一个
+            if (kv.value().is_number()) {
+                this->set_id(kv.value().to_number<MsgID>());
+                has_id = true;
+            }
+        } else {
+            this->assign_json_property(kv.key(), std::move(kv.value()));
+        }
+    }
+    if (!has_id) {
+        this->set_id(generate_msg_id());
+    }
+}
+
+JsonObject Msg::to_json() const {
+    JsonObject obj;
+    obj.reserve(_body->props.size() + 3);
+    this->for_each([&obj](std::string_view key, const JsonValue& value) { obj.emplace(key, value); });
+    return obj;
+}
+
+const std::string Msg::to_string() const {
+    // 直接逐个属性序列化，避免先展开成 JsonObject
+    std::string result("{");
+    result.append(fmt::format("\"_msgid\":{0}", _id));
+    if (auto buffer = this->payload_buffer()) {
+        // 二进制负载直接输出为字节数组，不需要生成 JSON
+        result.append(",\"payload\":[");
+        for (size_t i = 0; i < buffer->size(); i++) {
+            if (i > 0) {
+                result.push_back(',');
+            }
+            result.append(std::to_string(buffer->data()[i]));
+        }
+        result.push_back(']');
+    } else if (_body->payload) {
+        result.append(",\"payload\":");
+        result.append(boost::json::serialize(*_body->payload));
+    }
+    if (_body->topic) {
+        result.append(",\"topic\":");
+        result.append(boost::json::serialize(*_body->topic));
+    }
+    for (auto const& p : _body->props) {
+        result.push_back(',');
+        result.append(boost::json::serialize(boost::json::string_view(p.key)));
+        result.push_back(':');
+        result.append(boost::json::serialize(*p.value));
+    }
+    result.push_back('}');
+    return result;
+}
+
 std::shared_ptr<Msg> Msg::clone(bool new_id) const {
     //? 是否要重新生成消息 ID?
-    auto new_json = JsonObject(_data);
-    auto msg = std::make_shared<Msg>(std::move(new_json), _birth_place);
-    if (new_id) {
-        msg->set_id(generate_msg_id());
+    // 只共享消息体，真正的复制推迟到写入的时候
+    // 克隆不共享原消息的 arena：克隆可能在其他线程上被修改，它写入的值使用默认的堆存储
+    auto id = new_id ? generate_msg_id() : _id;
+    return std::shared_ptr<Msg>(new Msg(id, _body, _birth_place));
+}
+
+void Msg::set_topic(const std::string_view topic) {
+    this->detach_body().topic = std::make_shared<JsonValue>(JsonString(topic, _storage));
+}
+
+JsonValue const& Msg::payload() const& {
+    if (_body->payload_buffer) {
+        return _body->payload_buffer->as_json();
+    } else if (_body->payload) {
+        return *_body->payload;
+    }
+    throw_prop_not_found("payload");
+}
+
+JsonValue& Msg::payload() & {
+    auto& body = this->detach_body();
+    if (body.payload_buffer) {
+        // 要修改二进制负载，只能先把它转换成 JSON
+        body.payload = std::make_shared<JsonValue>(body.payload_buffer->as_json(), _storage);
+        body.payload_buffer.reset();
+    } else if (!body.payload) {
+        throw_prop_not_found("payload");
     }
-    return msg;
+    return detach_value(body.payload, _storage);
 }
 
-void Msg::set_id(MsgID new_id) { this->insert_or_assign("_msgid", new_id); }
+void Msg::set_payload(JsonValue&& value) {
+    auto& body = this->detach_body();
+    body.payload = std::make_shared<JsonValue>(std::move(value), _storage);
+    body.payload_buffer.reset();
+}
+
+void Msg::set_payload(MsgBuffer buffer) {
+    auto& body = this->detach_body();
+    body.payload.reset();
+    body.payload_buffer = std::move(buffer);
+}
+
+void Msg::set_payload(const MsgValue& value) {
+    switch (kind(value)) {
+    case MsgValueKind::NULLPTR:
+        this->set_payload(JsonValue(nullptr));
+        break;
+    case MsgValueKind::DOUBLE:
+        this->set_payload(JsonValue(boost::get<double>(value)));
+        break;
+    case MsgValueKind::INT64:
+        this->set_payload(JsonValue(boost::get<int64_t>(value)));
+        break;
+    case MsgValueKind::BOOL:
+        this->set_payload(JsonValue(boost::get<bool>(value)));
+        break;
+    case MsgValueKind::STRING:
+        this->set_payload(JsonValue(JsonString(boost::get<std::string>(value))));
+        break;
+    case MsgValueKind::BUFFER:
+        this->set_payload(boost::get<MsgBuffer>(value));
+        break;
+    }
+}
+
+const JsonValue* Msg::if_contains(const std::string_view prop) const {
+    switch (slot_of(prop)) {
+    case MsgSlot::ID:
+        return &_id_value;
+    case MsgSlot::PAYLOAD:
+        return this->has_payload() ? &this->payload() : nullptr;
+    case MsgSlot::TOPIC:
+        return _body->topic.get();
+    default: {
+        auto it = find_prop(*_body, prop);
+        return it != _body->props.cend() ? it->value.get() : nullptr;
+    }
+    }
+}
+
+JsonValue const& Msg::at(const std::string_view prop) const& {
+    if (auto value = this->if_contains(prop)) {
+        return *value;
+    }
+    throw_prop_not_found(prop);
+}
+
+JsonValue& Msg::at(const std::string_view prop) & { return this->detach_property(prop); }
+
+void Msg::insert_or_assign(const std::string_view prop, JsonValue&& value) {
+    if (slot_of(prop) == MsgSlot::ID) {
+        this->set_id(value.to_number<MsgID>());
+    } else {
+        this->detach_body();
+        this->assign_json_property(prop, std::move(value));
+    }
+}
+
+bool Msg::erase(const std::string_view prop) {
+    if (!this->contains(prop)) {
+        return false;
+    }
+    auto& body = this->detach_body();
+    switch (slot_of(prop)) {
+    case MsgSlot::ID:
+        throw InvalidDataException("不能删除消息的 '_msgid' 属性");
+    case MsgSlot::PAYLOAD:
+        body.payload.reset();
+        body.payload_buffer.reset();
+        break;
+    case MsgSlot::TOPIC:
+        body.topic.reset();
+        break;
+    default:
+        body.props.erase(find_prop(body, prop));
+        break;
+    }
+    return true;
+}
+
+JsonValue const& Msg::at_propex(const propex::PropertyPath& path) const& {
+    const JsonValue* presult = &this->at(path.root());
+    for (size_t i = 1; i < path.size(); i++) {
+        const auto& seg = path[i];
+        if (propex::kind(seg) == propex::PropertySegmentKind::IDENTIFIER) {
+            presult = &(presult->at(std::get<std::string>(seg)));
+        } else {
+            presult = &(presult->at(std::get<size_t>(seg)));
+        }
+    }
+    return *presult;
+}
 
-JsonValue const& Msg::at_propex(const std::string_view propex) const& {
-    auto prop_segs = propex::parse(propex);
-    const JsonValue* presult = nullptr;
-    for (size_t i = 0; i < prop_segs.size(); i++) {
-        const auto& ps = prop_segs[i];
-        if (i == 0) {
-            if (propex::kind(ps) != propex::PropertySegmentKind::IDENTIFIER) {
-                throw InvalidDataException("Bad propex");
+JsonValue& Msg::at_propex(const propex::PropertyPath& path) & {
+    // 只复制表达式经过的那个顶层属性，其他属性仍然共享
+    JsonValue* presult = &this->detach_property(path.root());
+    for (size_t i = 1; i < path.size(); i++) {
+        const auto& seg = path[i];
+        if (propex::kind(seg) == propex::PropertySegmentKind::IDENTIFIER) {
+            presult = &(presult->at(std::get<std::string>(seg)));
+        } else {
+            presult = &(presult->at(std::get<size_t>(seg)));
+        }
+    }
+    return *presult;
+}
+
+void Msg::set_propex(const propex::PropertyPath& path, JsonValue&& value) {
+    if (path.size() == 1) {
+        this->insert_or_assign(path.root(), std::move(value));
+        return;
+    }
+
+    if (!this->contains(path.root())) {
+        this->insert_or_assign(path.root(), JsonValue());
+    }
+
+    JsonValue* pcurrent = &this->detach_property(path.root());
+    for (size_t i = 1; i < path.size(); i++) {
+        const auto& seg = path[i];
+        if (propex::kind(seg) == propex::PropertySegmentKind::IDENTIFIER) {
+            if (pcurrent->is_null()) {
+                pcurrent->emplace_object();
+            } else if (!pcurrent->is_object()) {
+                throw InvalidDataException(fmt::format("属性表达式 '{0}' 的中间值不是对象", path.expr()));
             }
-            std::string key(std::get<std::string_view>(ps));
-            presult = &_data.at(std::get<std::string_view>(ps));
+            pcurrent = &pcurrent->get_object()[std::get<std::string>(seg)];
         } else {
-            if (propex::kind(ps) == propex::PropertySegmentKind::IDENTIFIER) {
-                std::string key(std::get<std::string_view>(ps));
-                presult = &(presult->at(key));
-            } else {
-                auto index = std::get<size_t>(ps);
-                presult = &(presult->at(index));
+            if (pcurrent->is_null()) {
+                pcurrent->emplace_array();
+            } else if (!pcurrent->is_array()) {
+                throw InvalidDataException(fmt::format("属性表达式 '{0}' 的中间值不是数组", path.expr()));
+            }
+            auto& array = pcurrent->get_array();
+            auto index = std::get<size_t>(seg);
+            if (array.size() <= index) {
+                array.resize(index + 1);
             }
+            pcurrent = &array[index];
         }
     }
-    return *presult;
+    *pcurrent = std::move(value);
+}
+
+MsgBody& Msg::detach_body() {
+    if (_body.use_count() > 1) {
+        // 浅复制：只复制属性列表，属性值仍然共享
+        _body = std::make_shared<MsgBody>(*_body);
+    }
+    return *_body;
+}
+
+JsonValue& Msg::detach_property(const std::string_view prop) {
+    switch (slot_of(prop)) {
+    case MsgSlot::ID:
+        throw InvalidDataException("消息的 '_msgid' 属性只能通过 set_id() 修改");
+    case MsgSlot::PAYLOAD:
+        return this->payload();
+    case MsgSlot::TOPIC: {
+        auto& body = this->detach_body();
+        if (!body.topic) {
+            throw_prop_not_found(prop);
+        }
+        return detach_value(body.topic, _storage);
+    }
+    default: {
+        auto& body = this->detach_body();
+        auto it = find_prop(body, prop);
+        if (it == body.props.end()) {
+            throw_prop_not_found(prop);
+        }
+        return detach_value(it->value, _storage);
+    }
+    }
+}
+
+void Msg::assign_json_property(const std::string_view key, JsonValue&& value) {
+    // 调用者保证消息体已经独占
+    auto& body = *_body;
+    // 存储不同的时候会复制到本消息的存储里
+    auto new_value = std::make_shared<JsonValue>(std::move(value), _storage);
+    switch (slot_of(key)) {
+    case MsgSlot::PAYLOAD:
+        body.payload = std::move(new_value);
+        body.payload_buffer.reset();
+        break;
+    case MsgSlot::TOPIC:
+        body.topic = std::move(new_value);
+        break;
+    default: {
+        auto it = find_prop(body, key);
+        if (it != body.props.end()) {
+            it->value = std::move(new_value);
+        } else {
+            body.props.emplace_back(MsgProperty{std::string(key), std::move(new_value)});
+        }
+    } break;
+    }
 }
 
 MsgID Msg::generate_msg_id() {
@@ -48,4 +410,4 @@ MsgID Msg::generate_msg_id() {
     }
 }
 
-}; // namespace edgelink
\ No newline at end of file
+}; // namespace edgelink
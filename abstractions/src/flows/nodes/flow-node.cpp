@@ -3,6 +3,27 @@
 
 namespace edgelink {
 
+void FlowNode::bind_executor(const boost::asio::any_io_executor& executor) {
+    // 传入的已经是 strand 时（同步投递链上的节点共用链首的 strand）直接使用它
+    if (auto const* strand = executor.target<Strand>(); strand != nullptr && !this->is_concurrent()) {
+        _io_executor = strand->get_inner_executor();
+        _strand.emplace(*strand);
+        return;
+    }
+    _io_executor = executor;
+    if (!this->is_concurrent()) {
+        _strand.emplace(boost::asio::make_strand(executor));
+    }
+}
+
+boost::asio::any_io_executor FlowNode::executor() const {
+    BOOST_ASSERT(_io_executor);
+    if (_strand) {
+        return *_strand;
+    }
+    return _io_executor;
+}
+
 Awaitable<void> FlowNode::receive_async(MsgPtr msg) {
     // 默认就是什么都不干
     co_return;
@@ -14,39 +35,37 @@ Awaitable<void> FlowNode::async_send_to_one_port(MsgPtr msg) {
         co_return;
     }
 
-    std::vector<MsgPtr> envelopes;
-    envelopes.emplace_back(msg);
-
-    co_await this->async_send_to_many_port(std::move(envelopes));
+    auto flow = this->flow();
+    BOOST_ASSERT(flow != nullptr);
+    co_await flow->async_send_many(this, std::span<const MsgPtr>(&msg, 1));
     co_return;
 }
 
 Awaitable<void> FlowNode::async_send_to_many_port(std::vector<MsgPtr>&& msgs) {
-    auto&& ports = this->output_ports();
-    if (msgs.size() > ports.size()) {
+    if (msgs.size() > this->output_ports().size()) {
         auto error_msg = "发送的消息超出端口数量";
         this->logger()->error(error_msg);
         throw std::out_of_range(error_msg);
     }
-    std::vector<std::unique_ptr<Envelope>> envelopes;
-    bool msg_sent = false;
-    for (size_t iport = 0; iport < msgs.size(); iport++) {
-        auto&& port = &ports.at(iport);
-        for (size_t iwire = 0; iwire < port->wires().size(); iwire++) {
-
-            IFlowNode* dest_node = port->wires().at(iwire);
+    auto flow = this->flow();
+    BOOST_ASSERT(flow != nullptr);
+    co_await flow->async_send_many(this, msgs);
+    co_return;
+}
 
-            auto env = std::make_unique<Envelope>(msgs.at(iport), msg_sent, this->id(), this, port, dest_node->id(),
-                                                  dest_node);
+Awaitable<void> FlowNode::receive_batch_async(MsgBatchPtr batch) {
+    for (size_t i = 0; i < batch->size(); i++) {
+        co_await this->receive_async(batch->to_msg(i, this));
+    }
+}
 
-            envelopes.emplace_back(std::move(env));
-            msg_sent = true;
-        }
+Awaitable<void> FlowNode::async_send_batch(MsgBatchPtr batch, size_t port) {
+    if (port >= this->output_ports().size()) {
+        throw std::out_of_range(fmt::format("节点 '{0}' 没有输出端口 {1}", this->id(), port));
     }
     auto flow = this->flow();
     BOOST_ASSERT(flow != nullptr);
-    co_await flow->async_send_many(std::move(envelopes));
-    co_return;
+    co_await flow->async_send_batch(this, port, std::move(batch));
 }
 
 const std::vector<OutputPort> FlowNode::setup_output_ports(const JsonObject& config, IFlow* flow) {
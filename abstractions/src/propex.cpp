@@ -91,6 +91,50 @@ const PropertySegments parse(const std::string_view input) {
     return result;
 }
 
+PropertyPath::PropertyPath(const std::string_view expr) : _expr(expr) {
+    for (auto const& seg : parse(_expr)) {
+        if (kind(seg) == PropertySegmentKind::IDENTIFIER) {
+            _segments.emplace_back(std::string(std::get<std::string_view>(seg)));
+        } else {
+            _segments.emplace_back(std::get<size_t>(seg));
+        }
+    }
+    if (_segments.empty() || kind(_segments.front()) != PropertySegmentKind::IDENTIFIER) {
+        throw InvalidDataException(fmt::format("Bad propex: '{0}'", expr));
+    }
+}
+
+namespace {
+
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(const std::string_view sv) const { return std::hash<std::string_view>{}(sv); }
+};
+
+// 动态表达式可能是无穷多的，超过这个数量就不再缓存
+const size_t INTERN_CACHE_MAX = 4096;
+
+}; // namespace
+
+std::shared_ptr<const PropertyPath> intern(const std::string_view expr) {
+    static std::shared_mutex cache_mutex;
+    static std::unordered_map<std::string, std::shared_ptr<const PropertyPath>, StringHash, std::equal_to<>> cache;
+
+    {
+        std::shared_lock lock(cache_mutex);
+        if (auto it = cache.find(expr); it != cache.end()) {
+            return it->second;
+        }
+    }
+
+    auto path = std::make_shared<const PropertyPath>(expr);
+    std::unique_lock lock(cache_mutex);
+    if (cache.size() < INTERN_CACHE_MAX) {
+        cache.emplace(std::string(expr), path);
+    }
+    return path;
+}
+
 // Assuming you have a getMessageProperty function
 // and other required functions declared and defined.
 
@@ -163,7 +207,7 @@ JsonValue evaluate_property_value(const JsonValue& value, const std::string_view
             throw std::runtime_error("Invalid JSON format");
         }
     } else if (type == "msg") {
-        result = JsonValue(msg.at_propex(value.as_string()));
+        result = JsonValue(msg.at_propex(*intern(value.as_string())));
     } else if (type == "flow") {
         //
         TODO("暂时不知支持");
@@ -0,0 +1,334 @@
+#include "edgelink/edgelink.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace edgelink {
+
+namespace {
+
+// 段文件头：魔数 "ELSL"、版本号、段中第一条记录的序号
+constexpr uint32_t SEGMENT_MAGIC = 0x4c534c45;
+constexpr uint32_t SEGMENT_VERSION = 1;
+constexpr size_t SEGMENT_HEADER_SIZE = 16;
+
+// 记录头：正文长度、正文的 FNV-1a 校验和
+constexpr size_t RECORD_HEADER_SIZE = 8;
+
+constexpr char SEGMENT_EXTENSION[] = ".seg";
+constexpr char CURSOR_FILE_NAME[] = "cursor";
+
+constexpr uint32_t FNV_OFFSET_BASIS = 2166136261u;
+constexpr uint32_t FNV_PRIME = 16777619u;
+
+uint32_t fnv1a(uint32_t hash, std::span<const uint8_t> data) {
+    for (auto b : data) {
+        hash = (hash ^ b) * FNV_PRIME;
+    }
+    return hash;
+}
+
+template <typename T> T load(const uint8_t* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+template <typename T> void store(uint8_t* p, T value) { std::memcpy(p, &value, sizeof(T)); }
+
+[[noreturn]] void throw_io_error(const std::string_view action, const std::filesystem::path& path) {
+    throw IOException(fmt::format("{0}失败：'{1}'，{2}", action, path.string(), std::strerror(errno)));
+}
+
+}; // namespace
+
+FsyncPolicy parse_fsync_policy(const std::string_view text) {
+    if (text == "never") {
+        return FsyncPolicy::NEVER;
+    } else if (text == "interval") {
+        return FsyncPolicy::INTERVAL;
+    } else if (text == "always") {
+        return FsyncPolicy::ALWAYS;
+    } else {
+        throw InvalidDataException(fmt::format("不支持的刷盘策略：'{0}'", text));
+    }
+}
+
+SegmentLog::SegmentLog(SegmentLogOptions options) : _options(std::move(options)) {
+    if (_options.segment_bytes < SEGMENT_HEADER_SIZE + RECORD_HEADER_SIZE + 1) {
+        throw InvalidDataException(fmt::format("段文件太小：{0} 字节", _options.segment_bytes));
+    }
+    // 至少要能同时容纳正在读的段和正在写的段
+    _options.max_bytes = std::max(_options.max_bytes, _options.segment_bytes * 2);
+    std::filesystem::create_directories(_options.directory);
+
+    std::vector<std::pair<uint64_t, std::filesystem::path>> files;
+    for (auto const& entry : std::filesystem::directory_iterator(_options.directory)) {
+        uint64_t id = 0;
+        if (entry.is_regular_file() && entry.path().extension() == SEGMENT_EXTENSION &&
+            boost::conversion::try_lexical_convert(entry.path().stem().string(), id)) {
+            files.emplace_back(id, entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    for (auto const& [id, path] : files) {
+        this->open_segment(path, id);
+    }
+
+    auto const cursor_path = _options.directory / CURSOR_FILE_NAME;
+    _cursor_fd = ::open(cursor_path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (_cursor_fd < 0) {
+        throw_io_error("打开读游标文件", cursor_path);
+    }
+    uint64_t cursor = 0;
+    if (::pread(_cursor_fd, &cursor, sizeof(cursor), 0) != static_cast<ssize_t>(sizeof(cursor))) {
+        cursor = 0;
+    }
+
+    if (_segments.empty()) {
+        this->create_segment(1, cursor);
+    }
+    _next_seq = _segments.back().end_seq();
+    _read_seq = std::clamp(cursor, _segments.front().base_seq, _next_seq);
+    this->consume(_read_seq);
+}
+
+SegmentLog::~SegmentLog() {
+    try {
+        if (_options.fsync != FsyncPolicy::NEVER) {
+            this->sync();
+        }
+    } catch (...) {
+        // 析构时无法报告错误，数据仍然在页缓存里，由操作系统回写
+    }
+    for (auto& segment : _segments) {
+        this->close_segment(segment, false);
+    }
+    if (_cursor_fd >= 0) {
+        ::close(_cursor_fd);
+    }
+}
+
+bool SegmentLog::append(std::span<const std::span<const uint8_t>> parts) {
+    size_t length = 0;
+    for (auto const& part : parts) {
+        length += part.size();
+    }
+    // 长度为 0 的记录头表示日志的结尾，所以记录不能为空
+    if (length == 0 || SEGMENT_HEADER_SIZE + RECORD_HEADER_SIZE + length > _options.segment_bytes) {
+        return false;
+    }
+
+    if (_segments.back().write_offset + RECORD_HEADER_SIZE + length > _options.segment_bytes) {
+        auto const& last = _segments.back();
+        this->create_segment(last.id + 1, last.end_seq());
+
+        // 总大小超出上限时丢弃最旧的段，哪怕其中还有没被消费的记录
+        while (_segments.size() > 1 && this->bytes() > _options.max_bytes) {
+            auto& oldest = _segments.front();
+            if (oldest.end_seq() > _read_seq) {
+                _dropped += oldest.end_seq() - std::max(_read_seq, oldest.base_seq);
+                _read_seq = oldest.end_seq();
+                this->write_cursor();
+            }
+            this->close_segment(oldest, true);
+            _segments.pop_front();
+        }
+    }
+
+    auto& segment = _segments.back();
+    uint8_t* p = segment.data + segment.write_offset;
+    size_t pos = RECORD_HEADER_SIZE;
+    uint32_t checksum = FNV_OFFSET_BASIS;
+    for (auto const& part : parts) {
+        std::memcpy(p + pos, part.data(), part.size());
+        checksum = fnv1a(checksum, part);
+        pos += part.size();
+    }
+    // 先写正文再写长度，写到一半崩溃时长度仍然是 0 或者校验和对不上
+    store<uint32_t>(p + 4, checksum);
+    store<uint32_t>(p, static_cast<uint32_t>(length));
+
+    segment.offsets.push_back(static_cast<uint32_t>(segment.write_offset));
+    segment.write_offset += RECORD_HEADER_SIZE + length;
+    _next_seq++;
+
+    if (_options.fsync == FsyncPolicy::ALWAYS) {
+        this->sync_segment(segment);
+    }
+    return true;
+}
+
+SegmentLog::Batch SegmentLog::peek(size_t max_count) const {
+    Batch batch{.first_seq = _read_seq};
+    uint64_t seq = _read_seq;
+    for (auto const& segment : _segments) {
+        if (batch.records.size() >= max_count) {
+            break;
+        }
+        if (segment.end_seq() <= seq) {
+            continue;
+        }
+        if (segment.base_seq > seq) {
+            // 中间的段在恢复时丢掉了结尾，序号不连续，只能跳过这段空缺
+            if (!batch.records.empty()) {
+                break;
+            }
+            seq = segment.base_seq;
+            batch.first_seq = seq;
+        }
+        for (size_t i = seq - segment.base_seq; i < segment.offsets.size() && batch.records.size() < max_count;
+             i++, seq++) {
+            auto const offset = segment.offsets[i];
+            auto const length = load<uint32_t>(segment.data + offset);
+            batch.records.emplace_back(segment.data + offset + RECORD_HEADER_SIZE, length);
+        }
+    }
+    return batch;
+}
+
+void SegmentLog::consume(uint64_t end_seq) {
+    _read_seq = std::clamp(end_seq, _read_seq, _next_seq);
+    while (_segments.size() > 1 && _segments.front().end_seq() <= _read_seq) {
+        this->close_segment(_segments.front(), true);
+        _segments.pop_front();
+    }
+    this->write_cursor();
+}
+
+void SegmentLog::sync() {
+    for (auto& segment : _segments) {
+        this->sync_segment(segment);
+    }
+    if (::fdatasync(_cursor_fd) != 0) {
+        throw_io_error("同步读游标文件", _options.directory / CURSOR_FILE_NAME);
+    }
+}
+
+size_t SegmentLog::bytes() const { return _segments.size() * _options.segment_bytes; }
+
+std::filesystem::path SegmentLog::segment_path(uint64_t id) const {
+    return _options.directory / fmt::format("{0:020}{1}", id, SEGMENT_EXTENSION);
+}
+
+SegmentLog::Segment& SegmentLog::create_segment(uint64_t id, uint64_t base_seq) {
+    auto const path = this->segment_path(id);
+    auto const capacity = _options.segment_bytes;
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw_io_error("创建段文件", path);
+    }
+    // 预先分配磁盘空间：稀疏文件在磁盘写满时，写入映射的内存会触发 SIGBUS
+    if (int err = ::posix_fallocate(fd, 0, static_cast<off_t>(capacity)); err != 0) {
+        ::close(fd);
+        errno = err;
+        throw_io_error("分配段文件空间", path);
+    }
+    void* data = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        ::close(fd);
+        throw_io_error("映射段文件", path);
+    }
+
+    auto bytes = static_cast<uint8_t*>(data);
+    store<uint32_t>(bytes, SEGMENT_MAGIC);
+    store<uint32_t>(bytes + 4, SEGMENT_VERSION);
+    store<uint64_t>(bytes + 8, base_seq);
+
+    auto& segment = _segments.emplace_back(Segment{
+        .id = id, .base_seq = base_seq, .fd = fd, .data = bytes, .write_offset = SEGMENT_HEADER_SIZE});
+    if (_options.fsync == FsyncPolicy::ALWAYS) {
+        this->sync_segment(segment);
+    }
+    return segment;
+}
+
+void SegmentLog::open_segment(const std::filesystem::path& path, uint64_t id) {
+    auto const capacity = _options.segment_bytes;
+    int fd = ::open(path.c_str(), O_RDWR);
+    if (fd < 0) {
+        throw_io_error("打开段文件", path);
+    }
+    if (std::filesystem::file_size(path) != capacity) {
+        // 段的大小只能在日志为空的时候修改
+        ::close(fd);
+        throw InvalidDataException(
+            fmt::format("段文件 '{0}' 的大小与设置的段大小 {1} 字节不一致", path.string(), capacity));
+    }
+    void* data = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        ::close(fd);
+        throw_io_error("映射段文件", path);
+    }
+
+    auto bytes = static_cast<uint8_t*>(data);
+    if (load<uint32_t>(bytes) != SEGMENT_MAGIC || load<uint32_t>(bytes + 4) != SEGMENT_VERSION) {
+        // 文件头都没有写完整，段里不可能有记录
+        ::munmap(data, capacity);
+        ::close(fd);
+        std::filesystem::remove(path);
+        return;
+    }
+
+    Segment segment{.id = id, .base_seq = load<uint64_t>(bytes + 8), .fd = fd, .data = bytes};
+    size_t offset = SEGMENT_HEADER_SIZE;
+    while (offset + RECORD_HEADER_SIZE <= capacity) {
+        auto const length = load<uint32_t>(bytes + offset);
+        if (length == 0 || offset + RECORD_HEADER_SIZE + length > capacity) {
+            break;
+        }
+        auto const body = std::span<const uint8_t>(bytes + offset + RECORD_HEADER_SIZE, length);
+        if (fnv1a(FNV_OFFSET_BASIS, body) != load<uint32_t>(bytes + offset + 4)) {
+            break;
+        }
+        segment.offsets.push_back(static_cast<uint32_t>(offset));
+        offset += RECORD_HEADER_SIZE + length;
+    }
+    // 写了一半的记录作废，清掉它的长度，免得新追加的短记录后面残留的内容在下次恢复时被误读
+    if (offset + sizeof(uint32_t) <= capacity) {
+        store<uint32_t>(bytes + offset, 0);
+    }
+    segment.write_offset = offset;
+    segment.synced_offset = offset;
+    _segments.push_back(std::move(segment));
+}
+
+void SegmentLog::close_segment(Segment& segment, bool remove) {
+    if (segment.data != nullptr) {
+        ::munmap(segment.data, _options.segment_bytes);
+        segment.data = nullptr;
+    }
+    if (segment.fd >= 0) {
+        ::close(segment.fd);
+        segment.fd = -1;
+    }
+    if (remove) {
+        std::error_code ec;
+        std::filesystem::remove(this->segment_path(segment.id), ec);
+    }
+}
+
+void SegmentLog::sync_segment(Segment& segment) {
+    if (segment.synced_offset >= segment.write_offset) {
+        return;
+    }
+    // msync 的起始地址必须按页对齐
+    static const size_t page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    auto const begin = segment.synced_offset / page_size * page_size;
+    if (::msync(segment.data + begin, segment.write_offset - begin, MS_SYNC) != 0) {
+        throw_io_error("同步段文件", this->segment_path(segment.id));
+    }
+    segment.synced_offset = segment.write_offset;
+}
+
+void SegmentLog::write_cursor() {
+    if (::pwrite(_cursor_fd, &_read_seq, sizeof(_read_seq), 0) != static_cast<ssize_t>(sizeof(_read_seq))) {
+        throw_io_error("写入读游标文件", _options.directory / CURSOR_FILE_NAME);
+    }
+    if (_options.fsync == FsyncPolicy::ALWAYS && ::fdatasync(_cursor_fd) != 0) {
+        throw_io_error("同步读游标文件", _options.directory / CURSOR_FILE_NAME);
+    }
+}
+
+}; // namespace edgelink
@@ -0,0 +1,55 @@
+#include <edgelink/edgelink.hpp>
+#include "bench.hpp"
+
+// 替换全局的 operator new/delete，统计整个进程的堆分配次数
+
+namespace {
+
+std::atomic<uint64_t> s_alloc_count = 0;
+std::atomic<uint64_t> s_alloc_bytes = 0;
+
+inline void* counted_alloc(std::size_t size) {
+    s_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    s_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (auto p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+inline void* counted_aligned_alloc(std::size_t size, std::align_val_t align) {
+    s_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    s_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    auto alignment = static_cast<std::size_t>(align);
+    if (auto p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+}; // namespace
+
+void* operator new(std::size_t size) { return counted_alloc(size); }
+void* operator new[](std::size_t size) { return counted_alloc(size); }
+void* operator new(std::size_t size, std::align_val_t align) { return counted_aligned_alloc(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align) { return counted_aligned_alloc(size, align); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace edgelink::bench {
+
+AllocStats alloc_stats() {
+    return AllocStats{
+        .count = s_alloc_count.load(std::memory_order_relaxed),
+        .bytes = s_alloc_bytes.load(std::memory_order_relaxed),
+    };
+}
+
+}; // namespace edgelink::bench
@@ -0,0 +1,48 @@
+#pragma once
+
+namespace edgelink::bench {
+
+/// @brief 进程内的堆分配统计，由替换后的全局 `operator new` 记录
+struct AllocStats {
+    uint64_t count;
+    uint64_t bytes;
+};
+
+AllocStats alloc_stats();
+
+/// @brief 当前进程的常驻内存（RSS），读取失败时返回 0
+size_t current_rss_bytes();
+
+/// @brief 一个基准测试用例，返回它的测量结果
+using BenchFunc = std::function<JsonObject()>;
+
+struct BenchRegistrar {
+    BenchRegistrar(const char* name, BenchFunc func);
+};
+
+const std::map<std::string, BenchFunc>& all_benches();
+
+/// @brief 简单的计时器
+class Stopwatch {
+  public:
+    Stopwatch() : _start(std::chrono::steady_clock::now()) {}
+
+    double elapsed_ns() const {
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - _start).count();
+    }
+
+  private:
+    std::chrono::steady_clock::time_point _start;
+};
+
+}; // namespace edgelink::bench
+
+#define EL_BENCH_CONCAT_INNER(a, b) a##b
+#define EL_BENCH_CONCAT(a, b) EL_BENCH_CONCAT_INNER(a, b)
+
+/// @brief 注册一个基准测试用例，函数体返回 `JsonObject` 形式的结果
+#define EL_BENCH(name)                                                                                                 \
+    static edgelink::JsonObject EL_BENCH_CONCAT(el_bench_func_, __LINE__)();                                           \
+    static edgelink::bench::BenchRegistrar EL_BENCH_CONCAT(el_bench_registrar_, __LINE__)(                             \
+        name, &EL_BENCH_CONCAT(el_bench_func_, __LINE__));                                                             \
+    static edgelink::JsonObject EL_BENCH_CONCAT(el_bench_func_, __LINE__)()
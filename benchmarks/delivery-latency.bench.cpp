@@ -0,0 +1,113 @@
+#include <edgelink/edgelink.hpp>
+#include "bench.hpp"
+
+#include "../src/flows/engine.hpp"
+#include "../src/flows/flow.hpp"
+#include "../src/flows/flow-factory.hpp"
+#include "../src/flows/registry.hpp"
+
+using namespace edgelink;
+
+namespace {
+
+constexpr size_t CHAIN_LENGTH = 10; ///< 9 个 junction 加 1 个接收器
+constexpr size_t MSG_COUNT = 20000;
+
+std::atomic<size_t> g_delivered = 0;
+
+class LatencySinkNode : public SinkNode {
+  public:
+    LatencySinkNode(const std::string_view id, const JsonObject& config, const INodeDescriptor* desc, IFlow* flow)
+        : SinkNode(id, desc, flow, config) {}
+
+    Awaitable<void> async_start() override { co_return; }
+    Awaitable<void> async_stop() override { co_return; }
+
+    Awaitable<void> receive_async(MsgPtr msg) override {
+        g_delivered.fetch_add(1, std::memory_order_release);
+        co_return;
+    }
+};
+
+JsonArray make_chain_config(bool sync_delivery) {
+    JsonArray config;
+    config.emplace_back(JsonObject{{"id", "f1"}, {"type", "tab"}, {"label", "chain"}, {"disabled", false},
+                                   {"syncDelivery", sync_delivery}});
+    for (size_t i = 1; i < CHAIN_LENGTH; i++) {
+        auto next = i + 1 < CHAIN_LENGTH ? fmt::format("n{0}", i + 1) : std::string("sink");
+        config.emplace_back(JsonObject{{"id", fmt::format("n{0}", i)},
+                                       {"type", "junction"},
+                                       {"z", "f1"},
+                                       {"name", ""},
+                                       {"wires", JsonArray{JsonArray{JsonValue(next)}}}});
+    }
+    config.emplace_back(
+        JsonObject{{"id", "sink"}, {"type", "bench-latency-sink"}, {"z", "f1"}, {"name", ""}, {"wires", JsonArray{}}});
+    return config;
+}
+
+/// @brief 每次只在链上放一条消息，测量它从第一个节点走到接收器的时间
+JsonObject measure(bool sync_delivery) {
+    const EdgeLinkSettings settings{
+        .home_path = std::filesystem::temp_directory_path(),
+        .executable_location = std::filesystem::temp_directory_path(),
+        .flows_json_path = "",
+    };
+    Registry registry(settings);
+    flows::FlowFactory flow_factory(registry);
+    Engine engine(settings, flow_factory);
+
+    auto flows = flow_factory.create_flows(make_chain_config(sync_delivery), &engine);
+    auto& flow = *flows.front();
+
+    boost::asio::io_context io(1);
+    flow.bind_executor(io.get_executor());
+    boost::asio::co_spawn(flow.executor(), flow.async_start(), boost::asio::detached);
+    std::thread io_thread([&io] { io.run(); });
+
+    auto head = flow.get_node("n1");
+    std::vector<double> latencies;
+    latencies.reserve(MSG_COUNT);
+    g_delivered = 0;
+
+    for (size_t i = 0; i < MSG_COUNT; i++) {
+        auto msg = std::make_shared<Msg>();
+        bench::Stopwatch sw;
+        boost::asio::co_spawn(head->executor(), head->receive_async(std::move(msg)), boost::asio::detached);
+        while (g_delivered.load(std::memory_order_acquire) <= i) {
+            // 忙等，避免线程唤醒的时间混进测量结果
+        }
+        latencies.push_back(sw.elapsed_ns() / 1e3);
+    }
+
+    // 停止流程以后投递协程退出，`io.run()` 随之返回
+    boost::asio::co_spawn(flow.executor(), flow.async_stop(), boost::asio::detached);
+    io_thread.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) { return latencies[static_cast<size_t>(p * (latencies.size() - 1))]; };
+
+    JsonObject result;
+    result["sync_delivery"] = sync_delivery;
+    result["p50_us"] = percentile(0.50);
+    result["p99_us"] = percentile(0.99);
+    result["mean_us"] = std::accumulate(latencies.begin(), latencies.end(), 0.0) / latencies.size();
+    return result;
+}
+
+}; // namespace
+
+RTTR_REGISTRATION {
+    rttr::registration::class_<FlowNodeProvider<LatencySinkNode, "bench-latency-sink", NodeKind::SINK>>(
+        "edgelink::bench::LatencySinkNodeProvider")
+        .constructor()(rttr::policy::ctor::as_raw_ptr);
+};
+
+EL_BENCH("delivery-latency") {
+    JsonObject result;
+    result["chain_length"] = CHAIN_LENGTH;
+    result["messages"] = MSG_COUNT;
+    result["async"] = measure(false);
+    result["sync"] = measure(true);
+    return result;
+}
@@ -0,0 +1,159 @@
+#include <edgelink/edgelink.hpp>
+#include "bench.hpp"
+
+#include "../src/flows/engine.hpp"
+#include "../src/flows/flow-factory.hpp"
+#include "../src/flows/registry.hpp"
+
+using namespace edgelink;
+
+namespace {
+
+constexpr size_t CHAIN_COUNT = 8;      ///< 合成流程中互相独立的处理链数量
+constexpr size_t MSGS_PER_CHAIN = 5000; ///< 每条链的数据源发出的消息数
+constexpr size_t WORK_ITERATIONS = 20000;
+
+std::atomic<size_t> g_received = 0;
+
+/// @brief 一次性发出固定数量消息的数据源
+class ScalingSourceNode : public SourceNode {
+  public:
+    ScalingSourceNode(const std::string_view id, const JsonObject& config, const INodeDescriptor* desc, IFlow* flow)
+        : SourceNode(id, desc, flow, config) {}
+
+  protected:
+    Awaitable<void> on_async_run() override {
+        for (size_t i = 0; i < MSGS_PER_CHAIN; i++) {
+            auto msg = std::make_shared<Msg>(this->flow()->create_msg_storage(), this);
+            msg->set_payload(JsonValue(static_cast<uint64_t>(i)));
+            co_await this->async_send_to_one_port(std::move(msg));
+        }
+        co_return;
+    }
+};
+
+/// @brief 占用 CPU 的处理节点，模拟比较重的计算
+class ScalingWorkNode : public PipeNode {
+  public:
+    ScalingWorkNode(const std::string_view id, const JsonObject& config, const INodeDescriptor* desc, IFlow* flow)
+        : PipeNode(id, desc, flow, config) {}
+
+    Awaitable<void> async_start() override { co_return; }
+    Awaitable<void> async_stop() override { co_return; }
+
+    Awaitable<void> receive_async(MsgPtr msg) override {
+        auto x = msg->payload().to_number<uint64_t>();
+        for (size_t i = 0; i < WORK_ITERATIONS; i++) {
+            x = (x * 6364136223846793005ULL + 1442695040888963407ULL) ^ (x >> 29);
+        }
+        msg->set_payload(JsonValue(x));
+        co_await this->async_send_to_one_port(std::move(msg));
+    }
+};
+
+class ScalingSinkNode : public SinkNode {
+  public:
+    ScalingSinkNode(const std::string_view id, const JsonObject& config, const INodeDescriptor* desc, IFlow* flow)
+        : SinkNode(id, desc, flow, config) {}
+
+    Awaitable<void> async_start() override { co_return; }
+    Awaitable<void> async_stop() override { co_return; }
+
+    Awaitable<void> receive_async(MsgPtr msg) override {
+        g_received.fetch_add(1, std::memory_order_relaxed);
+        co_return;
+    }
+};
+
+/// @brief 生成 `CHAIN_COUNT` 条 source -> work -> sink 的处理链，每条链一个流程
+JsonArray make_flows_config() {
+    JsonArray flows;
+    for (size_t i = 0; i < CHAIN_COUNT; i++) {
+        auto flow_id = fmt::format("flow{0}", i);
+        auto node_id = [&](const char* name) { return fmt::format("{0}.{1}", flow_id, name); };
+        auto node = [&](const char* type, const char* name, JsonArray wires) {
+            return JsonObject{{"id", node_id(name)}, {"type", type},   {"z", flow_id},
+                              {"name", name},        {"wires", wires}};
+        };
+        flows.emplace_back(JsonObject{{"id", flow_id}, {"type", "tab"}, {"label", flow_id}, {"disabled", false}});
+        flows.emplace_back(node("bench-scaling-source", "source", {JsonArray{node_id("work")}}));
+        flows.emplace_back(node("bench-scaling-work", "work", {JsonArray{node_id("sink")}}));
+        flows.emplace_back(node("bench-scaling-sink", "sink", {}));
+    }
+    return flows;
+}
+
+JsonObject measure(size_t thread_count, const std::filesystem::path& flows_path) {
+    EdgeLinkSettings settings{
+        .home_path = std::filesystem::temp_directory_path(),
+        .executable_location = std::filesystem::temp_directory_path(),
+        .flows_json_path = flows_path.string(),
+        .worker_threads = thread_count,
+    };
+    Registry registry(settings);
+    flows::FlowFactory flow_factory(registry);
+    auto engine = std::make_unique<Engine>(settings, flow_factory);
+
+    g_received = 0;
+    boost::asio::io_context io(static_cast<int>(thread_count));
+    boost::asio::co_spawn(io, engine->async_start(), boost::asio::detached);
+
+    bench::Stopwatch sw;
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < thread_count; i++) {
+        threads.emplace_back([&io] { io.run(); });
+    }
+
+    // 节点的投递协程会一直等待邮箱，所以收齐消息以后主动停止引擎
+    constexpr size_t TOTAL = CHAIN_COUNT * MSGS_PER_CHAIN;
+    while (g_received.load(std::memory_order_relaxed) < TOTAL) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    auto elapsed = sw.elapsed_ns();
+
+    boost::asio::co_spawn(io, engine->async_stop(), boost::asio::detached);
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    JsonObject result;
+    result["threads"] = thread_count;
+    result["messages"] = g_received.load();
+    result["elapsed_ms"] = elapsed / 1e6;
+    result["msgs_per_sec"] = static_cast<double>(g_received.load()) / (elapsed / 1e9);
+    return result;
+}
+
+}; // namespace
+
+RTTR_REGISTRATION {
+    rttr::registration::class_<FlowNodeProvider<ScalingSourceNode, "bench-scaling-source", NodeKind::SOURCE>>(
+        "edgelink::bench::ScalingSourceNodeProvider")
+        .constructor()(rttr::policy::ctor::as_raw_ptr);
+    rttr::registration::class_<FlowNodeProvider<ScalingWorkNode, "bench-scaling-work", NodeKind::PIPE>>(
+        "edgelink::bench::ScalingWorkNodeProvider")
+        .constructor()(rttr::policy::ctor::as_raw_ptr);
+    rttr::registration::class_<FlowNodeProvider<ScalingSinkNode, "bench-scaling-sink", NodeKind::SINK>>(
+        "edgelink::bench::ScalingSinkNodeProvider")
+        .constructor()(rttr::policy::ctor::as_raw_ptr);
+};
+
+EL_BENCH("engine-scaling") {
+    auto flows_path = std::filesystem::temp_directory_path() / "edgelink-bench-scaling-flows.json";
+    {
+        std::ofstream file(flows_path);
+        file << boost::json::serialize(make_flows_config());
+    }
+
+    JsonObject result;
+    result["chains"] = CHAIN_COUNT;
+    result["messages_per_chain"] = MSGS_PER_CHAIN;
+    JsonArray runs;
+    for (size_t threads : {1, 2, 4, 8}) {
+        runs.emplace_back(measure(threads, flows_path));
+    }
+    result["runs"] = std::move(runs);
+
+    std::filesystem::remove(flows_path);
+    return result;
+}
@@ -0,0 +1,138 @@
+#include <edgelink/edgelink.hpp>
+#include "flows-generator.hpp"
+
+namespace edgelink::bench {
+
+namespace {
+
+/// @brief 模拟常见的脚本：读写负载和几个属性
+constexpr char FUNCTION_BODY[] = R"(
+    const v = msg.payload;
+    msg.payload = v * 1.0001 + 1;
+    msg.quality = v > 0 ? "good" : "bad";
+    return msg;
+)";
+
+class FlowBuilder {
+  public:
+    FlowBuilder(JsonArray& flows, std::string flow_id) : _flows(flows), _flow_id(std::move(flow_id)) {
+        _flows.emplace_back(JsonObject{{"id", _flow_id}, {"type", "tab"}, {"label", _flow_id}, {"disabled", false}});
+    }
+
+    std::string id(const std::string_view name) const { return fmt::format("{0}.{1}", _flow_id, name); }
+
+    JsonObject& add(const std::string_view type, const std::string_view name, std::vector<std::string> targets) {
+        JsonArray port;
+        for (auto& t : targets) {
+            port.emplace_back(this->id(t));
+        }
+        JsonArray wires;
+        if (type != "bench-sink") {
+            wires.emplace_back(std::move(port));
+        }
+        _flows.emplace_back(JsonObject{
+            {"id", this->id(name)}, {"type", type}, {"z", _flow_id}, {"name", name}, {"wires", std::move(wires)}});
+        return _flows.back().as_object();
+    }
+
+  private:
+    JsonArray& _flows;
+    const std::string _flow_id;
+};
+
+void add_function_node(FlowBuilder& builder, const std::string& name, const std::string& next) {
+    auto& node = builder.add("function", name, {next});
+    node["func"] = FUNCTION_BODY;
+    node["outputs"] = 1;
+    node["initialize"] = "";
+    node["finalize"] = "";
+    node["libs"] = JsonArray{};
+}
+
+}; // namespace
+
+Topology parse_topology(const std::string_view text) {
+    if (text == "linear") {
+        return Topology::LINEAR;
+    } else if (text == "fan-out") {
+        return Topology::FAN_OUT;
+    } else if (text == "diamond") {
+        return Topology::DIAMOND;
+    } else if (text == "function-heavy") {
+        return Topology::FUNCTION_HEAVY;
+    } else {
+        throw InvalidDataException(fmt::format("不支持的拓扑：'{0}'", text));
+    }
+}
+
+std::string_view topology_name(Topology topology) {
+    switch (topology) {
+    case Topology::FAN_OUT:
+        return "fan-out";
+    case Topology::DIAMOND:
+        return "diamond";
+    case Topology::FUNCTION_HEAVY:
+        return "function-heavy";
+    default:
+        return "linear";
+    }
+}
+
+JsonArray generate_flows(const FlowsSpec& spec) {
+    JsonArray flows;
+    auto const size = std::max<size_t>(spec.size, 1);
+    for (size_t f = 0; f < spec.flow_count; f++) {
+        FlowBuilder builder(flows, fmt::format("flow{0}", f));
+        auto stage = [](size_t i) { return fmt::format("n{0}", i); };
+
+        switch (spec.topology) {
+        case Topology::LINEAR:
+        case Topology::FUNCTION_HEAVY: {
+            builder.add("bench-source", "source", {stage(0)})["count"] = spec.msg_count;
+            for (size_t i = 0; i < size; i++) {
+                auto next = i + 1 < size ? stage(i + 1) : std::string("sink");
+                if (spec.topology == Topology::FUNCTION_HEAVY) {
+                    add_function_node(builder, stage(i), next);
+                } else {
+                    builder.add("junction", stage(i), {next});
+                }
+            }
+            builder.add("bench-sink", "sink", {});
+        } break;
+
+        case Topology::FAN_OUT: {
+            std::vector<std::string> sinks;
+            for (size_t i = 0; i < size; i++) {
+                sinks.push_back(fmt::format("sink{0}", i));
+            }
+            builder.add("bench-source", "source", sinks)["count"] = spec.msg_count;
+            for (auto const& sink : sinks) {
+                builder.add("bench-sink", sink, {});
+            }
+        } break;
+
+        case Topology::DIAMOND: {
+            std::vector<std::string> branches;
+            for (size_t i = 0; i < size; i++) {
+                branches.push_back(stage(i));
+            }
+            builder.add("bench-source", "source", branches)["count"] = spec.msg_count;
+            for (auto const& branch : branches) {
+                builder.add("junction", branch, {"join"});
+            }
+            builder.add("junction", "join", {"sink"});
+            builder.add("bench-sink", "sink", {});
+        } break;
+        }
+    }
+    return flows;
+}
+
+size_t expected_deliveries(const FlowsSpec& spec) {
+    auto per_msg = (spec.topology == Topology::FAN_OUT || spec.topology == Topology::DIAMOND)
+                       ? std::max<size_t>(spec.size, 1)
+                       : 1;
+    return spec.msg_count * spec.flow_count * per_msg;
+}
+
+}; // namespace edgelink::bench
@@ -0,0 +1,29 @@
+#pragma once
+
+namespace edgelink::bench {
+
+/// @brief 合成流程的拓扑结构
+enum class Topology {
+    LINEAR,         ///< source -> junction × N -> sink
+    FAN_OUT,        ///< source 一个端口连 N 个 sink
+    DIAMOND,        ///< source -> N 条并行的 junction -> 汇合的 junction -> sink
+    FUNCTION_HEAVY, ///< source -> function × N -> sink
+};
+
+Topology parse_topology(const std::string_view text);
+std::string_view topology_name(Topology topology);
+
+struct FlowsSpec {
+    Topology topology = Topology::LINEAR;
+    size_t size = 8;          ///< 链的长度或者扇出的宽度
+    size_t msg_count = 10000; ///< 每个流程的数据源发出的消息数
+    size_t flow_count = 1;    ///< 互相独立的流程数量
+};
+
+/// @brief 生成 `flows.json` 格式的流程配置，数据源和接收器使用 `bench-source` 和 `bench-sink` 节点
+JsonArray generate_flows(const FlowsSpec& spec);
+
+/// @brief 所有接收器一共应当收到的消息数
+size_t expected_deliveries(const FlowsSpec& spec);
+
+}; // namespace edgelink::bench
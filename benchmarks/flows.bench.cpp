@@ -0,0 +1,181 @@
+#include <edgelink/edgelink.hpp>
+#include "bench.hpp"
+#include "flows-generator.hpp"
+
+#include "../src/flows/engine.hpp"
+#include "../src/flows/flow-factory.hpp"
+#include "../src/flows/registry.hpp"
+
+using namespace edgelink;
+using namespace edgelink::bench;
+
+namespace {
+
+constexpr size_t THREAD_COUNT = 4;
+
+/// @brief 预热阶段的投递数占总数的比例，预热期间的分配（包括引擎启动）不计入每条消息的分配
+constexpr size_t WARMUP_PERCENT = 10;
+
+/// @brief 单个用例等待全部投递完成的最长时间，超时的用例在结果中标记 `timed_out`
+constexpr std::chrono::seconds RUN_TIMEOUT{120};
+
+std::atomic<size_t> g_delivered = 0;
+std::unique_ptr<LatencyHistogram> g_latency;
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/// @brief 等到投递数达到 `target`，超过 `deadline` 时返回 false
+bool wait_for_deliveries(size_t target, std::chrono::steady_clock::time_point deadline) {
+    while (g_delivered.load(std::memory_order_relaxed) < target) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return true;
+}
+
+/// @brief 尽可能快地发出 `count` 条消息的数据源，每条消息带上发出的时间
+class BenchSourceNode : public SourceNode {
+  public:
+    BenchSourceNode(const std::string_view id, const JsonObject& config, const INodeDescriptor* desc, IFlow* flow)
+        : SourceNode(id, desc, flow, config), _count(config.at("count").to_number<size_t>()) {}
+
+  protected:
+    Awaitable<void> on_async_run() override {
+        for (size_t i = 0; i < _count; i++) {
+            auto msg = std::make_shared<Msg>(this->flow()->create_msg_storage(), this);
+            msg->set_payload(JsonValue(static_cast<double>(i)));
+            msg->set_topic("bench/sample");
+            msg->insert_or_assign("benchSentAt", JsonValue(now_ns()));
+            co_await this->async_send_to_one_port(std::move(msg));
+        }
+    }
+
+  private:
+    const size_t _count;
+};
+
+/// @brief 统计收到的消息数和端到端延迟
+class BenchSinkNode : public SinkNode {
+  public:
+    BenchSinkNode(const std::string_view id, const JsonObject& config, const INodeDescriptor* desc, IFlow* flow)
+        : SinkNode(id, desc, flow, config) {}
+
+    Awaitable<void> async_start() override { co_return; }
+    Awaitable<void> async_stop() override { co_return; }
+
+    Awaitable<void> receive_async(MsgPtr msg) override {
+        auto sent_at = std::as_const(*msg).at("benchSentAt").to_number<int64_t>();
+        g_latency->record(static_cast<uint64_t>(std::max<int64_t>(now_ns() - sent_at, 0)));
+        g_delivered.fetch_add(1, std::memory_order_relaxed);
+        co_return;
+    }
+};
+
+JsonObject run_flows(const FlowsSpec& spec) {
+    auto flows_path = std::filesystem::temp_directory_path() /
+                      fmt::format("edgelink-bench-{0}-{1}.json", topology_name(spec.topology), spec.size);
+    {
+        std::ofstream file(flows_path);
+        file << boost::json::serialize(generate_flows(spec));
+    }
+
+    EdgeLinkSettings settings{
+        .home_path = std::filesystem::temp_directory_path(),
+        .executable_location = std::filesystem::temp_directory_path(),
+        .flows_json_path = flows_path.string(),
+        .js_runtime_pool_size = 4,
+        .worker_threads = THREAD_COUNT,
+    };
+    Registry registry(settings);
+    flows::FlowFactory flow_factory(registry);
+    auto engine = std::make_unique<Engine>(settings, flow_factory);
+
+    g_delivered = 0;
+    g_latency = std::make_unique<LatencyHistogram>();
+    auto const expected = expected_deliveries(spec);
+
+    boost::asio::io_context io(static_cast<int>(THREAD_COUNT));
+    auto work = boost::asio::make_work_guard(io);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < THREAD_COUNT; i++) {
+        threads.emplace_back([&io] { io.run(); });
+    }
+
+    Stopwatch sw;
+    auto const deadline = std::chrono::steady_clock::now() + RUN_TIMEOUT;
+    boost::asio::co_spawn(io, engine->async_start(), boost::asio::use_future).get();
+
+    // 引擎启动和预热期间的分配（节点、邮箱、脚本运行时、首批消息的内存池）不计入每条消息的分配
+    bool completed = wait_for_deliveries(expected * WARMUP_PERCENT / 100, deadline);
+    auto const allocs_before = alloc_stats();
+    auto const delivered_before = g_delivered.load(std::memory_order_relaxed);
+    completed = completed && wait_for_deliveries(expected, deadline);
+    auto elapsed = sw.elapsed_ns();
+    auto const allocs_after = alloc_stats();
+    auto const delivered_after = g_delivered.load(std::memory_order_relaxed);
+    auto const rss = current_rss_bytes();
+
+    boost::asio::co_spawn(io, engine->async_stop(), boost::asio::detached);
+    work.reset();
+    for (auto& t : threads) {
+        t.join();
+    }
+    engine.reset();
+    std::filesystem::remove(flows_path);
+
+    auto const sent = spec.msg_count * spec.flow_count;
+    // 预热之后的投递折算成消息数，每条消息的投递数由拓扑决定
+    auto const measured_msgs =
+        std::max(static_cast<double>(delivered_after - delivered_before) * sent / expected, 1.0);
+    JsonObject result;
+    result["topology"] = topology_name(spec.topology);
+    result["size"] = spec.size;
+    result["messages"] = sent;
+    result["deliveries"] = g_delivered.load();
+    result["timed_out"] = !completed;
+    result["elapsed_ms"] = elapsed / 1e6;
+    result["msgs_per_sec"] = static_cast<double>(sent) / (elapsed / 1e9);
+    result["deliveries_per_sec"] = static_cast<double>(g_delivered.load()) / (elapsed / 1e9);
+    result["latency_p50_us"] = static_cast<double>(g_latency->percentile(0.50)) / 1e3;
+    result["latency_p99_us"] = static_cast<double>(g_latency->percentile(0.99)) / 1e3;
+    result["latency_p999_us"] = static_cast<double>(g_latency->percentile(0.999)) / 1e3;
+    result["allocs_per_msg"] = static_cast<double>(allocs_after.count - allocs_before.count) / measured_msgs;
+    result["alloc_bytes_per_msg"] = static_cast<double>(allocs_after.bytes - allocs_before.bytes) / measured_msgs;
+    result["rss_bytes"] = rss;
+    return result;
+}
+
+}; // namespace
+
+RTTR_REGISTRATION {
+    rttr::registration::class_<FlowNodeProvider<BenchSourceNode, "bench-source", NodeKind::SOURCE>>(
+        "edgelink::bench::BenchSourceNodeProvider")
+        .constructor()(rttr::policy::ctor::as_raw_ptr);
+    rttr::registration::class_<FlowNodeProvider<BenchSinkNode, "bench-sink", NodeKind::SINK>>(
+        "edgelink::bench::BenchSinkNodeProvider")
+        .constructor()(rttr::policy::ctor::as_raw_ptr);
+};
+
+EL_BENCH("flows") {
+    const std::array<FlowsSpec, 5> specs{{
+        {.topology = Topology::LINEAR, .size = 1, .msg_count = 50000},
+        {.topology = Topology::LINEAR, .size = 16, .msg_count = 20000},
+        {.topology = Topology::FAN_OUT, .size = 16, .msg_count = 10000},
+        {.topology = Topology::DIAMOND, .size = 8, .msg_count = 10000},
+        {.topology = Topology::FUNCTION_HEAVY, .size = 4, .msg_count = 5000},
+    }};
+
+    JsonObject result;
+    result["threads"] = THREAD_COUNT;
+    JsonArray runs;
+    for (auto const& spec : specs) {
+        runs.emplace_back(run_flows(spec));
+    }
+    result["runs"] = std::move(runs);
+    return result;
+}
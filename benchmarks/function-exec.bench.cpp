@@ -0,0 +1,84 @@
+#include <edgelink/edgelink.hpp>
+#include "bench.hpp"
+
+#include "../src/flows/nodes/function/script-executor.hpp"
+
+using namespace edgelink;
+
+namespace {
+
+constexpr size_t MSG_COUNT = 4000;
+constexpr size_t THREAD_COUNT = 8;
+
+/// @brief 占用 CPU 的用户函数，模拟比较重的脚本
+constexpr char USER_FUNC[] = R"(
+    function __el_user_func(n) {
+        let x = 0;
+        for (let i = 0; i < 2000; i++) {
+            x = (x * 31 + i + n) % 1000003;
+        }
+        return x;
+    }
+)";
+
+JsonObject measure(js::ExecMode mode, size_t workers) {
+    js::RuntimePool pool(0, {});
+    js::ScriptExecutor executor(mode, workers, pool, [](js::ScriptWorker& worker) {
+        auto ctx = worker.ctx();
+        JS_FreeValue(ctx, JS_Eval(ctx, USER_FUNC, sizeof(USER_FUNC) - 1, "<bench>", JS_EVAL_TYPE_GLOBAL));
+        JSValue global = JS_GetGlobalObject(ctx);
+        worker.set_user_func(JS_GetPropertyStr(ctx, global, "__el_user_func"));
+        JS_FreeValue(ctx, global);
+    });
+
+    boost::asio::io_context io(THREAD_COUNT);
+    executor.bind_executor(io.get_executor());
+
+    std::atomic<size_t> done = 0;
+    auto run_one = [&](uint64_t i) -> Awaitable<void> {
+        co_await executor.async_run(i, [i](js::ScriptWorker& worker) {
+            JSValue arg = JS_NewInt64(worker.ctx(), static_cast<int64_t>(i));
+            JSValue result = JS_Call(worker.ctx(), worker.user_func(), JS_UNDEFINED, 1, &arg);
+            JS_FreeValue(worker.ctx(), result);
+        });
+        done.fetch_add(1, std::memory_order_relaxed);
+    };
+    for (uint64_t i = 0; i < MSG_COUNT; i++) {
+        boost::asio::co_spawn(io, run_one(i), boost::asio::detached);
+    }
+
+    bench::Stopwatch sw;
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < THREAD_COUNT; i++) {
+        threads.emplace_back([&io] { io.run(); });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto elapsed = sw.elapsed_ns();
+
+    JsonObject result;
+    result["workers"] = executor.worker_count();
+    result["messages"] = done.load();
+    result["elapsed_ms"] = elapsed / 1e6;
+    result["msgs_per_sec"] = static_cast<double>(done.load()) / (elapsed / 1e9);
+    return result;
+}
+
+}; // namespace
+
+EL_BENCH("function-exec") {
+    JsonObject result;
+    result["threads"] = THREAD_COUNT;
+    result["serialized"] = measure(js::ExecMode::SERIALIZED, 1);
+
+    JsonArray parallel;
+    JsonArray keyed;
+    for (size_t workers : {1, 2, 4, 8}) {
+        parallel.emplace_back(measure(js::ExecMode::PARALLEL, workers));
+        keyed.emplace_back(measure(js::ExecMode::KEYED, workers));
+    }
+    result["parallel"] = std::move(parallel);
+    result["keyed"] = std::move(keyed);
+    return result;
+}
@@ -0,0 +1,122 @@
+#include <edgelink/edgelink.hpp>
+#include "bench.hpp"
+
+#include "../src/flows/nodes/function/quickjs-runtime-pool.hpp"
+
+using namespace edgelink;
+
+namespace {
+
+constexpr size_t NODE_COUNT = 300;
+constexpr size_t POOL_SIZE = 4;
+
+constexpr char USER_FUNC_TEMPLATE[] = R"(
+    function __el_user_func_native(context, msg) {{
+        const user_func = function() {{
+        /* 用户代码开始 */
+        msg.payload = msg.payload % {0};
+        return msg;
+        /* 用户代码结束 */
+        }};
+        return user_func();
+    }};
+)";
+
+std::string read_prelude() {
+    auto path = std::filesystem::current_path() / "resources" / "nodes" / "function" / "prelude.js";
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw IOException(fmt::format("找不到前置脚本：'{0}'，请在构建目录下运行", path.string()));
+    }
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+/// @brief 前置脚本里用到的 evalEnv，基准测试里用普通对象代替
+void define_eval_env(JSContext* ctx) {
+    constexpr char EVAL_ENV[] = "globalThis.evalEnv = { nodeID: 'n', nodeName: 'n', generateMsgID: () => 1 };";
+    JS_FreeValue(ctx, JS_Eval(ctx, EVAL_ENV, sizeof(EVAL_ENV) - 1, "<env>", JS_EVAL_TYPE_GLOBAL));
+}
+
+JsonObject measure(const std::function<void()>& start_nodes, const std::function<void()>& stop_nodes) {
+    auto rss_before = bench::current_rss_bytes();
+    bench::Stopwatch sw;
+    start_nodes();
+    auto elapsed = sw.elapsed_ns();
+    auto rss_after = bench::current_rss_bytes();
+    stop_nodes();
+
+    JsonObject result;
+    result["node_count"] = NODE_COUNT;
+    result["startup_ms"] = elapsed / 1e6;
+    result["rss_delta_kb"] = (static_cast<int64_t>(rss_after) - static_cast<int64_t>(rss_before)) / 1024;
+    result["rss_per_node_kb"] =
+        (static_cast<double>(rss_after) - static_cast<double>(rss_before)) / 1024.0 / NODE_COUNT;
+    return result;
+}
+
+}; // namespace
+
+EL_BENCH("function-startup") {
+    const auto prelude = read_prelude();
+    JsonObject result;
+
+    // 旧方式：每个节点一个运行时，每次都从源码解析
+    {
+        std::vector<std::unique_ptr<qjs::Runtime>> runtimes;
+        std::vector<std::unique_ptr<qjs::Context>> contexts;
+        result["per_node_runtime"] = measure(
+            [&] {
+                for (size_t i = 0; i < NODE_COUNT; i++) {
+                    auto& rt = runtimes.emplace_back(std::make_unique<qjs::Runtime>());
+                    auto& context = contexts.emplace_back(std::make_unique<qjs::Context>(*rt));
+                    define_eval_env(context->ctx);
+                    context->eval(prelude);
+                    context->eval(fmt::format(USER_FUNC_TEMPLATE, i + 1));
+                }
+            },
+            [&] {
+                contexts.clear();
+                runtimes.clear();
+            });
+    }
+
+    // 新方式：共享运行时池，前置脚本和用户函数都从字节码加载
+    for (bool warm_cache : {false, true}) {
+        auto cache_dir = std::filesystem::temp_directory_path() / "edgelink-bench-qjsbc";
+        if (!warm_cache) {
+            std::filesystem::remove_all(cache_dir);
+        }
+        js::RuntimePool pool(POOL_SIZE, cache_dir);
+        std::vector<std::unique_ptr<js::RuntimeLease>> leases;
+        std::vector<std::unique_ptr<qjs::Context>> contexts;
+        result[warm_cache ? "pooled_warm_cache" : "pooled_cold_cache"] = measure(
+            [&] {
+                for (size_t i = 0; i < NODE_COUNT; i++) {
+                    auto& lease = leases.emplace_back(pool.acquire());
+                    auto& context = contexts.emplace_back(std::make_unique<qjs::Context>((*lease)->runtime()));
+                    auto ctx = context->ctx;
+                    define_eval_env(ctx);
+                    js::eval_bytecode(ctx, *pool.bytecode_cache().get_or_compile(ctx, prelude, "prelude.js"));
+                    auto user_func = fmt::format(USER_FUNC_TEMPLATE, i + 1);
+                    js::eval_bytecode(ctx, *pool.bytecode_cache().get_or_compile(ctx, user_func, "<function>"));
+                }
+            },
+            [&] {
+                contexts.clear();
+                leases.clear();
+            });
+    }
+
+    // 直接给出改动前后的对比，记录结果时不需要再手工换算
+    auto const& before = result["per_node_runtime"].as_object();
+    for (auto const* name : {"pooled_cold_cache", "pooled_warm_cache"}) {
+        auto& after = result[name].as_object();
+        after["startup_speedup"] = before.at("startup_ms").to_number<double>() /
+                                   std::max(after.at("startup_ms").to_number<double>(), 1e-6);
+        after["rss_ratio"] = after.at("rss_delta_kb").to_number<double>() /
+                             std::max(before.at("rss_delta_kb").to_number<double>(), 1.0);
+    }
+
+    result["pool_size"] = POOL_SIZE;
+    return result;
+}
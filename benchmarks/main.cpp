@@ -0,0 +1,82 @@
+#include <edgelink/edgelink.hpp>
+#include "bench.hpp"
+#include "flows-generator.hpp"
+
+#include <unistd.h>
+
+// 用法：EdgeLinkBench [用例名称...]
+// 不指定名称时运行所有用例，结果以 JSON 数组的形式输出到标准输出
+//
+// 生成合成流程：EdgeLinkBench --generate <linear|fan-out|diamond|function-heavy> [规模] [消息数] [流程数]
+// 输出的 flows.json 使用 `bench-source` 和 `bench-sink` 节点，只能由 EdgeLinkBench 加载
+
+namespace edgelink::bench {
+
+static std::map<std::string, BenchFunc>& registry() {
+    static std::map<std::string, BenchFunc> benches;
+    return benches;
+}
+
+BenchRegistrar::BenchRegistrar(const char* name, BenchFunc func) { registry().emplace(name, std::move(func)); }
+
+const std::map<std::string, BenchFunc>& all_benches() { return registry(); }
+
+size_t current_rss_bytes() {
+    // /proc/self/statm 的第二列是常驻内存页数
+    std::ifstream statm("/proc/self/statm");
+    size_t total_pages = 0, resident_pages = 0;
+    if (!(statm >> total_pages >> resident_pages)) {
+        return 0;
+    }
+    return resident_pages * static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+}; // namespace edgelink::bench
+
+int main(int argc, char* argv[]) {
+    using namespace edgelink;
+
+    if (argc >= 3 && std::string_view(argv[1]) == "--generate") {
+        bench::FlowsSpec spec{.topology = bench::parse_topology(argv[2])};
+        if (argc >= 4) {
+            spec.size = boost::lexical_cast<size_t>(argv[3]);
+        }
+        if (argc >= 5) {
+            spec.msg_count = boost::lexical_cast<size_t>(argv[4]);
+        }
+        if (argc >= 6) {
+            spec.flow_count = boost::lexical_cast<size_t>(argv[5]);
+        }
+        fmt::print("{0}\n", boost::json::serialize(bench::generate_flows(spec)));
+        return 0;
+    }
+
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; i++) {
+        names.emplace_back(argv[i]);
+    }
+    if (names.empty()) {
+        for (auto const& [name, _] : bench::all_benches()) {
+            names.push_back(name);
+        }
+    }
+
+    spdlog::set_level(spdlog::level::warn);
+
+    JsonArray results;
+    for (auto const& name : names) {
+        auto it = bench::all_benches().find(name);
+        if (it == bench::all_benches().end()) {
+            fmt::print(stderr, "找不到基准测试：'{0}'\n", name);
+            return 1;
+        }
+        fmt::print(stderr, "正在运行：{0}\n", name);
+        JsonObject result;
+        result["name"] = name;
+        result["result"] = it->second();
+        results.emplace_back(std::move(result));
+    }
+
+    fmt::print("{0}\n", boost::json::serialize(results));
+    return 0;
+}
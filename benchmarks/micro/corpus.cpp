@@ -0,0 +1,58 @@
+#include <edgelink/edgelink.hpp>
+#include "corpus.hpp"
+
+namespace edgelink::microbench {
+
+namespace {
+
+constexpr std::array<const char*, 4> UNITS{"degC", "kPa", "m3/h", "V"};
+
+JsonValue generate_payload(size_t bytes) {
+    std::mt19937_64 rng(CORPUS_SEED);
+    std::uniform_real_distribution<double> value_dist(-1000.0, 1000.0);
+    std::uniform_int_distribution<int> quality_dist(0, 255);
+
+    JsonObject payload;
+    payload["device"] = fmt::format("dev-{0:08x}", rng() & 0xffffffff);
+    payload["seq"] = static_cast<int64_t>(rng() % 1000000);
+    auto& readings = payload["readings"].emplace_array();
+
+    // 逐条累计序列化后的长度，避免每加一条读数都把整个负载序列化一次
+    auto total = boost::json::serialize(payload).size();
+    do {
+        JsonObject reading;
+        reading["name"] = fmt::format("r{0}", readings.size());
+        reading["value"] = value_dist(rng);
+        reading["meta"] = JsonObject{{"unit", UNITS[rng() % UNITS.size()]}, {"quality", quality_dist(rng)}};
+        total += boost::json::serialize(reading).size() + (readings.empty() ? 0 : 1);
+        readings.emplace_back(std::move(reading));
+    } while (total < bytes);
+    return payload;
+}
+
+}; // namespace
+
+const JsonValue& payload_corpus(size_t bytes) {
+    static std::map<size_t, JsonValue> cache;
+    auto it = cache.find(bytes);
+    if (it == cache.end()) {
+        it = cache.emplace(bytes, generate_payload(bytes)).first;
+    }
+    return it->second;
+}
+
+std::shared_ptr<Msg> make_corpus_msg(size_t bytes) {
+    auto msg = std::make_shared<Msg>();
+    msg->set_topic("bench/corpus");
+    msg->set_payload(JsonValue(payload_corpus(bytes)));
+    return msg;
+}
+
+void apply_corpus_sizes(benchmark::internal::Benchmark* b) {
+    b->ArgName("bytes");
+    for (auto size : CORPUS_SIZES) {
+        b->Arg(static_cast<int64_t>(size));
+    }
+}
+
+}; // namespace edgelink::microbench
@@ -0,0 +1,29 @@
+#pragma once
+
+namespace edgelink::microbench {
+
+/// @brief 生成语料所用的固定种子，保证每次运行、每台机器上的输入完全一样
+constexpr uint64_t CORPUS_SEED = 20240501;
+
+/// @brief 语料的三档尺寸：小消息、典型的设备报文、大块数据
+constexpr std::array<size_t, 3> CORPUS_SIZES{100, 5 * 1024, 500 * 1024};
+
+/// @brief 读取 `payload.device` 的浅层表达式
+constexpr char SHALLOW_PROPEX[] = "payload.device";
+
+/// @brief 读取第一条读数单位的深层表达式
+constexpr char DEEP_PROPEX[] = "payload.readings[0].meta.unit";
+
+/// @brief 序列化之后不小于 `bytes` 字节的负载，形如：
+/// `{"device": "...", "seq": n, "readings": [{"name": "...", "value": x, "meta": {"unit": "...", "quality": q}}, ...]}`
+///
+/// 同一尺寸总是返回同一份数据
+const JsonValue& payload_corpus(size_t bytes);
+
+/// @brief 以 `payload_corpus(bytes)` 为负载的消息
+std::shared_ptr<Msg> make_corpus_msg(size_t bytes);
+
+/// @brief 把所有语料尺寸作为参数添加到基准测试上，用法：`BENCHMARK(...)->Apply(apply_corpus_sizes)`
+void apply_corpus_sizes(benchmark::internal::Benchmark* b);
+
+}; // namespace edgelink::microbench
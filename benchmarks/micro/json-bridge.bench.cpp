@@ -0,0 +1,96 @@
+#include <edgelink/edgelink.hpp>
+#include "corpus.hpp"
+
+#include "../../src/flows/nodes/function/quickjs-bridge.hpp"
+
+using namespace edgelink;
+using namespace edgelink::microbench;
+
+namespace {
+
+/// @brief 与函数节点一样的调用方式：修改一个顶层属性之后把消息原样返回
+constexpr char USER_FUNC[] = "(function (msg) { msg.topic = 'bench/out'; return msg; })";
+
+constexpr std::array<std::pair<const char*, js::BridgeMode>, 3> BRIDGE_MODES{{
+    {"json", js::BridgeMode::JSON},
+    {"native", js::BridgeMode::NATIVE},
+    {"lazy", js::BridgeMode::LAZY},
+}};
+
+struct JsContext {
+    JsContext() : rt(JS_NewRuntime()), ctx(JS_NewContext(rt)) {}
+    ~JsContext() {
+        JS_FreeContext(ctx);
+        JS_FreeRuntime(rt);
+    }
+
+    JSRuntime* rt;
+    JSContext* ctx;
+};
+
+void apply_modes_and_sizes(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"mode", "bytes"});
+    for (size_t mode = 0; mode < BRIDGE_MODES.size(); mode++) {
+        for (auto size : CORPUS_SIZES) {
+            b->Args({static_cast<int64_t>(mode), static_cast<int64_t>(size)});
+        }
+    }
+}
+
+/// @brief 基线：Boost.JSON 的序列化加解析
+void BM_JsonRoundTrip(benchmark::State& state) {
+    auto bytes = static_cast<size_t>(state.range(0));
+    auto const& payload = payload_corpus(bytes);
+    for (auto _ : state) {
+        auto parsed = boost::json::parse(boost::json::serialize(payload));
+        benchmark::DoNotOptimize(parsed);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+}
+BENCHMARK(BM_JsonRoundTrip)->Apply(apply_corpus_sizes);
+
+/// @brief 消息进入脚本再原样转换回来，不执行用户代码
+void BM_BridgeRoundTrip(benchmark::State& state) {
+    auto const& [mode_name, mode] = BRIDGE_MODES.at(static_cast<size_t>(state.range(0)));
+    auto bytes = static_cast<size_t>(state.range(1));
+    state.SetLabel(mode_name);
+    JsContext js;
+    auto msg = make_corpus_msg(bytes);
+    for (auto _ : state) {
+        js::MsgBridge bridge(js.ctx, mode);
+        JSValue value = bridge.wrap(*msg);
+        auto result = bridge.unwrap(value, {});
+        JS_FreeValue(js.ctx, value);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+}
+BENCHMARK(BM_BridgeRoundTrip)->Apply(apply_modes_and_sizes);
+
+/// @brief 与函数节点相同的完整路径：转换、调用脚本、转换回 JSON
+void BM_FunctionBridgeCall(benchmark::State& state) {
+    auto const& [mode_name, mode] = BRIDGE_MODES.at(static_cast<size_t>(state.range(0)));
+    auto bytes = static_cast<size_t>(state.range(1));
+    state.SetLabel(mode_name);
+    JsContext js;
+    JSValue func = JS_Eval(js.ctx, USER_FUNC, sizeof(USER_FUNC) - 1, "<bench>", JS_EVAL_TYPE_GLOBAL);
+    if (JS_IsException(func)) {
+        state.SkipWithError(js::take_exception_message(js.ctx).c_str());
+        return;
+    }
+    auto msg = make_corpus_msg(bytes);
+    for (auto _ : state) {
+        js::MsgBridge bridge(js.ctx, mode);
+        JSValue arg = bridge.wrap(*msg);
+        JSValue ret = JS_Call(js.ctx, func, JS_UNDEFINED, 1, &arg);
+        auto result = bridge.unwrap(ret, {});
+        JS_FreeValue(js.ctx, ret);
+        JS_FreeValue(js.ctx, arg);
+        benchmark::DoNotOptimize(result);
+    }
+    JS_FreeValue(js.ctx, func);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+}
+BENCHMARK(BM_FunctionBridgeCall)->Apply(apply_modes_and_sizes);
+
+}; // namespace
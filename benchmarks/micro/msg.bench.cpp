@@ -0,0 +1,67 @@
+#include <edgelink/edgelink.hpp>
+#include "corpus.hpp"
+
+using namespace edgelink;
+using namespace edgelink::microbench;
+
+namespace {
+
+void BM_MsgClone(benchmark::State& state) {
+    auto bytes = static_cast<size_t>(state.range(0));
+    auto msg = make_corpus_msg(bytes);
+    for (auto _ : state) {
+        auto cloned = msg->clone();
+        benchmark::DoNotOptimize(cloned);
+    }
+}
+BENCHMARK(BM_MsgClone)->Apply(apply_corpus_sizes);
+
+/// @brief 克隆之后改写负载，触发写时复制，等价于旧的深复制克隆
+void BM_MsgCloneThenWrite(benchmark::State& state) {
+    auto bytes = static_cast<size_t>(state.range(0));
+    auto msg = make_corpus_msg(bytes);
+    for (auto _ : state) {
+        auto cloned = msg->clone();
+        cloned->payload().as_object()["seq"] = 0;
+        benchmark::DoNotOptimize(cloned);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+}
+BENCHMARK(BM_MsgCloneThenWrite)->Apply(apply_corpus_sizes);
+
+template <const char* EXPR> void BM_MsgAtPropex(benchmark::State& state) {
+    auto msg = make_corpus_msg(static_cast<size_t>(state.range(0)));
+    const Msg& cmsg = *msg;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(&cmsg.at_propex(EXPR));
+    }
+}
+BENCHMARK_TEMPLATE(BM_MsgAtPropex, SHALLOW_PROPEX)->Name("BM_MsgAtPropex/shallow")->Apply(apply_corpus_sizes);
+BENCHMARK_TEMPLATE(BM_MsgAtPropex, DEEP_PROPEX)->Name("BM_MsgAtPropex/deep")->Apply(apply_corpus_sizes);
+
+/// @brief 使用预先编译好的属性路径，不经过 `propex::intern` 的查表
+template <const char* EXPR> void BM_MsgAtPropexCompiled(benchmark::State& state) {
+    auto msg = make_corpus_msg(static_cast<size_t>(state.range(0)));
+    const Msg& cmsg = *msg;
+    auto path = propex::intern(EXPR);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(&cmsg.at_propex(*path));
+    }
+}
+BENCHMARK_TEMPLATE(BM_MsgAtPropexCompiled, SHALLOW_PROPEX)
+    ->Name("BM_MsgAtPropexCompiled/shallow")
+    ->Apply(apply_corpus_sizes);
+BENCHMARK_TEMPLATE(BM_MsgAtPropexCompiled, DEEP_PROPEX)->Name("BM_MsgAtPropexCompiled/deep")->Apply(apply_corpus_sizes);
+
+void BM_MsgToString(benchmark::State& state) {
+    auto bytes = static_cast<size_t>(state.range(0));
+    auto msg = make_corpus_msg(bytes);
+    for (auto _ : state) {
+        auto text = msg->to_string();
+        benchmark::DoNotOptimize(text);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+}
+BENCHMARK(BM_MsgToString)->Apply(apply_corpus_sizes);
+
+}; // namespace
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <edgelink/pch.hpp>
+
+#include <random>
+
+#include <benchmark/benchmark.h>
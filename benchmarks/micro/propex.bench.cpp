@@ -0,0 +1,68 @@
+#include <edgelink/edgelink.hpp>
+#include "corpus.hpp"
+
+using namespace edgelink;
+using namespace edgelink::microbench;
+
+namespace {
+
+/// @brief `evaluate_property_value` 只需要节点的引用，这里给一个什么也不做的节点
+class NullNode final : public INode {
+  public:
+    const std::string_view id() const override { return "micro-bench"; }
+    const bool is_disabled() const override { return false; }
+    Awaitable<void> async_start() override { co_return; }
+    Awaitable<void> async_stop() override { co_return; }
+    const std::string_view name() const override { return "micro-bench"; }
+    const std::string_view type() const override { return "micro-bench"; }
+    const INodeDescriptor* descriptor() const override { return nullptr; }
+};
+
+struct PropertyValueCase {
+    const char* type;
+    const char* value;
+};
+
+/// @brief `evaluate_property_value` 已经实现的每一种类型
+constexpr std::array<PropertyValueCase, 7> PROPERTY_VALUE_CASES{{
+    {"str", "hello, world"},
+    {"num", "3.14159"},
+    {"json", R"({"a": 1, "b": [1, 2, 3], "c": {"d": "e"}})"},
+    {"bool", "true"},
+    {"date", ""},
+    {"bin", "[1, 2, 3, 4, 5, 6, 7, 8]"},
+    {"msg", "payload.readings[0].value"},
+}};
+
+template <const char* EXPR> void BM_PropexParse(benchmark::State& state) {
+    for (auto _ : state) {
+        auto segments = propex::parse(EXPR);
+        benchmark::DoNotOptimize(segments);
+    }
+}
+BENCHMARK_TEMPLATE(BM_PropexParse, SHALLOW_PROPEX)->Name("BM_PropexParse/shallow");
+BENCHMARK_TEMPLATE(BM_PropexParse, DEEP_PROPEX)->Name("BM_PropexParse/deep");
+
+template <const char* EXPR> void BM_PropexIntern(benchmark::State& state) {
+    for (auto _ : state) {
+        auto path = propex::intern(EXPR);
+        benchmark::DoNotOptimize(path);
+    }
+}
+BENCHMARK_TEMPLATE(BM_PropexIntern, SHALLOW_PROPEX)->Name("BM_PropexIntern/shallow");
+BENCHMARK_TEMPLATE(BM_PropexIntern, DEEP_PROPEX)->Name("BM_PropexIntern/deep");
+
+void BM_EvaluatePropertyValue(benchmark::State& state) {
+    auto const& c = PROPERTY_VALUE_CASES.at(static_cast<size_t>(state.range(0)));
+    state.SetLabel(c.type);
+    NullNode node;
+    auto msg = make_corpus_msg(CORPUS_SIZES.front());
+    const JsonValue value(c.value);
+    for (auto _ : state) {
+        auto result = propex::evaluate_property_value(value, c.type, node, *msg);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_EvaluatePropertyValue)->ArgName("case")->DenseRange(0, PROPERTY_VALUE_CASES.size() - 1);
+
+}; // namespace
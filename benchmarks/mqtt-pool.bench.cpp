@@ -0,0 +1,250 @@
+#include <async_mqtt/all.hpp>
+#include <edgelink/edgelink.hpp>
+#include "bench.hpp"
+
+#include "../plugins/mqtt/src/mqtt.hpp"
+#include "../plugins/mqtt/src/topic-trie.hpp"
+#include "../plugins/mqtt/src/topic-alias.hpp"
+#include "../plugins/mqtt/src/mqtt-connection.hpp"
+
+using namespace edgelink;
+using namespace edgelink::plugins::mqtt;
+
+namespace {
+
+namespace asio = boost::asio;
+using asio::ip::tcp;
+
+constexpr size_t TOPIC_COUNT = 64;  ///< 每个主题一个发布协程，主题内的消息按顺序发布
+constexpr size_t MSG_COUNT = 20000; ///< 所有主题发布的消息总数
+constexpr size_t PAYLOAD_SIZE = 128;
+constexpr unsigned int CLIENT_THREADS = 4;
+
+/// @brief broker 处理一条 PUBLISH 的时间，同一连接上的消息串行处理，模拟 broker 对单个客户端的处理能力上限
+constexpr std::chrono::microseconds SERVICE_TIME{20};
+
+/// @brief 本地的 MQTT broker 替身：应答 CONNECT 和 QoS1 PUBLISH，每个连接使用一个线程
+class LocalBroker {
+  public:
+    LocalBroker() : _acceptor(_io, tcp::endpoint(asio::ip::address_v4::loopback(), 0)) {
+        _accept_thread = std::thread([this] { this->accept_loop(); });
+    }
+
+    ~LocalBroker() {
+        // 阻塞中的 accept 不会因为关闭监听 socket 而返回，连一次把它唤醒
+        _stopping = true;
+        tcp::socket wakeup(_io);
+        boost::system::error_code ec;
+        wakeup.connect(_acceptor.local_endpoint(), ec);
+        _accept_thread.join();
+        for (auto& thread : _session_threads) {
+            thread.join();
+        }
+    }
+
+    uint16_t port() const { return _acceptor.local_endpoint().port(); }
+
+  private:
+    void accept_loop() {
+        for (;;) {
+            tcp::socket socket(_io);
+            boost::system::error_code ec;
+            _acceptor.accept(socket, ec);
+            if (ec || _stopping) {
+                return;
+            }
+            socket.set_option(tcp::no_delay(true));
+            _session_threads.emplace_back([socket = std::move(socket)]() mutable { serve(std::move(socket)); });
+        }
+    }
+
+    /// @brief 按固定报头和剩余长度切分报文，只解析应答需要的字段
+    static void serve(tcp::socket socket) {
+        std::vector<uint8_t> buffer;
+        size_t begin = 0;
+        auto fill = [&](size_t needed) {
+            while (buffer.size() - begin < needed) {
+                std::array<uint8_t, 64 * 1024> chunk;
+                boost::system::error_code ec;
+                auto n = socket.read_some(asio::buffer(chunk), ec);
+                if (ec) {
+                    return false;
+                }
+                buffer.erase(buffer.begin(), buffer.begin() + begin);
+                begin = 0;
+                buffer.insert(buffer.end(), chunk.begin(), chunk.begin() + n);
+            }
+            return true;
+        };
+
+        for (;;) {
+            if (!fill(2)) {
+                return;
+            }
+            // 剩余长度是变长整数，最多 4 个字节
+            size_t remaining = 0;
+            size_t header_size = 1;
+            for (size_t shift = 0;; shift += 7) {
+                if (!fill(header_size + 1)) {
+                    return;
+                }
+                auto const byte = buffer[begin + header_size++];
+                remaining |= static_cast<size_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0) {
+                    break;
+                }
+            }
+            if (!fill(header_size + remaining)) {
+                return;
+            }
+            auto const type = buffer[begin];
+            auto const* body = buffer.data() + begin + header_size;
+            begin += header_size + remaining;
+
+            boost::system::error_code ec;
+            switch (type >> 4) {
+            case 1: { // CONNECT
+                const std::array<uint8_t, 4> connack{0x20, 0x02, 0x00, 0x00};
+                asio::write(socket, asio::buffer(connack), ec);
+                break;
+            }
+            case 3: { // PUBLISH
+                auto const deadline = std::chrono::steady_clock::now() + SERVICE_TIME;
+                while (std::chrono::steady_clock::now() < deadline) {
+                    // 忙等，sleep 的精度不够
+                }
+                if (((type >> 1) & 0x03) == 1) {
+                    auto const topic_size = static_cast<size_t>(body[0] << 8 | body[1]);
+                    const std::array<uint8_t, 4> puback{0x40, 0x02, body[2 + topic_size], body[3 + topic_size]};
+                    asio::write(socket, asio::buffer(puback), ec);
+                }
+                break;
+            }
+            case 12: { // PINGREQ
+                const std::array<uint8_t, 2> pingresp{0xD0, 0x00};
+                asio::write(socket, asio::buffer(pingresp), ec);
+                break;
+            }
+            case 14: // DISCONNECT
+                return;
+            default:
+                break;
+            }
+            if (ec) {
+                return;
+            }
+        }
+    }
+
+  private:
+    asio::io_context _io;
+    tcp::acceptor _acceptor;
+    std::atomic<bool> _stopping = false;
+    std::thread _accept_thread;
+    std::vector<std::thread> _session_threads; ///< 只在接受连接的线程里修改，析构时该线程已经退出
+};
+
+/// @brief 与 broker 节点相同的分片方式：同一主题总是走同一个连接
+MqttConnection& connection_for(std::vector<std::shared_ptr<MqttConnection>>& connections,
+                               const std::string_view topic) {
+    return *connections[std::hash<std::string_view>{}(topic) % connections.size()];
+}
+
+/// @brief 按顺序发布一个主题的消息，每条都等到 PUBACK 再发下一条，记录每条的延迟
+Awaitable<void> publish_topic(MqttConnection& connection, std::string topic, async_mqtt::buffer payload,
+                              std::vector<double>& samples) {
+    samples.reserve(MSG_COUNT / TOPIC_COUNT);
+    for (size_t i = 0; i < MSG_COUNT / TOPIC_COUNT; i++) {
+        bench::Stopwatch sw;
+        co_await connection.async_publish(topic, payload, async_mqtt::qos::at_least_once, nullptr);
+        samples.push_back(sw.elapsed_ns() / 1e3);
+    }
+}
+
+JsonObject measure(unsigned int pool_size) {
+    LocalBroker broker;
+
+    asio::io_context io(CLIENT_THREADS);
+    auto logger = spdlog::default_logger()->clone("bench-mqtt-pool");
+    logger->set_level(spdlog::level::warn);
+
+    std::vector<std::shared_ptr<MqttConnection>> connections;
+    for (unsigned int i = 0; i < pool_size; i++) {
+        MqttConnectionOptions options{
+            .host = "127.0.0.1",
+            .port = broker.port(),
+            .client_id = fmt::format("bench-{0}", i),
+        };
+        connections.push_back(std::make_shared<MqttConnection>(std::move(options), logger, nullptr, nullptr));
+        connections.back()->bind_executor(asio::make_strand(io));
+    }
+
+    auto work = asio::make_work_guard(io);
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < CLIENT_THREADS; i++) {
+        threads.emplace_back([&io] { io.run(); });
+    }
+
+    for (auto& connection : connections) {
+        asio::co_spawn(connection->executor(), connection->async_start(), asio::use_future).get();
+    }
+
+    auto const payload = async_mqtt::allocate_buffer(std::string(PAYLOAD_SIZE, 'x'));
+    std::vector<std::vector<double>> latencies(TOPIC_COUNT);
+    std::vector<std::future<void>> publishers;
+    bench::Stopwatch total;
+    for (size_t t = 0; t < TOPIC_COUNT; t++) {
+        auto topic = fmt::format("bench/pool/sensor-{0}", t);
+        auto& connection = connection_for(connections, topic);
+        publishers.push_back(asio::co_spawn(asio::make_strand(io),
+                                            publish_topic(connection, std::move(topic), payload, latencies[t]),
+                                            asio::use_future));
+    }
+    for (auto& publisher : publishers) {
+        publisher.get();
+    }
+    auto const elapsed_ns = total.elapsed_ns();
+
+    JsonArray per_connection;
+    for (auto& connection : connections) {
+        per_connection.emplace_back(connection->stats().to_json());
+        asio::co_spawn(connection->executor(), connection->async_stop(), asio::use_future).get();
+    }
+    // 连接关闭以后读取协程退出，`io.run()` 随之返回
+    work.reset();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<double> all;
+    for (auto const& samples : latencies) {
+        all.insert(all.end(), samples.begin(), samples.end());
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p) { return all[static_cast<size_t>(p * (all.size() - 1))]; };
+
+    JsonObject result;
+    result["connections"] = pool_size;
+    result["msgs_per_sec"] = all.size() / (elapsed_ns / 1e9);
+    result["p50_us"] = percentile(0.50);
+    result["p99_us"] = percentile(0.99);
+    result["per_connection"] = std::move(per_connection);
+    return result;
+}
+
+}; // namespace
+
+/// 主题按哈希分到 1、2、4 个连接上，比较吞吐量和发布延迟；broker 替身对每个连接串行处理，
+/// 所以单连接的吞吐量受 `SERVICE_TIME` 限制，连接池能把负载摊到多个连接上
+EL_BENCH("mqtt-pool") {
+    JsonObject result;
+    result["topics"] = TOPIC_COUNT;
+    result["messages"] = MSG_COUNT;
+    result["service_time_us"] = SERVICE_TIME.count();
+    JsonArray runs;
+    for (unsigned int pool_size : {1U, 2U, 4U}) {
+        runs.emplace_back(measure(pool_size));
+    }
+    result["runs"] = std::move(runs);
+    return result;
+}
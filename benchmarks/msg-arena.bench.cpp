@@ -0,0 +1,77 @@
+#include <edgelink/edgelink.hpp>
+#include "bench.hpp"
+
+using namespace edgelink;
+
+namespace {
+
+constexpr char PAYLOAD_JSON[] = R"(
+    {
+        "device": "plc-01",
+        "timestamp": 1700000000123,
+        "quality": "good",
+        "hostInfo": { "cpuLoad": 0.9, "memoryUsage": 300, "memoryTotal": 2048, "uptime": 123456 },
+        "tags": [
+            { "name": "temperature", "value": 21.5, "unit": "C" },
+            { "name": "humidity", "value": 40.1, "unit": "%" },
+            { "name": "pressure", "value": 1013.2, "unit": "hPa" },
+            { "name": "flow", "value": 12.75, "unit": "m3/h" },
+            { "name": "level", "value": 3.2, "unit": "m" },
+            { "name": "speed", "value": 1450, "unit": "rpm" }
+        ]
+    }
+)";
+
+constexpr size_t MSG_COUNT = 100000;
+
+/// @brief 模拟一条消息在流程里的生命周期：创建、填充、扇出克隆、修改一个克隆、全部释放
+JsonObject run_msg_lifecycle(MsgArenaPool* pool, std::shared_ptr<MsgArenaHistogram> histogram) {
+    const auto payload_text = std::string_view(PAYLOAD_JSON);
+
+    auto round = [&] {
+        auto storage = pool != nullptr ? pool->acquire(histogram) : boost::json::storage_ptr();
+        auto msg = std::make_shared<Msg>(std::move(storage), nullptr);
+        msg->set_payload(boost::json::parse(payload_text, msg->storage()));
+        msg->set_topic("/plant/line1/plc-01/telemetry");
+        msg->insert_or_assign("qos", 1);
+        msg->insert_or_assign("retain", false);
+
+        auto fanout = msg->clone();
+        msg->at_propex("payload.hostInfo.cpuLoad") = 0.5;
+        msg->at_propex("payload.quality") = "bad";
+    };
+
+    // 预热，让直方图和空闲链表进入稳定状态
+    for (size_t i = 0; i < 1000; i++) {
+        round();
+    }
+
+    auto before = bench::alloc_stats();
+    bench::Stopwatch sw;
+    for (size_t i = 0; i < MSG_COUNT; i++) {
+        round();
+    }
+    auto elapsed = sw.elapsed_ns();
+    auto after = bench::alloc_stats();
+
+    JsonObject result;
+    result["allocs_per_msg"] = static_cast<double>(after.count - before.count) / MSG_COUNT;
+    result["bytes_per_msg"] = static_cast<double>(after.bytes - before.bytes) / MSG_COUNT;
+    result["ns_per_msg"] = elapsed / MSG_COUNT;
+    return result;
+}
+
+}; // namespace
+
+EL_BENCH("msg-arena") {
+    JsonObject result;
+    result["msg_count"] = MSG_COUNT;
+    result["heap"] = run_msg_lifecycle(nullptr, nullptr);
+
+    auto pool = std::make_shared<MsgArenaPool>();
+    auto histogram = std::make_shared<MsgArenaHistogram>();
+    auto arena_result = run_msg_lifecycle(pool.get(), histogram);
+    arena_result["suggested_arena_size"] = histogram->suggest_size();
+    result["arena"] = std::move(arena_result);
+    return result;
+}
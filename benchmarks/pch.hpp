@@ -0,0 +1,5 @@
+#pragma once
+
+#include <edgelink/pch.hpp>
+
+#include <numeric>
@@ -0,0 +1,83 @@
+#include <edgelink/edgelink.hpp>
+#include "bench.hpp"
+
+#include "../src/flows/nodes/function/range-kernels.hpp"
+
+using namespace edgelink;
+using namespace edgelink::kernels;
+
+namespace {
+
+constexpr size_t ROUNDS = 2000;
+
+/// @brief 改造之前的做法：在 JSON 数组上逐个元素取值、计算、写回
+void map_json_per_element(JsonArray& array, const RangeParams& params) {
+    for (auto& elem : array) {
+        elem = range_map_one(elem.to_number<double>(), params);
+    }
+}
+
+JsonObject measure(size_t samples, RangeAction action, bool round) {
+    const RangeParams params{
+        .minin = 0, .maxin = 4095, .minout = -10, .maxout = 10, .action = action, .round = round};
+
+    std::mt19937_64 rng(20240501);
+    std::uniform_real_distribution<double> dist(-100, 4200);
+    std::vector<double> source(samples);
+    for (auto& v : source) {
+        v = dist(rng);
+    }
+
+    auto time_per_sample = [&](auto&& func) {
+        std::vector<double> values;
+        bench::Stopwatch sw;
+        for (size_t r = 0; r < ROUNDS; r++) {
+            values = source;
+            func(values);
+        }
+        return sw.elapsed_ns() / static_cast<double>(ROUNDS * samples);
+    };
+
+    JsonArray json_source(source.begin(), source.end());
+    bench::Stopwatch json_sw;
+    for (size_t r = 0; r < ROUNDS; r++) {
+        auto array = json_source;
+        map_json_per_element(array, params);
+    }
+    auto json_ns = json_sw.elapsed_ns() / static_cast<double>(ROUNDS * samples);
+
+    auto scalar_ns = time_per_sample([&](std::vector<double>& v) { range_map_scalar(v, params); });
+    auto kernel_ns = time_per_sample([&](std::vector<double>& v) { range_map(v, params); });
+
+    JsonObject result;
+    result["samples"] = samples;
+    result["round"] = round;
+    result["json_per_element_ns_per_sample"] = json_ns;
+    result["scalar_ns_per_sample"] = scalar_ns;
+    result["vectorized_ns_per_sample"] = kernel_ns;
+    result["speedup_vs_scalar"] = scalar_ns / kernel_ns;
+    return result;
+}
+
+}; // namespace
+
+EL_BENCH("range-kernels") {
+    JsonObject result;
+    result["kernel"] = range_kernel_name();
+
+    const std::array<std::pair<const char*, RangeAction>, 3> actions{{
+        {"scale", RangeAction::SCALE},
+        {"clamp", RangeAction::CLAMP},
+        {"roll", RangeAction::ROLL},
+    }};
+    for (auto const& [name, action] : actions) {
+        JsonArray runs;
+        for (size_t samples : {1024, 4096}) {
+            for (bool round : {false, true}) {
+                runs.emplace_back(measure(samples, action, round));
+            }
+        }
+        result[name] = std::move(runs);
+    }
+    return result;
+}
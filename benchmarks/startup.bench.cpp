@@ -0,0 +1,77 @@
+#include <edgelink/edgelink.hpp>
+#include "bench.hpp"
+#include "flows-generator.hpp"
+
+#include "../src/flows/engine.hpp"
+#include "../src/flows/flow-factory.hpp"
+#include "../src/flows/registry.hpp"
+
+using namespace edgelink;
+using namespace edgelink::bench;
+
+namespace {
+
+constexpr size_t ROUNDS = 5;
+
+/// @brief 测量从解析好的 `flows.json` 到创建完所有流程和节点（不启动）所需的时间
+JsonObject measure(const FlowsSpec& spec, IEngine& engine, const flows::FlowFactory& flow_factory) {
+    auto const flows_config = generate_flows(spec);
+
+    double index_ns = 0, create_ns = 0;
+    size_t node_count = 0;
+    for (size_t r = 0; r < ROUNDS; r++) {
+        Stopwatch index_sw;
+        const FlowConfigIndex index(flows_config);
+        index_ns += index_sw.elapsed_ns();
+
+        Stopwatch create_sw;
+        auto global_nodes = flow_factory.create_global_nodes(index, &engine);
+        auto flows = flow_factory.create_flows(index, &engine);
+        create_ns += create_sw.elapsed_ns();
+        node_count = index.size() - index.flows().size();
+    }
+
+    JsonObject result;
+    result["topology"] = topology_name(spec.topology);
+    result["size"] = spec.size;
+    result["flows"] = spec.flow_count;
+    result["nodes"] = node_count;
+    result["index_ms"] = index_ns / ROUNDS / 1e6;
+    result["create_ms"] = create_ns / ROUNDS / 1e6;
+    result["us_per_node"] = (index_ns + create_ns) / ROUNDS / 1e3 / node_count;
+    return result;
+}
+
+}; // namespace
+
+EL_BENCH("startup") {
+    // 创建节点时的 info 日志会淹没计时结果
+    spdlog::set_level(spdlog::level::err);
+
+    const EdgeLinkSettings settings{
+        .home_path = std::filesystem::temp_directory_path(),
+        .executable_location = std::filesystem::temp_directory_path(),
+        .flows_json_path = "",
+    };
+    Registry registry(settings);
+    flows::FlowFactory flow_factory(registry);
+    Engine engine(settings, flow_factory);
+
+    // 一个很长的流程，以及很多个小流程（旧的实现每个流程都要扫描一遍整个配置）
+    const std::array<FlowsSpec, 4> specs{{
+        {.topology = Topology::LINEAR, .size = 1000, .msg_count = 0},
+        {.topology = Topology::LINEAR, .size = 4000, .msg_count = 0},
+        {.topology = Topology::LINEAR, .size = 40, .msg_count = 0, .flow_count = 100},
+        {.topology = Topology::DIAMOND, .size = 20, .msg_count = 0, .flow_count = 200},
+    }};
+
+    JsonArray runs;
+    for (auto const& spec : specs) {
+        runs.emplace_back(measure(spec, engine, flow_factory));
+    }
+    spdlog::set_level(spdlog::level::warn);
+
+    JsonObject result;
+    result["runs"] = std::move(runs);
+    return result;
+}
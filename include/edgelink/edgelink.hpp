@@ -7,10 +7,17 @@
 #include "json.hpp"
 #include "propex.hpp"
 #include "settings.hpp"
+#include "segment-log.hpp"
 
 #include "flows/common.hpp"
 #include "flows/msg.hpp"
+#include "flows/msg-batch.hpp"
+#include "flows/msg-arena.hpp"
+#include "flows/hooks.hpp"
+#include "flows/flow-config-index.hpp"
 #include "flows/abstractions.hpp"
+#include "flows/mailbox.hpp"
+#include "flows/metrics.hpp"
 #include "flows/engine.hpp"
 #include "flows/registry.hpp"
 #include "flows/engine.hpp"
@@ -13,6 +13,9 @@ struct IStandaloneNode;
 struct Envelope;
 class OutputPort;
 
+/// @brief 节点和流程用来串行化自身状态的 strand
+using Strand = boost::asio::strand<boost::asio::any_io_executor>;
+
 /// @brief 数据处理上下文
 class EDGELINK_EXPORT FlowContext {
 
@@ -28,24 +31,40 @@ class EDGELINK_EXPORT FlowContext {
 };
 
 /// @brief 路由中的消息封装
-struct EDGELINK_EXPORT Envelope : private boost::noncopyable {
+///
+/// 信封是值类型，发送时直接放在发送方的协程帧里，不单独分配
+struct EDGELINK_EXPORT Envelope {
     MsgPtr msg;
+    MsgBatchPtr batch; ///< 批量消息，此时 `msg` 为空
     bool clone_message;
     IFlowNode* source_node = nullptr;
     const OutputPort* source_port = nullptr;
     IFlowNode* destination_node = nullptr;
 
     /// @brief 构造函数，用于初始化所有成员，并指定源信息
-    Envelope(MsgPtr message, bool clone, const std::string_view& src_id, IFlowNode* src_node,
-             const OutputPort* src_port, const std::string_view& dest_id, IFlowNode* dest_node)
-        : msg(message), clone_message(clone), source_node(src_node), source_port(src_port),
+    Envelope(MsgPtr message, bool clone, IFlowNode* src_node, const OutputPort* src_port, IFlowNode* dest_node)
+        : msg(std::move(message)), clone_message(clone), source_node(src_node), source_port(src_port),
+          destination_node(dest_node) {}
+
+    Envelope(MsgBatchPtr msg_batch, bool clone, IFlowNode* src_node, const OutputPort* src_port,
+             IFlowNode* dest_node)
+        : batch(std::move(msg_batch)), clone_message(clone), source_node(src_node), source_port(src_port),
           destination_node(dest_node) {}
+
+    /// @brief 信封里的样本数，普通消息为 1
+    size_t sample_count() const { return batch ? batch->size() : 1; }
+
+    Envelope(Envelope&&) = default;
+    Envelope& operator=(Envelope&&) = default;
+    Envelope(const Envelope&) = delete;
+    Envelope& operator=(const Envelope&) = delete;
 };
 
-using FlowOnSendEvent = boost::signals2::signal<void(IFlow* sender, std::vector<std::unique_ptr<Envelope>>& env)>;
-using FlowPreRouteEvent = boost::signals2::signal<void(IFlow* sender, Envelope* env)>;
-using FlowPreDeliverEvent = boost::signals2::signal<void(IFlow* sender, Envelope* env)>;
-using FlowPostDeliverEvent = boost::signals2::signal<void(IFlow* sender, Envelope* env)>;
+// 这几个钩子在每条消息的投递路径上触发，没有订阅者的时候只有一次分支判断
+using FlowOnSendEvent = Hook<void(IFlow* sender, std::span<Envelope> envelopes)>;
+using FlowPreRouteEvent = Hook<void(IFlow* sender, Envelope* env)>;
+using FlowPreDeliverEvent = Hook<void(IFlow* sender, Envelope* env)>;
+using FlowPostDeliverEvent = Hook<void(IFlow* sender, Envelope* env)>;
 
 using NodeOnReceiveEvent = boost::signals2::signal<Awaitable<void>(IFlowNode* sender, MsgPtr msg)>;
 using NodePostReceiveEvent = boost::signals2::signal<Awaitable<void>(IFlowNode* sender, MsgPtr msg)>;
@@ -54,6 +73,7 @@ using OnErrorEvent = boost::signals2::signal<Awaitable<void>(IFlow* sender, MsgP
 
 /// @brief 消息流
 struct EDGELINK_EXPORT IFlow {
+    virtual ~IFlow() = default;
 
     virtual FlowOnSendEvent& on_send_event() = 0;
     virtual FlowPreRouteEvent& on_pre_route_event() = 0;
@@ -65,10 +85,25 @@ struct EDGELINK_EXPORT IFlow {
     virtual bool is_disabled() const = 0;
     virtual IEngine* engine() const = 0;
 
-    virtual Awaitable<void> async_send_many(std::vector<std::unique_ptr<Envelope>>&& envelopes) = 0;
+    /// @brief 按路由表发送节点的输出
+    /// @param source 发送消息的节点
+    /// @param msgs 第 i 个消息发往第 i 个输出端口，空指针表示该端口不发送
+    virtual Awaitable<void> async_send_many(IFlowNode* source, std::span<const MsgPtr> msgs) = 0;
+
+    /// @brief 把批量消息发往节点的一个输出端口
+    virtual Awaitable<void> async_send_batch(IFlowNode* source, size_t port, MsgBatchPtr batch) = 0;
 
     virtual IFlowNode* get_node(const std::string_view id) const = 0;
 
+    /// @brief 绑定线程池的执行器，为流程和其中的节点创建 strand，必须在启动之前调用
+    virtual void bind_executor(const boost::asio::any_io_executor& executor) = 0;
+
+    /// @brief 流程自身的 strand，流程的启动在其中串行执行
+    virtual boost::asio::any_io_executor executor() const = 0;
+
+    /// @brief 为本流程中新建的消息创建存储，没有启用 arena 的时候返回默认的堆存储
+    virtual boost::json::storage_ptr create_msg_storage() = 0;
+
     /// @brief 启动流
     /// @return
     virtual Awaitable<void> async_start() = 0;
@@ -90,11 +125,20 @@ struct EDGELINK_EXPORT IFlow {
 /// @brief 流工厂
 struct EDGELINK_EXPORT IFlowFactory {
 
-    virtual std::vector<std::unique_ptr<IFlow>> create_flows(const boost::json::array& flows_config,
-                                                             IEngine* engine) const = 0;
+    /// @brief 按照已经建立好的配置索引创建所有流程，引擎加载时只建立一次索引
+    virtual std::vector<std::unique_ptr<IFlow>> create_flows(const FlowConfigIndex& index, IEngine* engine) const = 0;
 
-    virtual std::vector<std::unique_ptr<IStandaloneNode>> create_global_nodes(const boost::json::array& flows_config,
+    virtual std::vector<std::unique_ptr<IStandaloneNode>> create_global_nodes(const FlowConfigIndex& index,
                                                                               IEngine* engine) const = 0;
+
+    std::vector<std::unique_ptr<IFlow>> create_flows(const boost::json::array& flows_config, IEngine* engine) const {
+        return this->create_flows(FlowConfigIndex(flows_config), engine);
+    }
+
+    std::vector<std::unique_ptr<IStandaloneNode>> create_global_nodes(const boost::json::array& flows_config,
+                                                                      IEngine* engine) const {
+        return this->create_global_nodes(FlowConfigIndex(flows_config), engine);
+    }
 };
 
 /// @brief 节点的发出连接端口
@@ -111,6 +155,8 @@ class EDGELINK_EXPORT OutputPort {
 
 /// @brief 流程处理基础元素
 struct EDGELINK_EXPORT IFlowElement {
+    virtual ~IFlowElement() = default;
+
     virtual const std::string_view id() const = 0;
     virtual const bool is_disabled() const = 0;
     virtual Awaitable<void> async_start() = 0;
@@ -180,9 +226,25 @@ struct EDGELINK_EXPORT IFlowNode : public INode {
     virtual const std::vector<OutputPort>& output_ports() const = 0;
     virtual const size_t output_count() const = 0;
     virtual IFlow* flow() const = 0;
+
+    /// @brief 绑定线程池的执行器，由流程在启动之前调用，传入 strand 时节点与其他节点共用这个 strand
+    virtual void bind_executor(const boost::asio::any_io_executor& executor) = 0;
+
+    /// @brief 节点的执行器，节点的启动和消息的接收都在这里执行
+    virtual boost::asio::any_io_executor executor() const = 0;
+
+    /// @brief 节点同时处理的消息数上限，也就是从邮箱中取消息的协程数量
+    virtual size_t max_in_flight() const = 0;
+
+    /// @brief 节点是否并发接收消息，并发的节点没有自己的 strand，它发出的消息也可能并发
+    virtual bool is_concurrent() const = 0;
+
     virtual Awaitable<void> receive_async(MsgPtr msg) = 0;
     virtual Awaitable<void> async_send_to_one_port(MsgPtr msg) = 0;
     virtual Awaitable<void> async_send_to_many_port(std::vector<MsgPtr>&& msgs) = 0;
+
+    /// @brief 接收批量消息
+    virtual Awaitable<void> receive_batch_async(MsgBatchPtr batch) = 0;
 };
 
 /// @brief 流程节点基类
@@ -206,15 +268,34 @@ class EDGELINK_EXPORT FlowNode : public IFlowNode {
     const INodeDescriptor* descriptor() const override { return _descriptor; }
     IFlow* flow() const override { return _flow; }
 
+    void bind_executor(const boost::asio::any_io_executor& executor) override;
+    boost::asio::any_io_executor executor() const override;
+    size_t max_in_flight() const override { return 1; }
+
+    /// @brief 节点是否允许并发接收消息
+    ///
+    /// 默认情况下每个节点都有自己的 strand，同一个节点的消息依次处理，节点状态不需要加锁。
+    /// 返回 true 的节点直接在线程池上执行，需要自行保证线程安全。
+    bool is_concurrent() const override { return false; }
+
     Awaitable<void> receive_async(MsgPtr msg) override;
 
     Awaitable<void> async_send_to_one_port(MsgPtr msg) override;
 
     Awaitable<void> async_send_to_many_port(std::vector<MsgPtr>&& msgs) override;
 
+    /// @brief 默认把批量消息逐条展开交给 `receive_async`，能够按列处理的节点应当重写它
+    Awaitable<void> receive_batch_async(MsgBatchPtr batch) override;
+
+    /// @brief 把批量消息发往指定的输出端口
+    Awaitable<void> async_send_batch(MsgBatchPtr batch, size_t port = 0);
+
   protected:
     std::shared_ptr<spdlog::logger> logger() const { return _logger; };
 
+    /// @brief 线程池本身的执行器（不经过节点的 strand）
+    const boost::asio::any_io_executor& io_executor() const { return _io_executor; }
+
   private:
     std::shared_ptr<spdlog::logger> _logger;
     const std::string _id;
@@ -224,6 +305,8 @@ class EDGELINK_EXPORT FlowNode : public IFlowNode {
     IFlow* const _flow;
     const INodeDescriptor* _descriptor;
     const std::vector<OutputPort> _output_ports;
+    boost::asio::any_io_executor _io_executor;
+    std::optional<Strand> _strand;
 
   public:
     virtual Awaitable<void> async_start() = 0;
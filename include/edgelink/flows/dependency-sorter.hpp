@@ -31,8 +31,8 @@ template <typename T> class DependencySorter {
             T current = zero_in_degree_queue.front();
             zero_in_degree_queue.pop();
 
-            // 反向添加到结果向量
-            topological_order.insert(topological_order.begin(), current);
+            // 先按出队顺序追加，最后整体反转，避免在向量头部插入带来的 O(N²)
+            topological_order.push_back(current);
 
             for (const T& neighbor : adjacency_list[current]) {
                 in_degree[neighbor]--;
@@ -42,6 +42,7 @@ template <typename T> class DependencySorter {
             }
         }
 
+        std::reverse(topological_order.begin(), topological_order.end());
         return topological_order;
     }
 
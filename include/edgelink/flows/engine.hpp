@@ -4,6 +4,8 @@ namespace edgelink {
 
 struct IFlow;
 struct IStandaloneNode;
+class MsgArenaPool;
+class MetricsRegistry;
 
 /// @brief 数据处理引擎接口
 struct EDGELINK_EXPORT IEngine {
@@ -14,6 +16,22 @@ struct EDGELINK_EXPORT IEngine {
     virtual IStandaloneNode* get_global_node(const std::string_view node_id) const = 0;
     virtual bool is_disabled() const = 0;
 
+    /// @brief 消息 arena 池，没有启用 arena 的时候为空
+    virtual MsgArenaPool* msg_arena_pool() const = 0;
+
+    /// @brief 所有节点的指标：收发的消息数、丢弃数、异常数、邮箱长度和处理延迟
+    virtual MetricsRegistry& metrics() const = 0;
+
+    /// @brief 查找全局节点并转换为指定的接口，节点不存在或者类型不符时抛出 `InvalidDataException`
+    ///
+    /// 引用配置节点的流程节点应当在 `async_start` 里解析一次并保存结果，不要在处理每条消息时查找
+    template <typename T> T* resolve_global_node(const std::string_view node_id) const {
+        auto node = dynamic_cast<T*>(this->get_global_node(node_id));
+        if (node == nullptr) {
+            throw InvalidDataException(fmt::format("找不到全局节点 '{0}'，或者该节点的类型不符", node_id));
+        }
+        return node;
+    }
 };
 
 }; // namespace edgelink
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+namespace edgelink {
+
+/// @brief `flows.json` 配置的索引，只遍历一次配置数组
+///
+/// 按 `z` 把元素分组到各自的流程，按 `id` 建立散列索引。索引里的键和指针都直接指向配置 JSON，
+/// 不复制任何字符串，因此配置数组必须比索引活得更久。
+class EDGELINK_EXPORT FlowConfigIndex final : private Noncopyable {
+  public:
+    explicit FlowConfigIndex(const JsonArray& flows_config);
+
+    /// @brief 所有的流程（`tab` 或 `flow`），保持配置中的顺序
+    const std::vector<const JsonObject*>& flows() const { return _flows; }
+
+    /// @brief 所有的全局节点（不属于任何流程的元素），保持配置中的顺序
+    const std::vector<const JsonObject*>& global_nodes() const { return _global_nodes; }
+
+    /// @brief 属于指定流程的节点，不包括注释
+    std::span<const JsonObject* const> flow_elements(const std::string_view flow_id) const;
+
+    /// @brief 按 ID 查找任意元素，找不到时返回空指针
+    const JsonObject* find(const std::string_view id) const;
+
+    size_t size() const { return _by_id.size(); }
+
+  private:
+    std::vector<const JsonObject*> _flows;
+    std::vector<const JsonObject*> _global_nodes;
+    boost::unordered_flat_map<std::string_view, std::vector<const JsonObject*>> _by_flow;
+    boost::unordered_flat_map<std::string_view, const JsonObject*> _by_id;
+};
+
+}; // namespace edgelink
@@ -0,0 +1,151 @@
+#pragma once
+
+namespace edgelink {
+
+/// @brief 钩子订阅的句柄，用来取消订阅，不能比钩子本身活得更久
+class HookConnection {
+  public:
+    HookConnection() = default;
+    HookConnection(std::function<void(uint64_t)> disconnect, uint64_t id)
+        : _disconnect(std::move(disconnect)), _id(id) {}
+
+    bool connected() const { return static_cast<bool>(_disconnect); }
+
+    void disconnect() {
+        if (_disconnect) {
+            auto disconnect = std::move(_disconnect);
+            _disconnect = nullptr;
+            disconnect(_id);
+        }
+    }
+
+  private:
+    std::function<void(uint64_t)> _disconnect;
+    uint64_t _id = 0;
+};
+
+template <typename TSignature> class Hook;
+
+/// @brief 投递路径上的钩子
+///
+/// 订阅者列表是不可变的快照，订阅和取消订阅时复制一份新列表再替换指针（RCU 方式），调用方不加锁，
+/// 也不修改列表的引用计数。被替换的旧列表可能还有调用方在遍历，按纪元延迟回收：
+/// 调用方在当前纪元的读者计数上登记，上一个纪元的读者全部退出以后纪元才能前进，
+/// 旧列表在纪元前进两次以后释放。回收只在订阅变化时尝试，从不等待调用方，所以订阅者可以在被调用时取消自己。
+/// 没有订阅者的时候调用只是一次分支判断，不会读取快照。调用期间取消的订阅者可能还会被调用这最后一次。
+template <typename... TArgs> class Hook<void(TArgs...)> final : private Noncopyable {
+  public:
+    using Slot = std::function<void(TArgs...)>;
+
+    Hook() = default;
+
+    bool empty() const { return _size.load(std::memory_order_acquire) == 0; }
+    size_t size() const { return _size.load(std::memory_order_acquire); }
+
+    HookConnection connect(Slot slot) {
+        std::lock_guard lock(_write_mutex);
+        auto id = ++_last_id;
+        auto slots = this->copy_slots();
+        slots->emplace_back(id, std::move(slot));
+        this->publish(std::move(slots));
+        return HookConnection([this](uint64_t slot_id) { this->disconnect(slot_id); }, id);
+    }
+
+    void disconnect_all() {
+        std::lock_guard lock(_write_mutex);
+        this->publish(std::make_unique<Slots>());
+    }
+
+    void operator()(TArgs... args) const {
+        if (BOOST_LIKELY(this->empty())) {
+            return;
+        }
+        ReadGuard guard(*this);
+        auto const* slots = _slots.load(std::memory_order_seq_cst);
+        if (!slots) {
+            return;
+        }
+        for (auto const& [_, slot] : *slots) {
+            slot(args...);
+        }
+    }
+
+    /// @brief 等待回收的旧列表数量
+    size_t retired_count() const {
+        std::lock_guard lock(_write_mutex);
+        return _retired.size();
+    }
+
+  private:
+    using Slots = std::vector<std::pair<uint64_t, Slot>>;
+
+    /// @brief 调用期间在当前纪元的读者计数上登记
+    class ReadGuard {
+      public:
+        // 登记期间纪元前进了也没关系：登记以后才读取列表，读到的不会是已经释放的列表，
+        // 而这个计数会挡住之后的纪元推进，直到调用结束
+        explicit ReadGuard(const Hook& hook)
+            : _readers(hook._readers[hook._epoch.load(std::memory_order_seq_cst) & 1]) {
+            _readers.fetch_add(1, std::memory_order_seq_cst);
+        }
+        ~ReadGuard() { _readers.fetch_sub(1, std::memory_order_release); }
+
+      private:
+        std::atomic<size_t>& _readers;
+    };
+
+    struct Retired {
+        std::unique_ptr<const Slots> slots;
+        uint64_t epoch; ///< 替换下来时的纪元，这个纪元以及之前登记的调用方可能还在遍历它
+    };
+
+    void disconnect(uint64_t id) {
+        std::lock_guard lock(_write_mutex);
+        auto slots = this->copy_slots();
+        std::erase_if(*slots, [id](auto const& s) { return s.first == id; });
+        this->publish(std::move(slots));
+    }
+
+    /// @brief 复制当前的列表，调用方持有 `_write_mutex`
+    std::unique_ptr<Slots> copy_slots() const {
+        return _current ? std::make_unique<Slots>(*_current) : std::make_unique<Slots>();
+    }
+
+    /// @brief 发布新的列表并回收可以释放的旧列表，调用方持有 `_write_mutex`
+    void publish(std::unique_ptr<Slots> slots) {
+        auto size = slots->size();
+        _slots.store(slots.get(), std::memory_order_seq_cst);
+        _size.store(size, std::memory_order_release);
+        if (_current) {
+            _retired.push_back(Retired{std::move(_current), _epoch.load(std::memory_order_relaxed)});
+        }
+        _current = std::move(slots);
+        this->reclaim();
+    }
+
+    /// @brief 尽量推进纪元，释放所有调用方都已经不再遍历的旧列表，从不等待
+    void reclaim() {
+        // 推进两次以后，替换时的纪元里登记的调用方一定都已经退出
+        for (int i = 0; i < 2 && !_retired.empty(); i++) {
+            auto const epoch = _epoch.load(std::memory_order_relaxed);
+            if (_readers[(epoch + 1) & 1].load(std::memory_order_seq_cst) != 0) {
+                break;
+            }
+            _epoch.store(epoch + 1, std::memory_order_seq_cst);
+            std::erase_if(_retired, [epoch](auto const& r) { return r.epoch + 1 <= epoch; });
+        }
+    }
+
+  private:
+    std::atomic<size_t> _size = 0;
+    std::atomic<const Slots*> _slots = nullptr;
+    std::atomic<uint64_t> _epoch = 0;
+    mutable std::array<std::atomic<size_t>, 2> _readers{}; ///< 按纪元的奇偶分开的读者计数
+
+    std::unique_ptr<const Slots> _current; ///< `_slots` 指向的列表
+    std::vector<Retired> _retired;         ///< 已经替换下来、等待回收的列表
+    mutable std::mutex _write_mutex;       ///< 只用于订阅者之间互斥，调用方不需要
+    uint64_t _last_id = 0;
+};
+
+}; // namespace edgelink
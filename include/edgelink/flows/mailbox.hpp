@@ -0,0 +1,156 @@
+#pragma once
+
+namespace edgelink {
+
+/// @brief 有界无锁队列（Dmitry Vyukov 的 bounded MPMC 算法）
+///
+/// 容量会向上取整到 2 的幂。`try_push` 和 `try_pop` 都不会阻塞，队列满或者空的时候直接返回失败。
+template <typename T> class BoundedMpmcQueue final : private Noncopyable {
+  public:
+    explicit BoundedMpmcQueue(size_t capacity)
+        : _mask(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1), _cells(_mask + 1) {
+        for (size_t i = 0; i <= _mask; i++) {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    size_t capacity() const { return _mask + 1; }
+
+    /// @brief 队列中元素的近似数量
+    size_t size_approx() const {
+        auto enqueue_pos = _enqueue_pos.load(std::memory_order_seq_cst);
+        auto dequeue_pos = _dequeue_pos.load(std::memory_order_seq_cst);
+        return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+    }
+
+    /// @brief 入队，队列满时返回 false，此时 `value` 不会被移走
+    bool try_push(T& value) {
+        Cell* cell;
+        size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value.emplace(std::move(value));
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief 出队，队列空时返回空
+    std::optional<T> try_pop() {
+        Cell* cell;
+        size_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return std::nullopt;
+            } else {
+                pos = _dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        std::optional<T> result(std::move(*cell->value));
+        cell->value.reset();
+        cell->sequence.store(pos + _mask + 1, std::memory_order_release);
+        return result;
+    }
+
+  private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        std::optional<T> value;
+    };
+
+    const size_t _mask;
+    std::vector<Cell> _cells;
+    alignas(64) std::atomic<size_t> _enqueue_pos = 0;
+    alignas(64) std::atomic<size_t> _dequeue_pos = 0;
+};
+
+/// @brief 邮箱满了以后的处理方式
+enum class OverflowPolicy {
+    BLOCK,       ///< 发送方挂起，直到邮箱有空位；沿环的回边发送时不挂起，邮箱满了直接丢弃并记录日志
+    DROP_OLDEST, ///< 丢弃邮箱中最早的消息
+    DROP_NEWEST, ///< 丢弃正在发送的消息
+};
+
+/// @brief 解析配置中的溢出策略：`block`、`drop-oldest` 或 `drop-newest`
+EDGELINK_EXPORT OverflowPolicy parse_overflow_policy(const std::string_view text);
+
+struct MailboxOptions {
+    size_t capacity = 256;
+    OverflowPolicy overflow = OverflowPolicy::BLOCK;
+};
+
+/// @brief 节点的有界邮箱，多个发送方，由节点自己的投递协程取出
+///
+/// 队列本身是无锁的，只有在需要挂起等待（邮箱满或者空）的时候才会用到互斥锁。
+class EDGELINK_EXPORT Mailbox final : private Noncopyable {
+  public:
+    explicit Mailbox(const MailboxOptions& options);
+
+    size_t capacity() const { return _queue.capacity(); }
+    OverflowPolicy overflow_policy() const { return _overflow; }
+
+    /// @brief 当前排队的消息数
+    size_t depth() const { return _queue.size_approx(); }
+
+    /// @brief 因为邮箱满了而被丢弃的消息数
+    uint64_t dropped_count() const { return _dropped.load(std::memory_order_relaxed); }
+
+    /// @brief 放入消息，`BLOCK` 策略下邮箱满时挂起
+    /// @return 消息是否放入了邮箱，被丢弃或者邮箱已关闭时返回 false
+    Awaitable<bool> async_push(Envelope&& envelope);
+
+    /// @brief 放入消息，从不挂起：邮箱满时 `BLOCK` 策略与 `DROP_NEWEST` 一样丢弃这条消息
+    /// @return 消息是否放入了邮箱，被丢弃或者邮箱已关闭时返回 false
+    bool try_push(Envelope&& envelope);
+
+    /// @brief 取出消息，从不挂起，邮箱空时返回空
+    std::optional<Envelope> try_pop();
+
+    /// @brief 取出消息，邮箱空时挂起
+    /// @return 邮箱关闭并且已经取空时返回空
+    Awaitable<std::optional<Envelope>> async_pop();
+
+    /// @brief 关闭邮箱，唤醒所有等待者，之后的发送都会被丢弃
+    void close();
+
+    bool is_closed() const { return _closed.load(std::memory_order_acquire); }
+
+  private:
+    using Waiter = boost::asio::any_completion_handler<void()>;
+
+    Awaitable<void> async_wait_not_full();
+    Awaitable<void> async_wait_not_empty();
+    void notify(std::atomic<size_t>& waiting, std::deque<Waiter>& waiters);
+
+  private:
+    const OverflowPolicy _overflow;
+    BoundedMpmcQueue<Envelope> _queue;
+    std::atomic<uint64_t> _dropped = 0;
+    std::atomic<bool> _closed = false;
+
+    std::mutex _mutex;
+    std::atomic<size_t> _producers_waiting = 0;
+    std::atomic<size_t> _consumers_waiting = 0;
+    std::deque<Waiter> _producer_waiters;
+    std::deque<Waiter> _consumer_waiters;
+};
+
+}; // namespace edgelink
@@ -0,0 +1,139 @@
+#pragma once
+
+namespace edgelink {
+
+class Mailbox;
+
+/// @brief 对数-线性分桶的延迟直方图（HDR 风格）
+///
+/// 每个 2 的幂区间再线性分成 8 个子桶，相对误差不超过 12.5%。记录只是几次原子加法，不需要加锁；
+/// 多个线程频繁记录时可以各自使用一个直方图，读取的时候再用 `merge()` 汇总。
+class EDGELINK_EXPORT LatencyHistogram final : private Noncopyable {
+  public:
+    static constexpr unsigned SUB_BUCKET_BITS = 3;
+    static constexpr size_t SUB_BUCKET_COUNT = size_t(1) << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_EXPONENT = 43; ///< 约 2.4 小时（纳秒），更大的值都记在最后一个桶里
+    static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKET_COUNT;
+
+    LatencyHistogram() = default;
+
+    void record(uint64_t ns);
+
+    /// @brief 把另一个直方图的记录加到这个直方图上
+    void merge(const LatencyHistogram& other);
+
+    uint64_t count() const { return _count.load(std::memory_order_relaxed); }
+    uint64_t max() const { return _max.load(std::memory_order_relaxed); }
+    double mean() const;
+
+    /// @brief 分位数，返回所在桶的上界
+    /// @param q 0 到 1 之间
+    uint64_t percentile(double q) const;
+
+    static size_t bucket_index(uint64_t value);
+    static uint64_t bucket_lower_bound(size_t index);
+    static uint64_t bucket_upper_bound(size_t index) { return bucket_lower_bound(index + 1) - 1; }
+
+  private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> _buckets{};
+    std::atomic<uint64_t> _count = 0;
+    std::atomic<uint64_t> _sum = 0;
+    std::atomic<uint64_t> _max = 0;
+};
+
+/// @brief 某一时刻节点指标的快照
+struct EDGELINK_EXPORT NodeMetricsSnapshot {
+    std::string node_id;
+    std::string node_type;
+    std::string flow_id;
+    uint64_t msgs_in = 0;
+    uint64_t msgs_out = 0;
+    uint64_t dropped = 0;
+    uint64_t errors = 0;
+    size_t queue_depth = 0;
+    uint64_t latency_count = 0;
+    double latency_mean_ns = 0;
+    uint64_t latency_p50_ns = 0;
+    uint64_t latency_p90_ns = 0;
+    uint64_t latency_p99_ns = 0;
+    uint64_t latency_max_ns = 0;
+
+    JsonObject to_json() const;
+};
+
+/// @brief 单个节点的指标
+///
+/// 计数器按线程分片，每个线程只写自己那一片，读取的时候再汇总，这样记录的时候不会争用同一条缓存行。
+/// 延迟直方图有三百多个桶，每个节点只有一个：节点一般在自己的 strand 上处理消息，很少有多个线程同时记录。
+class EDGELINK_EXPORT NodeMetrics final : private Noncopyable {
+  public:
+    static constexpr size_t SHARD_COUNT = 8;
+
+    NodeMetrics(std::string node_id, std::string node_type, std::string flow_id);
+
+    void add_in(uint64_t n = 1) { this->shard().msgs_in.fetch_add(n, std::memory_order_relaxed); }
+    void add_out(uint64_t n = 1) { this->shard().msgs_out.fetch_add(n, std::memory_order_relaxed); }
+    void add_dropped(uint64_t n = 1) { this->shard().dropped.fetch_add(n, std::memory_order_relaxed); }
+    void add_error() { this->shard().errors.fetch_add(1, std::memory_order_relaxed); }
+    void record_latency(uint64_t ns) { _latency.record(ns); }
+
+    /// @brief 设置节点的邮箱，用来读取队列长度和邮箱满了丢弃的消息数；流程销毁的时候设为空
+    ///
+    /// 会等待正在读取旧邮箱的 `snapshot()` 结束，返回以后旧邮箱就可以销毁了
+    void set_mailbox(const Mailbox* mailbox);
+
+    NodeMetricsSnapshot snapshot() const;
+
+    const std::string& node_id() const { return _node_id; }
+
+  private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> msgs_in = 0;
+        std::atomic<uint64_t> msgs_out = 0;
+        std::atomic<uint64_t> dropped = 0;
+        std::atomic<uint64_t> errors = 0;
+    };
+
+    Shard& shard();
+
+  private:
+    const std::string _node_id;
+    const std::string _node_type;
+    const std::string _flow_id;
+    std::array<Shard, SHARD_COUNT> _shards;
+    LatencyHistogram _latency;
+    mutable std::mutex _mailbox_mutex; ///< 只在设置和读取邮箱时使用，记录指标不经过它
+    const Mailbox* _mailbox = nullptr;
+};
+
+/// @brief 引擎所有节点的指标
+class EDGELINK_EXPORT MetricsRegistry final : private Noncopyable {
+  public:
+    MetricsRegistry() = default;
+
+    /// @brief 获取节点的指标，不存在时创建
+    std::shared_ptr<NodeMetrics> get_or_create(const std::string_view node_id, const std::string_view node_type,
+                                               const std::string_view flow_id);
+
+    /// @brief 移除节点的指标，由创建它的流程或全局节点在销毁时调用，节点 ID 改变以后旧的指标不会一直留着
+    ///
+    /// 同一个 ID 已经换成了别的指标对象时什么也不做
+    void remove(const NodeMetrics& metrics);
+
+    /// @brief 查询某个节点的指标，节点不存在时返回空
+    std::optional<NodeMetricsSnapshot> query(const std::string_view node_id) const;
+
+    /// @brief 所有节点的指标，按节点 ID 排序
+    std::vector<NodeMetricsSnapshot> query_all() const;
+
+    JsonArray to_json() const;
+
+    /// @brief 以 JSON 格式写入文件，先写临时文件再改名，读取方不会看到写了一半的文件
+    void dump(const std::filesystem::path& path) const;
+
+  private:
+    mutable std::mutex _mutex;
+    std::map<std::string, std::shared_ptr<NodeMetrics>, std::less<>> _nodes;
+};
+
+}; // namespace edgelink
@@ -0,0 +1,61 @@
+#pragma once
+
+namespace edgelink {
+
+/// @brief 消息内存使用量的直方图
+///
+/// 每个流程一个，消息释放时记录它实际用了多少内存，用来估算新消息的 arena 应该多大
+class EDGELINK_EXPORT MsgArenaHistogram final : private Noncopyable {
+  public:
+    MsgArenaHistogram() = default;
+
+    void record(size_t bytes);
+
+    /// @brief 建议的 arena 大小，约为 90% 的消息都能放得下的尺寸
+    size_t suggest_size() const { return _suggested_size.load(std::memory_order_relaxed); }
+
+  public:
+    static constexpr size_t MIN_SIZE = 512;
+    static constexpr size_t BUCKET_COUNT = 20; ///< 512B ~ 256MB，每个桶是上一个的两倍
+    static constexpr size_t DEFAULT_SIZE = 4096;
+
+  private:
+    void update_suggestion();
+
+  private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> _buckets{};
+    std::atomic<uint64_t> _count = 0;
+    std::atomic<size_t> _suggested_size = DEFAULT_SIZE;
+};
+
+struct MsgArena;
+
+/// @brief 消息 arena 池
+///
+/// 每个消息可以使用一个 arena（`boost::json::monotonic_resource`）分配它所有的 JSON 节点，
+/// 消息的最后一个引用释放时整块回收，而不是逐个节点释放。
+/// 回收的 arena 放在无锁的空闲链表里，被引擎的所有工作线程共享。
+class EDGELINK_EXPORT MsgArenaPool final : public std::enable_shared_from_this<MsgArenaPool>, private Noncopyable {
+  public:
+    explicit MsgArenaPool(size_t max_pooled = 1024);
+    ~MsgArenaPool();
+
+    /// @brief 租用一个 arena 作为消息的存储
+    /// @param histogram 消息所在流程的直方图，arena 的大小根据它来确定，释放时也会记录到它里面
+    boost::json::storage_ptr acquire(std::shared_ptr<MsgArenaHistogram> histogram);
+
+    /// @brief 当前池子里空闲的 arena 数量（近似值）
+    size_t pooled_count() const { return _pooled_count.load(std::memory_order_relaxed); }
+
+  private:
+    friend class MsgArenaLease;
+
+    MsgArena* rent(size_t size);
+    void give_back(MsgArena* arena);
+
+  private:
+    boost::lockfree::stack<MsgArena*> _free_list;
+    std::atomic<size_t> _pooled_count = 0;
+};
+
+}; // namespace edgelink
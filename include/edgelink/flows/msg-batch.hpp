@@ -0,0 +1,66 @@
+#pragma once
+
+namespace edgelink {
+
+/// @brief 列式存储的批量消息
+///
+/// 高频采集的流程里每个样本都做成一条 `Msg` 代价太高（一个消息、一个 JSON 对象、一次协程调用），
+/// 批量消息把 N 个样本按列存放：数值负载是连续的 `double` 数组，主题按字典编码，
+/// 时间戳是批次共享的基准时间加上每个样本的偏移（全部为 0 的时候不占空间）。
+class EDGELINK_EXPORT MsgBatch final {
+  public:
+    static constexpr uint32_t NO_TOPIC = std::numeric_limits<uint32_t>::max();
+
+    MsgBatch() : MsgBatch(0) {}
+
+    /// @param timestamp 批次的基准时间，自 UNIX 纪元起的毫秒数
+    explicit MsgBatch(int64_t timestamp) : _timestamp(timestamp) {}
+
+    size_t size() const { return _payloads.size(); }
+    bool empty() const { return _payloads.empty(); }
+    void reserve(size_t n);
+
+    /// @brief 追加一个样本
+    /// @param time_offset 相对于批次基准时间的毫秒数
+    void push_back(double payload, std::optional<std::string_view> topic = std::nullopt, uint32_t time_offset = 0);
+
+    /// @brief 数值负载列
+    std::span<double> payloads() { return _payloads; }
+    std::span<const double> payloads() const { return _payloads; }
+
+    /// @brief 主题列，每个元素是主题字典中的下标，没有主题的样本为 `NO_TOPIC`
+    std::span<const uint32_t> topic_ids() const { return _topic_ids; }
+
+    /// @brief 主题字典
+    const std::vector<std::string>& topic_dictionary() const { return _topics; }
+
+    std::optional<std::string_view> topic_at(size_t index) const;
+
+    int64_t timestamp() const { return _timestamp; }
+    int64_t timestamp_at(size_t index) const;
+
+    /// @brief 把主题加入字典，返回它的下标
+    uint32_t intern_topic(const std::string_view topic);
+
+    /// @brief 展开第 `index` 个样本为普通消息，没有批量处理能力的节点用它逐条接收
+    MsgPtr to_msg(size_t index, IFlowNode* birth_place = nullptr) const;
+
+    JsonObject to_json() const;
+
+  private:
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(const std::string_view sv) const { return std::hash<std::string_view>{}(sv); }
+    };
+
+    int64_t _timestamp;
+    std::vector<double> _payloads;
+    std::vector<uint32_t> _topic_ids;
+    std::vector<uint32_t> _time_offsets; ///< 所有偏移都是 0 的时候为空
+    std::vector<std::string> _topics;
+    boost::unordered_flat_map<std::string, uint32_t, StringHash, std::equal_to<>> _topic_index;
+};
+
+using MsgBatchPtr = std::shared_ptr<MsgBatch>;
+
+}; // namespace edgelink
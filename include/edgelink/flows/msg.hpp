@@ -6,6 +6,41 @@ struct IFlowNode;
 
 using MsgID = uint32_t;
 
+/// @brief 只读、可共享的二进制缓冲区
+///
+/// 复制缓冲区只增加引用计数，不复制数据；数据的生存期由 owner 保持，
+/// 因此可以直接引用其他库（比如 MQTT 收到的报文）的内存。
+class EDGELINK_EXPORT MsgBuffer {
+  public:
+    MsgBuffer() : MsgBuffer(Bytes()) {}
+
+    explicit MsgBuffer(Bytes&& bytes);
+
+    MsgBuffer(std::shared_ptr<const void> owner, std::span<const uint8_t> view)
+        : _owner(std::move(owner)), _view(view), _json_cache(std::make_shared<JsonCache>()) {}
+
+    std::span<const uint8_t> span() const { return _view; }
+    const uint8_t* data() const { return _view.data(); }
+    size_t size() const { return _view.size(); }
+    bool empty() const { return _view.empty(); }
+
+    std::string_view as_string_view() const {
+        return std::string_view(reinterpret_cast<const char*>(_view.data()), _view.size());
+    }
+
+    /// @brief 缓冲区的 JSON 形式（字节数组），第一次访问时生成并在所有副本间共享
+    const JsonValue& as_json() const;
+
+  private:
+    struct JsonCache {
+        std::once_flag once;
+        JsonValue json;
+    };
+
+    std::shared_ptr<const void> _owner;
+    std::span<const uint8_t> _view;
+    std::shared_ptr<JsonCache> _json_cache;
+};
 
 enum class MsgValueKind : unsigned char {
     NULLPTR,
@@ -22,78 +57,164 @@ using MsgValue = boost::variant< //
     int64_t,                     //
     bool,                        //
     std::string,                 //
-    std::vector<uint8_t>         //
+    MsgBuffer                    //
     >;
 
 inline MsgValueKind kind(const MsgValue& value) { return static_cast<MsgValueKind>(value.which()); }
 
 struct FlowNode;
 
+/// @brief 消息的顶层属性
+///
+/// 属性值是可以在多个消息之间共享的不可变子树，只有在写入时才会复制（写时复制）。
+///
+/// 共享的粒度是顶层属性，不是属性路径：写入 `payload.a.b` 会复制整个 `payload`，其他顶层属性仍然共享。
+/// Boost.JSON 的对象和数组按值持有子节点，子树之间无法共享，按路径复制需要换掉消息的 JSON 模型，
+/// 代价超过收益；大多数节点只改写一两个顶层属性，复制也只发生在这些属性上。
+struct MsgProperty {
+    std::string key;
+    std::shared_ptr<JsonValue> value;
+};
+
+/// @brief 消息体，多个克隆出来的消息共享同一个消息体，直到其中一个被修改
+///
+/// `payload` 和 `topic` 是几乎每个节点都要访问的属性，单独存放，访问时不需要按字符串查找
+struct MsgBody {
+    std::shared_ptr<JsonValue> payload;
+    std::optional<MsgBuffer> payload_buffer; ///< 有值的时候消息负载是二进制缓冲区
+    std::shared_ptr<JsonValue> topic;
+    boost::container::small_vector<MsgProperty, 6> props;
+};
+
 class EDGELINK_EXPORT Msg final : private boost::noncopyable {
   public:
     Msg(IFlowNode* birth_place = nullptr) : Msg(Msg::generate_msg_id(), birth_place) {}
 
-    Msg(MsgID id, IFlowNode* birth_place = nullptr)
-        : _birth_place(birth_place), _data(std::move(JsonObject({{"_msgid", id}, {"payload", nullptr}}))) {}
+    Msg(MsgID id, IFlowNode* birth_place = nullptr);
 
-    Msg(Msg&& other) : _birth_place(other._birth_place), _data(std::move(other._data)) {}
+    /// @brief 创建一个属性值都分配在指定存储（一般是流程提供的 arena）里的空消息
+    Msg(boost::json::storage_ptr storage, IFlowNode* birth_place);
 
-    Msg(JsonObject const& data, IFlowNode* birth_place = nullptr) : _birth_place(birth_place), _data(data) {}
+    Msg(Msg&& other)
+        : _birth_place(other._birth_place), _id(other._id), _id_value(std::move(other._id_value)),
+          _storage(std::move(other._storage)), _body(std::move(other._body)) {}
 
-    Msg(JsonObject&& data, IFlowNode* birth_place) : _birth_place(birth_place), _data(std::move(data)) {}
+    Msg(JsonObject const& data, IFlowNode* birth_place = nullptr);
 
-    JsonObject& data() { return _data; }
+    /// @brief 接管 JSON 对象的内容，消息沿用该对象的存储
+    Msg(JsonObject&& data, IFlowNode* birth_place);
 
-    JsonObject const& data() const { return _data; }
+    /// @brief 把消息展开为一个完整的 JSON 对象（深复制）
+    JsonObject to_json() const;
 
-    MsgID id() const {
-        MsgID id = _data.at("_msgid").to_number<MsgID>();
-        return id;
-    }
+    MsgID id() const { return _id; }
+
+    /// @brief 消息属性值所用的存储，节点为消息构造较大的属性值时应当直接使用它，以免再复制一次
+    const boost::json::storage_ptr& storage() const { return _storage; }
 
     IFlowNode* birth_place() { return _birth_place; }
     const IFlowNode* birth_place() const { return _birth_place; }
 
-    /*
+    void set_id(MsgID new_id) {
+        _id = new_id;
+        _id_value = new_id;
+    }
+
     const std::optional<std::string_view> topic() const {
-        auto iter = _data.find("topic");
-        return iter = _data.end() ? std::optional<std::string_view>((*iter).as_string()) : std::optional<std::string_view>();
+        if (_body->topic && _body->topic->is_string()) {
+            return std::string_view(_body->topic->get_string());
+        }
+        return std::nullopt;
     }
-    */
 
-    void set_id(MsgID new_id);
+    void set_topic(const std::string_view topic);
+
+    bool has_payload() const { return _body->payload || _body->payload_buffer; }
+
+    /// @brief 二进制负载，负载不是缓冲区的时候返回空指针
+    const MsgBuffer* payload_buffer() const { return _body->payload_buffer ? &*_body->payload_buffer : nullptr; }
 
+    /// @brief 负载的 JSON 形式，二进制负载会以字节数组的形式给出
+    JsonValue const& payload() const&;
+
+    JsonValue& payload() &;
+
+    void set_payload(JsonValue&& value);
+
+    void set_payload(MsgBuffer buffer);
+
+    void set_payload(const MsgValue& value);
+
+    /// @brief 克隆消息，克隆出的消息与原消息共享所有属性，代价为 O(1)
     std::shared_ptr<Msg> clone(bool new_id = true) const;
 
-    inline const JsonString to_json_string() const { return JsonString(std::move(boost::json::serialize(_data))); }
-    inline const std::string to_string() const { return boost::json::serialize(_data); }
+    const JsonString to_json_string() const { return JsonString(this->to_string()); }
+    const std::string to_string() const;
 
-    JsonValue const& at_propex(const std::string_view propex) const&;
+    JsonValue const& at_propex(const std::string_view expr) const& { return this->at_propex(*propex::intern(expr)); }
 
-    JsonValue& at_propex(const std::string_view propex) & {
-        auto const& self = *this;
-        return const_cast<JsonValue&>(self.at_propex(propex));
-    }
-    JsonValue&& at_propex(const std::string_view propex) && { return std::move(this->at_propex(propex)); }
+    JsonValue& at_propex(const std::string_view expr) & { return this->at_propex(*propex::intern(expr)); }
 
-    JsonValue const& at(const std::string_view prop) const& { return _data.at(prop); }
+    JsonValue&& at_propex(const std::string_view expr) && { return std::move(this->at_propex(expr)); }
 
-    JsonValue& at(const std::string_view prop) & {
-        auto const& self = *this;
-        return const_cast<JsonValue&>(self.at(prop));
-    }
+    JsonValue const& at_propex(const propex::PropertyPath& path) const&;
+
+    /// @brief 可写访问，表达式所经过的那个顶层属性会被整个复制，其他属性不复制
+    JsonValue& at_propex(const propex::PropertyPath& path) &;
+
+    /// @brief 按属性表达式赋值，路径中间不存在的对象或数组会被自动创建
+    void set_propex(const propex::PropertyPath& path, JsonValue&& value);
+
+    JsonValue const& at(const std::string_view prop) const&;
+
+    /// @brief 可写访问，如果该属性与其他消息共享则先复制它
+    JsonValue& at(const std::string_view prop) &;
 
     JsonValue&& at(const std::string_view prop) && { return std::move(this->at(prop)); }
 
-    void insert_or_assign(const std::string_view prop_expr, JsonValue&& value) {
-        this->data().insert_or_assign(prop_expr, std::move(value));
+    const JsonValue* if_contains(const std::string_view prop) const;
+
+    bool contains(const std::string_view prop) const { return this->if_contains(prop) != nullptr; }
+
+    void insert_or_assign(const std::string_view prop, JsonValue&& value);
+
+    bool erase(const std::string_view prop);
+
+    /// @brief 按照 JSON 序列化的顺序遍历所有顶层属性
+    /// @param func 形如 `void(std::string_view key, const JsonValue& value)` 的函数
+    template <typename TFunc> void for_each(TFunc&& func) const {
+        func(std::string_view("_msgid"), _id_value);
+        if (this->has_payload()) {
+            func(std::string_view("payload"), this->payload());
+        }
+        if (_body->topic) {
+            func(std::string_view("topic"), std::as_const(*_body->topic));
+        }
+        for (auto const& p : _body->props) {
+            func(std::string_view(p.key), std::as_const(*p.value));
+        }
     }
 
     static MsgID generate_msg_id();
 
+  private:
+    Msg(MsgID id, std::shared_ptr<MsgBody> body, IFlowNode* birth_place)
+        : _birth_place(birth_place), _id(id), _id_value(id), _storage(), _body(std::move(body)) {}
+
+    /// @brief 确保消息体为本消息独占
+    MsgBody& detach_body();
+
+    /// @brief 确保指定的顶层属性为本消息独占
+    JsonValue& detach_property(const std::string_view prop);
+
+    void assign_json_property(const std::string_view key, JsonValue&& value);
+
   private:
     IFlowNode* _birth_place;
-    JsonObject _data;
+    MsgID _id;
+    JsonValue _id_value; ///< `_msgid` 的 JSON 形式，用于按属性名访问
+    boost::json::storage_ptr _storage; ///< 本消息写入的属性值所用的存储
+    std::shared_ptr<MsgBody> _body;
 };
 
 using MsgPtr = std::shared_ptr<Msg>;
@@ -3,30 +3,46 @@
 #include <cstdlib>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 
 #include <memory>
+#include <array>
+#include <bit>
+#include <atomic>
 
 #include <string>
 #include <span>
 #include <vector>
 #include <map>
 #include <queue>
+#include <deque>
 #include <variant>
+#include <unordered_map>
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
 
 #include <chrono>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
 #include <type_traits>
+#include <limits>
+#include <random>
 #include <filesystem>
 
 #include <boost/asio.hpp>
 #include <boost/static_string.hpp>
 #include <boost/container/static_vector.hpp>
+#include <boost/container/small_vector.hpp>
 #include <boost/url.hpp>
 #include <boost/json.hpp>
 #include <boost/signals2.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/lockfree/stack.hpp>
+#include <boost/unordered/unordered_flat_map.hpp>
+#include <boost/unordered/unordered_flat_set.hpp>
 
 
 #include <fmt/chrono.h>
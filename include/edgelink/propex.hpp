@@ -36,6 +36,39 @@ EDGELINK_EXPORT bool try_parse(const std::string_view input, PropertySegments& r
 
 EDGELINK_EXPORT const PropertySegments parse(const std::string_view input);
 
+/// @brief 编译后的属性表达式片段，自己持有属性名
+using CompiledSegment = std::variant<std::string, size_t>;
+
+inline PropertySegmentKind kind(const CompiledSegment& seg) { return static_cast<PropertySegmentKind>(seg.index()); }
+
+/// @brief 编译好的属性表达式
+///
+/// 只在构造时解析一次，之后可以反复用于访问任意消息，访问时不需要再解析，
+/// 也不需要构造临时的 std::string
+class EDGELINK_EXPORT PropertyPath final {
+  public:
+    explicit PropertyPath(const std::string_view expr);
+
+    const std::string_view expr() const { return _expr; }
+
+    /// @brief 第一段，也就是消息的顶层属性名
+    const std::string_view root() const { return std::get<std::string>(_segments.front()); }
+
+    size_t size() const { return _segments.size(); }
+
+    const CompiledSegment& operator[](size_t i) const { return _segments[i]; }
+
+    auto begin() const { return _segments.begin(); }
+    auto end() const { return _segments.end(); }
+
+  private:
+    std::string _expr;
+    boost::container::static_vector<CompiledSegment, PROPERTY_SEGMENT_MAX> _segments;
+};
+
+/// @brief 从全局缓存里获取编译好的属性表达式，用于运行时才知道的动态表达式
+EDGELINK_EXPORT std::shared_ptr<const PropertyPath> intern(const std::string_view expr);
+
 EDGELINK_EXPORT JsonValue evaluate_property_value(const JsonValue& value, const std::string_view type,
                                                   const INode& node, const Msg& msg);
 
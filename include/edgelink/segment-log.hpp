@@ -0,0 +1,94 @@
+#pragma once
+
+namespace edgelink {
+
+/// @brief 段日志刷盘的时机
+enum class FsyncPolicy {
+    NEVER,    ///< 交给操作系统回写
+    INTERVAL, ///< 由所有者定期调用 `sync()`
+    ALWAYS,   ///< 每次追加和消费以后都同步刷盘
+};
+
+/// @brief 解析 `never`、`interval` 或 `always`
+EDGELINK_EXPORT FsyncPolicy parse_fsync_policy(const std::string_view text);
+
+struct SegmentLogOptions {
+    std::filesystem::path directory;
+    size_t segment_bytes = 4 * 1024 * 1024; ///< 单个段文件的大小，一条记录不能超过它
+    size_t max_bytes = 64 * 1024 * 1024;    ///< 所有段文件的总大小上限，超出时丢弃最旧的段
+    FsyncPolicy fsync = FsyncPolicy::INTERVAL;
+};
+
+/// @brief 只追加、内存映射的段日志，用作断网时的存储转发队列
+///
+/// 日志由目录下若干个固定大小的段文件组成，记录按顺序编号（序号），只能追加到最后一个段。
+/// 读游标是第一条没有被消费的记录的序号，保存在 `cursor` 文件里，重启以后从原来的位置继续。
+/// 每条记录带有长度和校验和，恢复时遇到写了一半的记录就认为日志在那里结束。
+///
+/// 不是线程安全的，应当只在一个 strand 上使用。
+class EDGELINK_EXPORT SegmentLog final : private Noncopyable {
+  public:
+    /// @brief `peek()` 的结果，记录的内存直接引用映射的段文件，下一次 `append()` 或 `consume()` 之前有效
+    struct Batch {
+        uint64_t first_seq = 0;
+        std::vector<std::span<const uint8_t>> records;
+    };
+
+    /// @brief 打开或者创建日志，并恢复已有的记录
+    explicit SegmentLog(SegmentLogOptions options);
+    ~SegmentLog();
+
+    /// @brief 把几段数据拼成一条记录追加到日志末尾，记录比一个段还大时返回 false
+    bool append(std::span<const std::span<const uint8_t>> parts);
+
+    /// @brief 从读游标开始读取至多 `max_count` 条记录，不移动读游标
+    Batch peek(size_t max_count) const;
+
+    /// @brief 把读游标移动到 `end_seq`，回收已经完全消费的段
+    void consume(uint64_t end_seq);
+
+    /// @brief 把已经追加的记录和读游标写入磁盘
+    void sync();
+
+    /// @brief 尚未消费的记录数
+    size_t size() const { return static_cast<size_t>(_next_seq - _read_seq); }
+    bool empty() const { return _next_seq == _read_seq; }
+
+    /// @brief 所有段文件占用的字节数
+    size_t bytes() const;
+
+    /// @brief 因为超出总大小上限而被丢弃的记录数
+    uint64_t dropped() const { return _dropped; }
+
+    const SegmentLogOptions& options() const { return _options; }
+
+  private:
+    struct Segment {
+        uint64_t id;
+        uint64_t base_seq; ///< 段中第一条记录的序号
+        int fd = -1;
+        uint8_t* data = nullptr;
+        size_t write_offset = 0;
+        size_t synced_offset = 0;
+        std::vector<uint32_t> offsets; ///< 每条记录在段中的起始位置
+
+        uint64_t end_seq() const { return base_seq + offsets.size(); }
+    };
+
+    std::filesystem::path segment_path(uint64_t id) const;
+    Segment& create_segment(uint64_t id, uint64_t base_seq);
+    void open_segment(const std::filesystem::path& path, uint64_t id);
+    void close_segment(Segment& segment, bool remove);
+    void sync_segment(Segment& segment);
+    void write_cursor();
+
+  private:
+    SegmentLogOptions _options;
+    std::deque<Segment> _segments;
+    uint64_t _read_seq = 0;
+    uint64_t _next_seq = 0;
+    uint64_t _dropped = 0;
+    int _cursor_fd = -1;
+};
+
+}; // namespace edgelink
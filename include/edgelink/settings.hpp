@@ -7,6 +7,13 @@ struct EDGELINK_EXPORT EdgeLinkSettings {
     const std::filesystem::path home_path;           ///< EdgeLink 主目录
     const std::filesystem::path executable_location; ///< EdgeLink 可执行文件所在目录
     const std::string flows_json_path;
+    const bool msg_arena_enabled = false; ///< 消息是否使用池化的 arena 分配属性值
+    const size_t js_runtime_pool_size = 0; ///< function 节点共享的 QuickJS 运行时数量，为 0 时每个节点独占一个
+    const size_t worker_threads = 1;       ///< 运行流程引擎的线程数
+    const size_t mailbox_capacity = 256;   ///< 节点邮箱的默认容量
+    const std::string mailbox_overflow = "block"; ///< 节点邮箱满了以后的默认策略
+    const std::filesystem::path metrics_file;     ///< 定期写入节点指标的 JSON 文件，为空时不写
+    const size_t metrics_interval_ms = 10000;     ///< 写入节点指标的间隔
 };
 
 }; // namespace edgelink
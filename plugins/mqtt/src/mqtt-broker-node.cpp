@@ -1,7 +1,11 @@
 #include <boost/asio/experimental/channel.hpp>
 
 #include <edgelink/plugin.hpp>
+#include <edgelink/segment-log.hpp>
 #include "mqtt.hpp"
+#include "topic-trie.hpp"
+#include "topic-alias.hpp"
+#include "mqtt-connection.hpp"
 
 using namespace edgelink;
 
@@ -39,8 +43,29 @@ namespace this_coro = boost::asio::this_coro;
         "willPayload": "",
         "willMsg": {},
         "userProps": "",
-        "sessionExpiry": ""
+        "sessionExpiry": "",
+        "publishWindow": 16,
+        "storeForward": false,
+        "storePath": "",
+        "storeMaxMB": 64,
+        "storeSegmentMB": 4,
+        "storeFsync": "interval",
+        "storeFsyncInterval": 1000,
+        "topicAliasMaximum": 16,
+        "connections": 1
     }
+
+    `protocolVersion` 为 "5" 时使用 MQTT v5，`sessionExpiry` 和 `userProps` 作为 CONNECT 报文的属性发送
+
+    以下是 EdgeLink 的扩展：
+    `publishWindow`：同时等待应答的 QoS1/QoS2 消息的最大数量
+    `storeForward`：断网时把要发布的消息存到磁盘上的段日志，重新连上以后按顺序补发；启用后节点会自动重连
+    `storePath`：段日志的目录，默认为主目录下的 `mqtt-store/<节点 ID>`
+    `storeMaxMB`、`storeSegmentMB`：段日志的总大小上限和单个段文件的大小，超出上限时丢弃最旧的消息
+    `storeFsync`：`never`、`interval` 或 `always`，`storeFsyncInterval` 是 `interval` 策略的刷盘间隔（毫秒）
+    `topicAliasMaximum`：MQTT v5 下本端最多使用的主题别名数量，别名优先分配给发布最频繁、主题最长的消息
+    `connections`：到同一个 broker 的连接数量，大于 1 时按主题的哈希把发布分给各个连接，同一主题的消息仍然按顺序发出。
+    每个连接独立重连，客户端标识符加上 `-<序号>` 后缀，磁盘队列使用 `storePath` 下的 `<序号>` 子目录；订阅只走第一个连接
 */
 
 class MqttBrokerNode : public EndpointNode,
@@ -51,79 +76,58 @@ class MqttBrokerNode : public EndpointNode,
                    IEngine* engine)
         : EndpointNode(id, desc, config, engine, config.at("broker").as_string(),
                        boost::lexical_cast<uint16_t>(config.at("port").as_string().c_str())) {
-        //
+        auto const count = std::clamp(edgelink::value_or<unsigned int>(config, "connections", 1U), 1U, MAX_CONNECTIONS);
+        auto const options = this->parse_connection_options(id, config, engine);
+        _connections.reserve(count);
+        for (unsigned int i = 0; i < count; i++) {
+            _connections.push_back(this->make_connection(i, count, options));
+        }
+    }
+
+    ~MqttBrokerNode() override {
+        for (auto const& connection : _connections) {
+            if (connection->metrics()) {
+                this->engine()->metrics().remove(*connection->metrics());
+            }
+        }
     }
 
     Awaitable<void> async_start() override {
+        // 引擎为每个全局节点分配了独立的 strand，第一个连接直接使用它，其余的连接各自使用一个新的 strand，
+        // 这样不同连接上的发布、应答和重连互不阻塞
         auto exe = co_await this_coro::executor;
-        if (!_lock) { // 因 MQTT 库的限制，此类不运行并发操作
-            _lock = std::make_unique<channel<void()>>(exe, 1);
-        }
-        else {
-            throw std::logic_error("MqttBrokerNode 已启动，不能再次启动");
+        _connections.front()->bind_executor(exe);
+        for (size_t i = 1; i < _connections.size(); i++) {
+            auto const* strand = exe.target<Strand>();
+            _connections[i]->bind_executor(strand ? asio::make_strand(strand->get_inner_executor())
+                                                  : asio::make_strand(exe));
         }
 
-        co_await this->async_lock();
-        try {
-            co_await this->async_connect();
-        } catch (std::exception& ex) {
-            auto error_msg = fmt::format("MQTT 连接失败：{0}", ex.what());
-            this->logger()->error(error_msg);
-            this->unlock();
-            throw;
+        for (auto& connection : _connections) {
+            co_await asio::co_spawn(connection->executor(), connection->async_start(), asio::use_awaitable);
         }
-        this->unlock();
-
         co_return;
     }
 
     Awaitable<void> async_stop() override {
-
-        co_await this->async_close();
-        _lock->cancel();
-        _lock.reset();
-
+        for (auto& connection : _connections) {
+            co_await asio::co_spawn(connection->executor(), connection->async_stop(), asio::use_awaitable);
+        }
+        if (_connections.size() > 1) {
+            for (size_t i = 0; i < _connections.size(); i++) {
+                this->logger()->info("MQTT 连接 #{0} 统计：{1}", i,
+                                     boost::json::serialize(_connections[i]->stats().to_json()));
+            }
+        }
         co_return;
     }
 
-    bool is_connected() const override { return _endpoint && _endpoint->next_layer().is_open(); }
+    /// @brief 订阅只走第一个连接，所以以它的状态为准
+    bool is_connected() const override { return _connections.front()->is_connected(); }
 
     Awaitable<void> async_publish(const std::string_view topic, const async_mqtt::buffer& payload_buffer,
-                                  async_mqtt::qos qos) override {
-        co_await this->async_lock();
-        try {
-
-            auto topic_buffer = am::allocate_buffer(topic);
-            auto pid = co_await _endpoint->acquire_unique_packet_id(asio::use_awaitable);
-            // Send MQTT PUBLISH
-            auto se = co_await _endpoint->send(am::v3_1_1::publish_packet{*pid, topic_buffer, payload_buffer, qos},
-                                               asio::use_awaitable);
-            if (se) {
-                auto error_msg = fmt::format("MQTT PUBLISH send error: {0}", se.what());
-                this->logger()->error(error_msg);
-        this->unlock();
-                throw IOException(error_msg);
-            }
-            // Recv MQTT PUBLISH and PUBACK (order depends on broker)
-            am::packet_variant pv = co_await _endpoint->recv(asio::use_awaitable);
-            if (pv) {
-                pv.visit(am::overload{[&](am::v3_1_1::puback_packet const& p) {
-                                          //
-                                          // spdlog::info("MQTT PUBACK recv pid: {0}", p.packet_id());
-                                          return;
-                                      },
-                                      [](auto const&) {}});
-            } else {
-                auto error_msg = fmt::format("MQTT recv error: {0}", pv.get<am::system_error>().what());
-                this->logger()->error(error_msg);
-        this->unlock();
-                throw IOException(error_msg);
-            }
-        } catch (...) {
-        this->unlock();
-            throw;
-        }
-        this->unlock();
+                                  async_mqtt::qos qos, const PublishPropertiesPtr& props) override {
+        co_await this->connection_for(topic).async_publish(topic, payload_buffer, qos, props);
         co_return;
     }
 
@@ -131,91 +135,120 @@ class MqttBrokerNode : public EndpointNode,
                                          async_mqtt::qos qos) override {
         auto topic_buffer = am::allocate_buffer(topic);
         auto payload_buffer = am::allocate_buffer(payload);
-        co_await this->async_publish(topic_buffer, payload_buffer, qos);
+        co_await this->async_publish(topic_buffer, payload_buffer, qos, nullptr);
         co_return;
     }
 
-  private:
-
-    Awaitable<void> async_lock() {
-        co_await _lock->async_send(deferred);
-        co_return;
+    void subscribe(const std::string_view topic_filter, async_mqtt::qos qos, IMqttSubscriber* subscriber) override {
+        if (auto subscribe_qos = _subscriptions.add(topic_filter, qos, subscriber)) {
+            _connections.front()->subscribe(topic_filter, *subscribe_qos);
+        }
     }
 
-    void unlock() {
-        _lock->try_receive([](auto...) {});
+    void unsubscribe(const std::string_view topic_filter, IMqttSubscriber* subscriber) override {
+        _subscriptions.remove(topic_filter, subscriber);
     }
 
-    Awaitable<void> async_connect() {
-        BOOST_ASSERT(_lock);
-        this->logger()->info("开始连接 MQTT：{}:{}", this->host(), this->port());
-
-        auto exe = co_await this_coro::executor;
-
-        {
-            auto amep = new Endpoint{am::protocol_version::v3_1_1, exe};
-            _endpoint = std::move(std::unique_ptr<Endpoint>(amep));
+  private:
+    /// @brief 按主题的哈希选择连接，同一主题总是走同一个连接，保持它的发布顺序
+    MqttConnection& connection_for(const std::string_view topic) const {
+        if (_connections.size() == 1) {
+            return *_connections.front();
         }
+        return *_connections[std::hash<std::string_view>{}(topic) % _connections.size()];
+    }
 
-        // asio::ip::tcp::socket resolve_sock{exe};
-        asio::ip::tcp::resolver resolver(exe);
-
-        // Resolve hostname
-        this->logger()->debug("MqttBrokerNode > 解析地址");
-
-        auto eps = co_await resolver.async_resolve(this->host(), std::to_string(this->port()), asio::use_awaitable);
-
-        // Layer
-        // am::stream -> TCP
-
-        // Underlying TCP connect
-        this->logger()->debug("MqttBrokerNode > socket 开始连接");
-        co_await asio::async_connect(_endpoint->next_layer(), eps, asio::use_awaitable);
-
-        // Send MQTT CONNECT
-        if (auto se = co_await _endpoint->send(
-                am::v3_1_1::connect_packet{
-                    true,   // clean_session
-                    0x1234, // keep_alive
-                    am::allocate_buffer("cid1"),
-                    am::nullopt, // will
-                    am::nullopt, // username set like am::allocate_buffer("user1"),
-                    am::nullopt  // password set like am::allocate_buffer("pass1")
-                },
-                asio::use_awaitable)) {
-            co_return;
+    /// @brief 连接池里的第 `index` 个连接：客户端标识符、磁盘队列目录、指标和日志都按序号区分
+    std::shared_ptr<MqttConnection> make_connection(unsigned int index, unsigned int count,
+                                                    const MqttConnectionOptions& options) {
+        auto connection_options = options;
+        auto logger = this->logger();
+        std::string metrics_id(this->id());
+        if (count > 1) {
+            connection_options.client_id = fmt::format("{0}-{1}", options.client_id, index);
+            // 连接池里的一个连接连不上不应该让整个节点启动失败
+            connection_options.auto_reconnect = true;
+            if (connection_options.store) {
+                connection_options.store->directory /= std::to_string(index);
+            }
+            metrics_id = fmt::format("{0}#{1}", this->id(), index);
+            logger = logger->clone(fmt::format("{0}#{1}", logger->name(), index));
+        }
+        std::shared_ptr<NodeMetrics> metrics;
+        if (connection_options.store) {
+            metrics = this->engine()->metrics().get_or_create(metrics_id, "mqtt-broker", "");
         }
+        // 收到的消息只从第一个连接分发，其余的连接只用来发布
+        return std::make_shared<MqttConnection>(std::move(connection_options), std::move(logger),
+                                                index == 0 ? &_subscriptions : nullptr, std::move(metrics));
+    }
 
-        // Recv MQTT CONNACK
-        if (am::packet_variant pv = co_await _endpoint->recv(asio::use_awaitable)) {
-            auto cb = am::overload{[&](am::v3_1_1::connack_packet const& p) {
-                                       // std::cout << "MQTT CONNACK recv" << " sp:" << p.session_present() <<
-                                       // std::endl; spdlog::info("MqttClient > 收到连接相应");
-                                   },
-                                   [](auto const&) {}};
-            pv.visit(cb);
-        } else {
-            this->logger()->error("MqttClient > CONNACK 收到错误：{0}", pv.get<am::system_error>().what());
-            co_return;
+    MqttConnectionOptions parse_connection_options(const std::string_view id, const JsonObject& config,
+                                                   IEngine* engine) const {
+        MqttConnectionOptions options{
+            .host = std::string(this->host()),
+            .port = this->port(),
+            .protocol_version = edgelink::value_or(config, "protocolVersion", std::string_view("4")) == "5"
+                                    ? am::protocol_version::v5
+                                    : am::protocol_version::v3_1_1,
+            .client_id = std::string(edgelink::value_or(config, "clientid", std::string_view(""))),
+            .keep_alive = static_cast<uint16_t>(
+                std::min(edgelink::value_or<unsigned int>(config, "keepalive", 60U), 0xFFFFU)),
+            .clean_session = edgelink::value_or(config, "cleansession", true),
+            .connect_props = parse_connect_properties(config),
+            .window_size =
+                std::max(edgelink::value_or<unsigned int>(config, "publishWindow", DEFAULT_PUBLISH_WINDOW), 1U),
+            .topic_alias_maximum = static_cast<uint16_t>(std::min(
+                edgelink::value_or<unsigned int>(config, "topicAliasMaximum", DEFAULT_TOPIC_ALIAS_MAXIMUM), 0xFFFFU)),
+            .store = parse_store_options(id, config, engine),
+            .store_fsync_interval = std::chrono::milliseconds(
+                std::max(edgelink::value_or<unsigned int>(config, "storeFsyncInterval", 1000U), 10U)),
+        };
+        if (options.client_id.empty()) {
+            // 同一个 broker 上的客户端标识符不能重复，默认用节点 ID 区分
+            options.client_id = fmt::format("edgelink-{0}", id);
         }
+        return options;
+    }
 
-        this->logger()->info("MQTT 已连接：{0}:{1}", this->host(), this->port());
+    static std::optional<SegmentLogOptions> parse_store_options(const std::string_view id, const JsonObject& config,
+                                                                IEngine* engine) {
+        if (!edgelink::value_or(config, "storeForward", false)) {
+            return std::nullopt;
+        }
+        auto const path = edgelink::value_or(config, "storePath", std::string_view(""));
+        constexpr size_t MiB = 1024 * 1024;
+        return SegmentLogOptions{
+            .directory = path.empty() ? engine->settings().home_path / "mqtt-store" / std::string(id)
+                                      : std::filesystem::path(path),
+            .segment_bytes = edgelink::value_or<unsigned int>(config, "storeSegmentMB", 4U) * MiB,
+            .max_bytes = edgelink::value_or<unsigned int>(config, "storeMaxMB", 64U) * MiB,
+            .fsync = parse_fsync_policy(edgelink::value_or(config, "storeFsync", std::string_view("interval"))),
+        };
     }
 
-    /// @brief 关闭连接
-    /// @return
-    Awaitable<void> async_close() noexcept {
-        BOOST_ASSERT(_lock);
-        co_await _endpoint->close(asio::use_awaitable);
-        this->logger()->info("MQTT 连接已断开，主机：{0}:{1}", this->host(), this->port());
+    /// @brief v5 CONNECT 报文的属性：会话过期时间和用户属性
+    static am::properties parse_connect_properties(const JsonObject& config) {
+        am::properties props;
+        if (auto expiry = edgelink::value_or(config, "sessionExpiry", std::string_view("")); !expiry.empty()) {
+            props.emplace_back(am::property::session_expiry_interval{boost::lexical_cast<uint32_t>(expiry)});
+        }
+        if (auto user_props = edgelink::value_or(config, "userProps", std::string_view("")); !user_props.empty()) {
+            for (auto const& [key, value] : boost::json::parse(user_props).as_object()) {
+                auto text = value.is_string() ? std::string(value.as_string()) : boost::json::serialize(value);
+                props.emplace_back(am::property::user_property{am::allocate_buffer(key), am::allocate_buffer(text)});
+            }
+        }
+        return props;
     }
-     
 
   private:
-    std::unique_ptr<Endpoint> _endpoint;
+    static constexpr unsigned int DEFAULT_PUBLISH_WINDOW = 16;
+    static constexpr unsigned int DEFAULT_TOPIC_ALIAS_MAXIMUM = 16;
+    static constexpr unsigned int MAX_CONNECTIONS = 64;
 
-    std::unique_ptr<channel<void()>> _lock; //{socket_.get_executor(), 1};
-    //std::unique_ptr<async::AsyncLock<boost::asio::any_io_executor>> _lock;
+    MqttSubscriptions _subscriptions;
+    std::vector<std::shared_ptr<MqttConnection>> _connections; ///< 构造以后不再变化，可以在任何线程读取
 };
 
 RTTR_PLUGIN_REGISTRATION {
@@ -0,0 +1,800 @@
+#include <async_mqtt/all.hpp>
+#include <edgelink/plugin.hpp>
+#include "mqtt.hpp"
+#include "topic-trie.hpp"
+#include "topic-alias.hpp"
+#include "mqtt-connection.hpp"
+
+using namespace edgelink;
+
+namespace edgelink::plugins::mqtt {
+
+JsonObject MqttConnectionStats::to_json() const {
+    JsonObject json;
+    json["published"] = published.load(std::memory_order_relaxed);
+    json["failed"] = failed.load(std::memory_order_relaxed);
+    json["dropped"] = dropped.load(std::memory_order_relaxed);
+    json["stored"] = stored.load(std::memory_order_relaxed);
+    json["replayed"] = replayed.load(std::memory_order_relaxed);
+    json["connects"] = connects.load(std::memory_order_relaxed);
+    json["disconnects"] = disconnects.load(std::memory_order_relaxed);
+    json["inFlight"] = in_flight.load(std::memory_order_relaxed);
+    json["backlog"] = backlog.load(std::memory_order_relaxed);
+    return json;
+}
+
+std::optional<async_mqtt::qos> MqttSubscriptions::add(const std::string_view filter, async_mqtt::qos qos,
+                                                      IMqttSubscriber* subscriber) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _trie.insert(filter, subscriber);
+    auto it = _filters.find(filter);
+    if (it == _filters.end()) {
+        _filters.emplace(std::string(filter), FilterState{.qos = qos, .count = 1});
+        return qos;
+    }
+    it->second.count++;
+    if (qos <= it->second.qos) {
+        return std::nullopt;
+    }
+    it->second.qos = qos;
+    return qos;
+}
+
+void MqttSubscriptions::remove(const std::string_view filter, IMqttSubscriber* subscriber) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_trie.erase(filter, subscriber)) {
+        auto it = _filters.find(filter);
+        if (it != _filters.end() && --it->second.count == 0) {
+            _filters.erase(it);
+        }
+    }
+}
+
+std::vector<async_mqtt::topic_subopts> MqttSubscriptions::entries() const {
+    std::vector<async_mqtt::topic_subopts> result;
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto const& [filter, state] : _filters) {
+        result.push_back({async_mqtt::allocate_buffer(filter), state.qos});
+    }
+    return result;
+}
+
+void MqttSubscriptions::dispatch(const async_mqtt::buffer& topic, const async_mqtt::buffer& payload,
+                                 async_mqtt::qos qos, bool retain) const {
+    // 在锁内回调，`remove()` 返回以后订阅者不会再收到消息
+    std::lock_guard<std::mutex> lock(_mutex);
+    _trie.match(std::string_view(topic.data(), topic.size()),
+                [&](IMqttSubscriber* subscriber) { subscriber->on_mqtt_publish(topic, payload, qos, retain); });
+}
+
+template <typename PublishPacket> void MqttConnection::dispatch_publish(const PublishPacket& p) {
+    if (!_subscriptions) {
+        return;
+    }
+    auto const& topic = p.topic();
+    // 收到的报文负载一般只有一段，直接引用；否则才拼接
+    auto const& payloads = p.payload();
+    am::buffer payload;
+    if (payloads.size() == 1) {
+        payload = payloads.front();
+    } else {
+        std::string joined;
+        for (auto const& part : payloads) {
+            joined.append(part.data(), part.size());
+        }
+        payload = am::allocate_buffer(joined);
+    }
+    auto const qos = p.opts().get_qos();
+    auto const retain = p.opts().get_retain() == am::pub::retain::yes;
+
+    _subscriptions->dispatch(topic, payload, qos, retain);
+}
+
+template <typename V311Packet, typename V5Packet>
+am::packet_variant MqttConnection::make_ack(am::packet_id_t pid) const {
+    if (_options.protocol_version == am::protocol_version::v5) {
+        return V5Packet{pid};
+    }
+    return V311Packet{pid};
+}
+
+Awaitable<void> MqttConnection::async_start() {
+    if (_lock) {
+        throw std::logic_error("MqttConnection 已启动，不能再次启动");
+    }
+    // 连接和断开不能与其他操作并发
+    _lock = std::make_unique<channel<void()>>(_strand, 1);
+    _window = std::make_unique<channel<void()>>(_strand, _options.window_size);
+
+    if (_options.store) {
+        _store = std::make_unique<SegmentLog>(*_options.store);
+        _stats.backlog = _store->size();
+        if (!_store->empty()) {
+            _logger->info("MQTT 磁盘队列中有 {0} 条待发送的消息", _store->size());
+        }
+        if (_store->options().fsync == FsyncPolicy::INTERVAL) {
+            _sync_timer = std::make_unique<asio::steady_timer>(_strand);
+            this->spawn_detached(this->async_sync_loop());
+        }
+    }
+
+    if (_options.auto_reconnect || _store) {
+        // 连不上 broker 不影响启动，由后台协程负责重连和补发
+        _link_closed = std::make_unique<channel<void()>>(_strand, 1);
+        _retry_timer = std::make_unique<asio::steady_timer>(_strand);
+        this->spawn_detached(this->async_supervise());
+        co_return;
+    }
+
+    co_await this->async_lock();
+    try {
+        co_await this->async_connect();
+    } catch (std::exception& ex) {
+        auto error_msg = fmt::format("MQTT 连接失败：{0}", ex.what());
+        _logger->error(error_msg);
+        this->unlock();
+        throw;
+    }
+    this->unlock();
+}
+
+Awaitable<void> MqttConnection::async_stop() {
+    _stopping = true;
+    _live = false;
+    if (_retry_timer) {
+        _retry_timer->cancel();
+        _link_closed->cancel();
+    }
+    if (_sync_timer) {
+        _sync_timer->cancel();
+    }
+
+    co_await this->async_close();
+    // 读取协程会因连接关闭而退出，这里再确保没有等待应答的发布者被遗留
+    this->fail_pending(asio::error::operation_aborted);
+    if (_lock) {
+        _lock->cancel();
+        _lock.reset();
+    }
+
+    if (_store) {
+        try {
+            _store->sync();
+        } catch (std::exception& ex) {
+            _logger->error("MQTT 磁盘队列刷盘失败：{0}", ex.what());
+        }
+    }
+}
+
+Awaitable<void> MqttConnection::async_publish(const std::string_view topic, const async_mqtt::buffer& payload_buffer,
+                                              async_mqtt::qos qos, const PublishPropertiesPtr& props) {
+    // QoS0 发出即可，不等待切换 strand，也不等待写入完成；存储转发时只有在没有积压的情况下才能直接发。
+    // 是否已连接由 `flush_qos0()` 在本连接的 strand 上判断，未连接时丢弃（或者转存）并计数，不对每条消息抛出异常
+    if (qos == am::qos::at_most_once && (!_options.store || _live)) {
+        this->enqueue_qos0(QueuedPublish{am::allocate_buffer(topic), payload_buffer, props});
+        co_return;
+    }
+
+    // 调用者运行在其他节点的 strand 上，切换到本连接的 strand 再访问连接
+    if (_options.store) {
+        co_await asio::co_spawn(_strand, this->async_publish_or_store(topic, payload_buffer, qos, props),
+                                asio::use_awaitable);
+    } else {
+        co_await asio::co_spawn(_strand, this->async_publish_internal(topic, payload_buffer, qos, props),
+                                asio::use_awaitable);
+    }
+}
+
+void MqttConnection::subscribe(const std::string_view filter, async_mqtt::qos qos) {
+    std::vector<am::topic_subopts> entries{{am::allocate_buffer(filter), qos}};
+    this->spawn_detached(this->async_subscribe_if_connected(std::move(entries)));
+}
+
+Awaitable<void> MqttConnection::async_publish_internal(const std::string_view topic,
+                                                       const async_mqtt::buffer& payload_buffer, async_mqtt::qos qos,
+                                                       const PublishPropertiesPtr& props) {
+    if (!this->is_connected()) {
+        throw IOException(fmt::format("MQTT 未连接：{0}:{1}", _options.host, _options.port));
+    }
+
+    BOOST_ASSERT(qos != am::qos::at_most_once);
+    auto topic_buffer = am::allocate_buffer(topic);
+
+    // 窗口满了就在这里等待，窗口内的发布是流水线式的，吞吐量不再受往返时间限制
+    co_await _window->async_send(asio::deferred);
+    WindowSlot slot(*_window);
+
+    auto pid = co_await _endpoint->acquire_unique_packet_id(asio::use_awaitable);
+    if (!pid) {
+        throw IOException("MQTT 报文标识符已耗尽");
+    }
+
+    auto exe = co_await asio::this_coro::executor;
+    auto pending = std::make_shared<PendingPublish>(exe);
+    _pending.insert_or_assign(*pid, pending);
+    _stats.in_flight = _pending.size();
+
+    auto se = co_await _endpoint->send(this->make_publish_packet(*pid, topic_buffer, payload_buffer, qos, props),
+                                       asio::use_awaitable);
+    if (se) {
+        _pending.erase(*pid);
+        _stats.in_flight = _pending.size();
+        _stats.failed++;
+        auto error_msg = fmt::format("MQTT PUBLISH send error: {0}", se.what());
+        _logger->error(error_msg);
+        throw IOException(error_msg);
+    }
+
+    boost::system::error_code ec;
+    co_await pending->done.async_receive(asio::redirect_error(asio::use_awaitable, ec));
+    if (ec == asio::error::no_permission) {
+        _stats.failed++;
+        auto error_msg = fmt::format("MQTT broker 拒绝了消息：[pid={0}, topic='{1}']", *pid, topic);
+        _logger->error(error_msg);
+        throw MqttRejectedException(error_msg);
+    }
+    if (ec) {
+        _stats.failed++;
+        auto error_msg = fmt::format("MQTT PUBLISH 未收到应答：[pid={0}] {1}", *pid, ec.message());
+        _logger->error(error_msg);
+        throw IOException(error_msg);
+    }
+    _stats.published++;
+    co_return;
+}
+
+Awaitable<void> MqttConnection::async_read_loop() {
+    for (;;) {
+        am::packet_variant pv = co_await _endpoint->recv(asio::use_awaitable);
+        if (!pv) {
+            auto const& se = pv.get<am::system_error>();
+            _logger->debug("MQTT 读取结束：{0}", se.what());
+            _live = false;
+            _connected = false;
+            _stats.disconnects++;
+            this->fail_pending(se.code() ? se.code() : make_error_code(asio::error::connection_aborted));
+            // 对方断开以后 socket 仍然是打开的，关掉它
+            co_await _endpoint->close(asio::use_awaitable);
+            if (_link_closed) {
+                _link_closed->try_send();
+            }
+            co_return;
+        }
+
+        std::optional<am::packet_id_t> pubrec_pid;
+        std::optional<am::packet_variant> response;
+        auto on_publish = [&](auto const& p) {
+            this->dispatch_publish(p);
+            // 收到的 QoS1/QoS2 消息按协议应答，QoS2 先回 PUBREC，等对方的 PUBREL 再回 PUBCOMP
+            if (p.opts().get_qos() == am::qos::at_least_once) {
+                response.emplace(this->make_ack<am::v3_1_1::puback_packet, am::v5::puback_packet>(p.packet_id()));
+            } else if (p.opts().get_qos() == am::qos::exactly_once) {
+                response.emplace(this->make_ack<am::v3_1_1::pubrec_packet, am::v5::pubrec_packet>(p.packet_id()));
+            }
+        };
+        auto on_pubrel = [&](auto const& p) {
+            response.emplace(this->make_ack<am::v3_1_1::pubcomp_packet, am::v5::pubcomp_packet>(p.packet_id()));
+        };
+        pv.visit(am::overload{
+            [&](am::v3_1_1::puback_packet const& p) { this->complete_pending(p.packet_id(), {}); },
+            [&](am::v3_1_1::pubrec_packet const& p) { pubrec_pid = p.packet_id(); },
+            [&](am::v3_1_1::pubcomp_packet const& p) { this->complete_pending(p.packet_id(), {}); },
+            [&](am::v3_1_1::publish_packet const& p) { on_publish(p); },
+            [&](am::v3_1_1::pubrel_packet const& p) { on_pubrel(p); },
+            [&](am::v3_1_1::suback_packet const& p) {
+                _logger->debug("MQTT SUBACK recv pid: {0}", p.packet_id());
+            },
+            // v5 的应答带有原因码，大于等于 0x80 表示 broker 拒绝了这条消息
+            [&](am::v5::puback_packet const& p) {
+                this->complete_pending(p.packet_id(), reason_code_error(static_cast<uint8_t>(p.code())));
+            },
+            [&](am::v5::pubrec_packet const& p) {
+                if (auto ec = reason_code_error(static_cast<uint8_t>(p.code()))) {
+                    this->complete_pending(p.packet_id(), ec);
+                } else {
+                    pubrec_pid = p.packet_id();
+                }
+            },
+            [&](am::v5::pubcomp_packet const& p) {
+                this->complete_pending(p.packet_id(), reason_code_error(static_cast<uint8_t>(p.code())));
+            },
+            [&](am::v5::publish_packet const& p) { on_publish(p); },
+            [&](am::v5::pubrel_packet const& p) { on_pubrel(p); },
+            [&](am::v5::suback_packet const& p) {
+                _logger->debug("MQTT SUBACK recv pid: {0}", p.packet_id());
+            },
+            [](auto const&) {}});
+
+        if (response) {
+            if (auto se = co_await _endpoint->send(std::move(*response), asio::use_awaitable)) {
+                _logger->error("MQTT 应答发送失败：{0}", se.what());
+            }
+        }
+
+        // QoS2 的第二步：收到 PUBREC 后回复 PUBREL，发布者继续等待 PUBCOMP
+        if (pubrec_pid) {
+            auto se = co_await _endpoint->send(
+                this->make_ack<am::v3_1_1::pubrel_packet, am::v5::pubrel_packet>(*pubrec_pid), asio::use_awaitable);
+            if (se) {
+                _logger->error("MQTT PUBREL send error: {0}", se.what());
+                this->complete_pending(*pubrec_pid, make_error_code(asio::error::broken_pipe));
+            }
+        }
+    }
+}
+
+Awaitable<void> MqttConnection::async_subscribe_all() {
+    if (!_subscriptions) {
+        co_return;
+    }
+    auto entries = _subscriptions->entries();
+    if (!entries.empty()) {
+        co_await this->async_send_subscribe(std::move(entries));
+    }
+}
+
+Awaitable<void> MqttConnection::async_subscribe_if_connected(std::vector<am::topic_subopts> entries) {
+    if (this->is_connected()) {
+        co_await this->async_send_subscribe(std::move(entries));
+    }
+}
+
+Awaitable<void> MqttConnection::async_send_subscribe(std::vector<am::topic_subopts> entries) {
+    auto pid = co_await _endpoint->acquire_unique_packet_id(asio::use_awaitable);
+    if (!pid) {
+        _logger->error("MQTT 报文标识符已耗尽，无法订阅");
+        co_return;
+    }
+    auto const count = entries.size();
+    auto packet = _options.protocol_version == am::protocol_version::v5
+                      ? am::packet_variant(am::v5::subscribe_packet{*pid, std::move(entries)})
+                      : am::packet_variant(am::v3_1_1::subscribe_packet{*pid, std::move(entries)});
+    if (auto se = co_await _endpoint->send(std::move(packet), asio::use_awaitable)) {
+        _logger->error("MQTT SUBSCRIBE send error: {0}", se.what());
+        co_return;
+    }
+    _logger->info("MQTT 已订阅 {0} 个主题过滤器", count);
+}
+
+void MqttConnection::enqueue_qos0(QueuedPublish packet) {
+    asio::post(_strand, [this, self = this->shared_from_this(), packet = std::move(packet)]() mutable {
+        if (_qos0_queue.size() >= MAX_QOS0_QUEUE) {
+            // QoS0 本来就是“至多一次”，连接跟不上的时候丢弃新消息，不让队列无限增长
+            _qos0_dropped++;
+            return;
+        }
+        _qos0_queue.push_back(std::move(packet));
+        if (!_qos0_flush_scheduled) {
+            // 排在本轮已经投递到 strand 的处理函数之后，同一轮里排队的报文一起写出
+            _qos0_flush_scheduled = true;
+            asio::post(_strand, [this, self] { this->flush_qos0(); });
+        }
+    });
+}
+
+void MqttConnection::flush_qos0() {
+    _qos0_flush_scheduled = false;
+    auto packets = std::exchange(_qos0_queue, {});
+    if (auto dropped = std::exchange(_qos0_dropped, 0)) {
+        _logger->warn("MQTT QoS0 发送队列已满，丢弃了 {0} 条消息", dropped);
+        this->count_dropped(dropped);
+    }
+    if (!this->is_connected() || (_store && !_live)) {
+        if (_store) {
+            // 磁盘队列不保存 v5 发布属性，补发时不带属性
+            for (auto const& packet : packets) {
+                this->store_publish(packet.topic, std::span(&packet.payload, 1), am::qos::at_most_once);
+            }
+            return;
+        }
+        _logger->warn("MQTT 未连接，丢弃了 {0} 条 QoS0 消息", packets.size());
+        this->count_dropped(packets.size());
+        return;
+    }
+    for (auto& packet : packets) {
+        auto publish = this->make_publish_packet(0, packet.topic, packet.payload, am::qos::at_most_once, packet.props);
+        _endpoint->send(std::move(publish), [logger = _logger](am::system_error const& se) {
+            if (se) {
+                logger->error("MQTT PUBLISH send error: {0}", se.what());
+            }
+        });
+    }
+    _stats.published += packets.size();
+}
+
+Awaitable<void> MqttConnection::async_publish_or_store(const std::string_view topic,
+                                                       const async_mqtt::buffer& payload_buffer, async_mqtt::qos qos,
+                                                       const PublishPropertiesPtr& props) {
+    if (_live) {
+        try {
+            if (qos == am::qos::at_most_once) {
+                this->enqueue_qos0(QueuedPublish{am::allocate_buffer(topic), payload_buffer, props});
+            } else {
+                co_await this->async_publish_internal(topic, payload_buffer, qos, props);
+            }
+            co_return;
+        } catch (MqttRejectedException&) {
+            // broker 拒绝的消息转存以后补发也还是会被拒绝，直接丢弃
+            this->count_dropped(1);
+            co_return;
+        } catch (IOException& ex) {
+            _logger->warn("MQTT 发布失败，转存到磁盘队列：{0}", ex.what());
+        }
+    }
+    this->store_publish(am::allocate_buffer(topic), std::array{payload_buffer}, qos);
+}
+
+void MqttConnection::store_publish(const am::buffer& topic, std::span<const am::buffer> payloads, am::qos qos) {
+    std::array<uint8_t, STORE_HEADER_SIZE> header{static_cast<uint8_t>(qos)};
+    auto const topic_size = static_cast<uint16_t>(topic.size());
+    std::memcpy(header.data() + 1, &topic_size, sizeof(topic_size));
+
+    boost::container::small_vector<std::span<const uint8_t>, 4> parts{header, as_bytes(topic)};
+    for (auto const& payload : payloads) {
+        parts.push_back(as_bytes(payload));
+    }
+
+    auto const dropped_before = _store->dropped();
+    if (!_store->append(parts)) {
+        _logger->error("MQTT 消息超过了磁盘队列单个段的大小，已丢弃：'{0}'",
+                       std::string_view(topic.data(), topic.size()));
+        this->count_dropped(1);
+        return;
+    }
+    if (auto dropped = _store->dropped() - dropped_before) {
+        _logger->warn("MQTT 磁盘队列已满，丢弃了最旧的 {0} 条消息", dropped);
+        this->count_dropped(dropped);
+    }
+    _stats.stored++;
+    _stats.backlog = _store->size();
+}
+
+Awaitable<void> MqttConnection::async_supervise() {
+    auto delay = RECONNECT_MIN_DELAY;
+    while (!_stopping) {
+        bool connected = false;
+        co_await this->async_lock();
+        try {
+            co_await this->async_connect();
+            connected = true;
+        } catch (std::exception& ex) {
+            _logger->warn("MQTT 连接失败，{0} 秒后重试：{1}", delay.count(), ex.what());
+        }
+        this->unlock();
+
+        if (connected) {
+            delay = RECONNECT_MIN_DELAY;
+            if (_store) {
+                co_await this->async_replay();
+            } else {
+                _live = true;
+            }
+            boost::system::error_code ec;
+            co_await _link_closed->async_receive(asio::redirect_error(asio::use_awaitable, ec));
+            if (_stopping) {
+                break;
+            }
+            _logger->warn("MQTT 连接已断开，{0} 秒后重连", delay.count());
+        }
+
+        _retry_timer->expires_after(delay);
+        boost::system::error_code ec;
+        co_await _retry_timer->async_wait(asio::redirect_error(asio::use_awaitable, ec));
+        if (!connected) {
+            delay = std::min(delay * 2, RECONNECT_MAX_DELAY);
+        }
+    }
+}
+
+Awaitable<void> MqttConnection::async_replay() {
+    auto const started_at = std::chrono::steady_clock::now();
+    auto reported_at = started_at;
+    size_t replayed = 0;
+    if (!_store->empty()) {
+        _logger->info("MQTT 开始补发磁盘队列中的 {0} 条消息", _store->size());
+    }
+
+    while (this->is_connected() && !_store->empty()) {
+        // 段文件的映射在丢弃旧段时会被解除，发布期间还会有新消息追加进来，所以先把记录复制出来
+        auto batch = _store->peek(_options.window_size);
+        std::vector<StoredPublish> publishes;
+        publishes.reserve(batch.records.size());
+        for (auto const& record : batch.records) {
+            if (auto publish = decode_stored_publish(record)) {
+                publishes.push_back(std::move(*publish));
+            } else {
+                _logger->error("MQTT 磁盘队列中的记录已损坏，跳过");
+                this->count_dropped(1);
+            }
+        }
+
+        auto exe = co_await asio::this_coro::executor;
+        auto results = std::make_shared<channel<void(std::exception_ptr)>>(exe, publishes.size());
+        for (auto& publish : publishes) {
+            asio::co_spawn(_strand, this->async_replay_one(std::move(publish)),
+                           [results](std::exception_ptr ex) { results->try_send(ex); });
+        }
+        bool succeeded = true;
+        size_t rejected = 0;
+        for (size_t i = 0; i < publishes.size(); i++) {
+            try {
+                co_await results->async_receive(asio::use_awaitable);
+            } catch (MqttRejectedException&) {
+                rejected++;
+            } catch (std::exception& ex) {
+                _logger->warn("MQTT 补发失败，重连以后继续：{0}", ex.what());
+                succeeded = false;
+            }
+        }
+        if (!succeeded) {
+            if (this->is_connected()) {
+                // 连接看起来还在，但是补发不下去了：断开它，读取协程退出以后 `async_supervise()` 会重连，
+                // 不这样做的话它会一直等待连接断开
+                co_await this->async_lock();
+                co_await this->async_close();
+                this->unlock();
+            }
+            break;
+        }
+
+        // 同一窗口里的消息可能已经有一部分发出去了，重连以后会再发一次，这符合 QoS1 “至少一次”的语义；
+        // broker 拒绝的消息再发也是一样，计为丢弃
+        _store->consume(batch.first_seq + batch.records.size());
+        if (rejected > 0) {
+            _logger->warn("MQTT broker 拒绝了磁盘队列中的 {0} 条消息，已丢弃", rejected);
+            this->count_dropped(rejected);
+        }
+        replayed += publishes.size() - rejected;
+        this->count_replayed(publishes.size() - rejected);
+        _stats.backlog = _store->size();
+
+        auto const now = std::chrono::steady_clock::now();
+        if (now - reported_at >= DRAIN_REPORT_INTERVAL) {
+            reported_at = now;
+            this->report_drain(replayed, started_at);
+        }
+    }
+
+    if (this->is_connected() && _store->empty()) {
+        // 积压清空以后新消息直接发送，不再经过磁盘；这一步和追加都在本连接的 strand 上，不会漏掉消息
+        _live = true;
+    }
+    if (replayed > 0) {
+        this->report_drain(replayed, started_at);
+    }
+}
+
+Awaitable<void> MqttConnection::async_replay_one(StoredPublish publish) {
+    if (publish.qos == am::qos::at_most_once) {
+        if (!this->is_connected()) {
+            throw IOException(fmt::format("MQTT 未连接：{0}:{1}", _options.host, _options.port));
+        }
+        if (auto se = co_await _endpoint->send(
+                this->make_publish_packet(0, publish.topic, publish.payload, publish.qos, nullptr),
+                asio::use_awaitable)) {
+            throw IOException(fmt::format("MQTT PUBLISH send error: {0}", se.what()));
+        }
+    } else {
+        co_await this->async_publish_internal(std::string_view(publish.topic.data(), publish.topic.size()),
+                                              publish.payload, publish.qos, nullptr);
+    }
+}
+
+void MqttConnection::report_drain(size_t replayed, std::chrono::steady_clock::time_point started_at) {
+    auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started_at).count();
+    _logger->info("MQTT 磁盘队列补发：已发送 {0} 条，剩余 {1} 条，速率 {2:.1f} 条/秒", replayed,
+                  _store->size(), seconds > 0 ? replayed / seconds : 0.0);
+}
+
+Awaitable<void> MqttConnection::async_sync_loop() {
+    while (!_stopping) {
+        _sync_timer->expires_after(_options.store_fsync_interval);
+        boost::system::error_code ec;
+        co_await _sync_timer->async_wait(asio::redirect_error(asio::use_awaitable, ec));
+        try {
+            _store->sync();
+        } catch (std::exception& ex) {
+            _logger->error("MQTT 磁盘队列刷盘失败：{0}", ex.what());
+        }
+    }
+}
+
+am::packet_variant MqttConnection::make_publish_packet(am::packet_id_t pid, const am::buffer& topic,
+                                                      const am::buffer& payload, am::qos qos,
+                                                      const PublishPropertiesPtr& props) {
+    if (_options.protocol_version != am::protocol_version::v5) {
+        return am::v3_1_1::publish_packet{pid, topic, payload, qos};
+    }
+    am::properties packet_props;
+    if (props) {
+        packet_props = *props;
+    }
+    auto alias = _topic_aliases.assign(std::string_view(topic.data(), topic.size()));
+    if (alias.alias == 0) {
+        return am::v5::publish_packet{pid, topic, payload, qos, std::move(packet_props)};
+    }
+    packet_props.emplace_back(am::property::topic_alias{alias.alias});
+    return am::v5::publish_packet{pid, alias.registered ? am::buffer() : topic, payload, qos, std::move(packet_props)};
+}
+
+boost::system::error_code MqttConnection::reason_code_error(uint8_t reason_code) {
+    return reason_code >= 0x80 ? make_error_code(asio::error::no_permission) : boost::system::error_code();
+}
+
+void MqttConnection::complete_pending(am::packet_id_t pid, boost::system::error_code ec) {
+    auto it = _pending.find(pid);
+    if (it == _pending.end()) {
+        return;
+    }
+    it->second->done.try_send(ec);
+    _pending.erase(it);
+    _stats.in_flight = _pending.size();
+}
+
+void MqttConnection::fail_pending(boost::system::error_code ec) {
+    for (auto& [_, pending] : _pending) {
+        pending->done.try_send(ec);
+    }
+    _pending.clear();
+    _stats.in_flight = 0;
+}
+
+void MqttConnection::spawn_detached(Awaitable<void> task) {
+    asio::co_spawn(_strand, std::move(task), [self = this->shared_from_this()](std::exception_ptr ex) {
+        if (ex) {
+            try {
+                std::rethrow_exception(ex);
+            } catch (std::exception& e) {
+                self->_logger->error("MQTT 后台协程异常退出：{0}", e.what());
+            }
+        }
+    });
+}
+
+Awaitable<void> MqttConnection::async_lock() {
+    co_await _lock->async_send(asio::deferred);
+    co_return;
+}
+
+void MqttConnection::unlock() {
+    // 停机时 `async_stop()` 会释放锁，重连协程可能在那之后才退出
+    if (!_lock) {
+        return;
+    }
+    _lock->try_receive([](auto...) {});
+}
+
+Awaitable<void> MqttConnection::async_connect() {
+    BOOST_ASSERT(_lock);
+    _logger->info("开始连接 MQTT：{}:{}", _options.host, _options.port);
+
+    auto exe = co_await asio::this_coro::executor;
+
+    {
+        // 其他线程只读 `_connected`，替换端点之前先把它清掉
+        _connected = false;
+        auto amep = new Endpoint{_options.protocol_version, exe};
+        _endpoint = std::move(std::unique_ptr<Endpoint>(amep));
+        // 写入进行中时发起的发送会排队，并在下一次写入时合并为一次聚集写
+        _endpoint->set_bulk_write(true);
+    }
+
+    // asio::ip::tcp::socket resolve_sock{exe};
+    asio::ip::tcp::resolver resolver(exe);
+
+    // Resolve hostname
+    _logger->debug("MqttConnection > 解析地址");
+
+    auto eps = co_await resolver.async_resolve(_options.host, std::to_string(_options.port), asio::use_awaitable);
+
+    // Layer
+    // am::stream -> TCP
+
+    // Underlying TCP connect
+    _logger->debug("MqttConnection > socket 开始连接");
+    co_await asio::async_connect(_endpoint->next_layer(), eps, asio::use_awaitable);
+
+    // Send MQTT CONNECT
+    auto client_id = am::allocate_buffer(_options.client_id);
+    auto connect_packet =
+        _options.protocol_version == am::protocol_version::v5
+            ? am::packet_variant(am::v5::connect_packet{_options.clean_session, _options.keep_alive, client_id,
+                                                        am::nullopt, // will
+                                                        am::nullopt, // username
+                                                        am::nullopt, // password
+                                                        _options.connect_props})
+            : am::packet_variant(am::v3_1_1::connect_packet{_options.clean_session, _options.keep_alive, client_id,
+                                                            am::nullopt, // will
+                                                            am::nullopt, // username
+                                                            am::nullopt}); // password
+    if (auto se = co_await _endpoint->send(std::move(connect_packet), asio::use_awaitable)) {
+        throw IOException(fmt::format("MQTT CONNECT 发送失败：{0}", se.what()));
+    }
+
+    // Recv MQTT CONNACK
+    uint16_t topic_alias_maximum = 0; // broker 没有给出上限时不能使用主题别名
+    if (am::packet_variant pv = co_await _endpoint->recv(asio::use_awaitable)) {
+        std::optional<std::string> refused;
+        pv.visit(am::overload{
+            [&](am::v3_1_1::connack_packet const& p) {
+                if (p.code() != am::connect_return_code::accepted) {
+                    refused = fmt::format("{0}", static_cast<int>(p.code()));
+                }
+            },
+            [&](am::v5::connack_packet const& p) {
+                if (p.code() != am::connect_reason_code::success) {
+                    refused = fmt::format("{0}", static_cast<int>(p.code()));
+                }
+                for (auto const& prop : p.props()) {
+                    prop.visit(am::overload{
+                        [&](am::property::topic_alias_maximum const& v) { topic_alias_maximum = v.val(); },
+                        [](auto const&) {}});
+                }
+            },
+            [](auto const&) {}});
+        if (refused) {
+            throw IOException(fmt::format("MQTT broker 拒绝了连接，返回码：{0}", *refused));
+        }
+    } else {
+        throw IOException(fmt::format("MQTT CONNACK 接收失败：{0}", pv.get<am::system_error>().what()));
+    }
+
+    // 主题别名只在一个连接内有效
+    _topic_aliases.reset(topic_alias_maximum);
+    _connected = true;
+    _stats.connects++;
+    _logger->info("MQTT 已连接：{0}:{1}，协议版本：{2}", _options.host, _options.port,
+                  _options.protocol_version == am::protocol_version::v5 ? "5" : "3.1.1");
+
+    // 连接建立以后只有这一个协程调用 `recv()`
+    this->spawn_detached(this->async_read_loop());
+
+    co_await this->async_subscribe_all();
+}
+
+Awaitable<void> MqttConnection::async_close() noexcept {
+    BOOST_ASSERT(_lock);
+    _connected = false;
+    if (!_endpoint) {
+        co_return;
+    }
+    co_await _endpoint->close(asio::use_awaitable);
+    _logger->info("MQTT 连接已断开，主机：{0}:{1}", _options.host, _options.port);
+}
+
+std::optional<MqttConnection::StoredPublish> MqttConnection::decode_stored_publish(std::span<const uint8_t> record) {
+    if (record.size() < STORE_HEADER_SIZE) {
+        return std::nullopt;
+    }
+    uint16_t topic_size = 0;
+    std::memcpy(&topic_size, record.data() + 1, sizeof(topic_size));
+    if (record[0] > static_cast<uint8_t>(am::qos::exactly_once) || record.size() < STORE_HEADER_SIZE + topic_size) {
+        return std::nullopt;
+    }
+    auto const text = std::string_view(reinterpret_cast<const char*>(record.data()), record.size());
+    return StoredPublish{
+        .topic = am::allocate_buffer(text.substr(STORE_HEADER_SIZE, topic_size)),
+        .payload = am::allocate_buffer(text.substr(STORE_HEADER_SIZE + topic_size)),
+        .qos = static_cast<am::qos>(record[0]),
+    };
+}
+
+std::span<const uint8_t> MqttConnection::as_bytes(const am::buffer& buffer) {
+    return std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size());
+}
+
+void MqttConnection::count_dropped(uint64_t count) {
+    _stats.dropped += count;
+    if (_metrics) {
+        _metrics->add_dropped(count);
+    }
+}
+
+void MqttConnection::count_replayed(uint64_t count) {
+    _stats.replayed += count;
+    if (_metrics) {
+        _metrics->add_out(count);
+    }
+}
+
+}; // namespace edgelink::plugins::mqtt
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <boost/asio/experimental/channel.hpp>
+
+namespace edgelink::plugins::mqtt {
+
+namespace asio = boost::asio;
+namespace am = async_mqtt;
+using boost::asio::experimental::channel;
+
+/// @brief 一个到 broker 的连接的设置
+struct MqttConnectionOptions {
+    std::string host;
+    uint16_t port = 1883;
+    async_mqtt::protocol_version protocol_version = async_mqtt::protocol_version::v3_1_1;
+    std::string client_id;
+    uint16_t keep_alive = 60;
+    bool clean_session = true;
+    async_mqtt::properties connect_props; ///< 只在 v5 下发送
+    unsigned int window_size = 16;        ///< 同时等待应答的 QoS1/QoS2 消息的最大数量
+    uint16_t topic_alias_maximum = 16;    ///< v5 下本端最多使用的主题别名数量
+    bool auto_reconnect = false;          ///< 连不上或者断开以后在后台重连，启动不会因为连接失败而失败
+    std::optional<SegmentLogOptions> store; ///< 存储转发的磁盘队列，启用时总是自动重连
+    std::chrono::milliseconds store_fsync_interval{1000};
+};
+
+/// @brief 一个连接的统计，可以在任何线程读取
+struct MqttConnectionStats {
+    std::atomic<uint64_t> published = 0;   ///< 已经发出的消息，QoS1/QoS2 的要收到应答才算
+    std::atomic<uint64_t> failed = 0;      ///< 发布失败的 QoS1/QoS2 消息
+    std::atomic<uint64_t> dropped = 0;     ///< 因为未连接或者队列满了而丢弃的消息
+    std::atomic<uint64_t> stored = 0;      ///< 存入磁盘队列的消息
+    std::atomic<uint64_t> replayed = 0;    ///< 从磁盘队列补发的消息
+    std::atomic<uint64_t> connects = 0;    ///< 成功建立连接的次数
+    std::atomic<uint64_t> disconnects = 0; ///< 连接断开的次数
+    std::atomic<size_t> in_flight = 0;     ///< 正在等待应答的消息
+    std::atomic<size_t> backlog = 0;       ///< 磁盘队列里还没有补发的消息
+
+    JsonObject to_json() const;
+};
+
+/// @brief 一个 broker 节点上所有 `mqtt in` 节点的订阅，按主题过滤器组织成前缀树
+///
+/// 订阅者在自己的线程里注册，连接的读取协程在连接的 strand 上分发，所以用互斥锁保护。
+class MqttSubscriptions {
+  public:
+    /// @brief 加入订阅，返回需要向 broker 发送 SUBSCRIBE 的 QoS：过滤器是新的或者 QoS 提高了；否则返回空
+    std::optional<async_mqtt::qos> add(const std::string_view filter, async_mqtt::qos qos,
+                                       IMqttSubscriber* subscriber);
+
+    /// @brief 移除订阅，不发送 UNSUBSCRIBE：节点一般在停机时才取消订阅，之后收到的消息找不到订阅者，直接丢弃
+    void remove(const std::string_view filter, IMqttSubscriber* subscriber);
+
+    /// @brief 所有的过滤器和它们要求的最高 QoS，连接建立以后放在一个 SUBSCRIBE 报文里订阅
+    std::vector<async_mqtt::topic_subopts> entries() const;
+
+    /// @brief 分发给匹配的订阅者，代价只与主题层数有关，与订阅者数量无关
+    void dispatch(const async_mqtt::buffer& topic, const async_mqtt::buffer& payload, async_mqtt::qos qos,
+                  bool retain) const;
+
+  private:
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(const std::string_view sv) const { return std::hash<std::string_view>{}(sv); }
+    };
+
+    struct FilterState {
+        async_mqtt::qos qos; ///< 同一过滤器的订阅者要求的最高 QoS
+        size_t count;        ///< 使用该过滤器的订阅者数量
+    };
+
+    mutable std::mutex _mutex;
+    TopicTrie<IMqttSubscriber*> _trie;
+    boost::unordered_flat_map<std::string, FilterState, StringHash, std::equal_to<>> _filters;
+};
+
+/// @brief broker 用 v5 原因码拒绝了发布的消息：重发也不会成功，所以与连接故障区分开，不转存、不重试
+class MqttRejectedException : public IOException {
+  public:
+    using IOException::IOException;
+};
+
+/// @brief 到 broker 的一个 MQTT 连接
+///
+/// 连接上的所有操作都在绑定的 strand 上执行：发布是流水线式的，由唯一的读取协程按报文标识符完成；
+/// QoS0 的发布在同一轮里合并写出；启用存储转发时断网期间的消息写入磁盘队列，重新连上以后按顺序补发。
+/// broker 节点可以持有多个连接，按主题把发布分给它们。连接必须由 `std::shared_ptr` 持有，
+/// 后台的读取、重连和刷盘协程各自持有一个引用，连接在它们都退出以后才会销毁。
+class MqttConnection : public std::enable_shared_from_this<MqttConnection> {
+  public:
+    /// @param subscriptions 为空时连接只用来发布，不订阅
+    /// @param metrics 为空时只记录在 `stats()` 里
+    MqttConnection(MqttConnectionOptions options, std::shared_ptr<spdlog::logger> logger,
+                   MqttSubscriptions* subscriptions, std::shared_ptr<NodeMetrics> metrics)
+        : _options(std::move(options)), _logger(std::move(logger)), _subscriptions(subscriptions),
+          _metrics(std::move(metrics)), _topic_aliases(_options.topic_alias_maximum) {}
+
+    /// @brief 绑定连接使用的 strand，必须在 `async_start()` 之前调用
+    void bind_executor(const asio::any_io_executor& strand) { _strand = strand; }
+
+    const asio::any_io_executor& executor() const { return _strand; }
+
+    /// @brief 开始连接，必须在绑定的 strand 上调用
+    ///
+    /// 不自动重连的时候等待连接建立，连接失败时抛出异常；自动重连的时候在后台连接，立即返回
+    Awaitable<void> async_start();
+
+    /// @brief 断开连接，必须在绑定的 strand 上调用
+    Awaitable<void> async_stop();
+
+    /// @brief 连接是否可用，可以在任何线程调用；端点本身只在本连接的 strand 上访问
+    bool is_connected() const { return _connected.load(std::memory_order_acquire); }
+
+    /// @brief 发布一条消息，可以在任何线程调用
+    Awaitable<void> async_publish(const std::string_view topic, const async_mqtt::buffer& payload_buffer,
+                                  async_mqtt::qos qos, const PublishPropertiesPtr& props);
+
+    /// @brief 向 broker 订阅一个新的过滤器，可以在任何线程调用
+    ///
+    /// 没有连接的时候什么也不做，连接建立以后会一次订阅所有的过滤器
+    void subscribe(const std::string_view filter, async_mqtt::qos qos);
+
+    const MqttConnectionStats& stats() const { return _stats; }
+
+    /// @brief 启用离线存储时才有指标，否则为空
+    const std::shared_ptr<NodeMetrics>& metrics() const { return _metrics; }
+
+    const MqttConnectionOptions& options() const { return _options; }
+
+  private:
+    /// @brief 等待应答的 QoS1/QoS2 发布，读取协程收到 PUBACK 或 PUBCOMP 时通过 `done` 唤醒发布者
+    struct PendingPublish {
+        explicit PendingPublish(const asio::any_io_executor& exe) : done(exe, 1) {}
+        channel<void(boost::system::error_code)> done;
+    };
+
+    /// @brief 排队等待合并写出的一条 QoS0 发布
+    struct QueuedPublish {
+        am::buffer topic;
+        am::buffer payload;
+        PublishPropertiesPtr props;
+    };
+
+    /// @brief 从磁盘队列里读出来的一条发布
+    struct StoredPublish {
+        am::buffer topic;
+        am::buffer payload;
+        am::qos qos;
+    };
+
+    /// @brief 发送窗口中的一个位置，离开作用域时归还
+    class WindowSlot {
+      public:
+        explicit WindowSlot(channel<void()>& window) : _window(window) {}
+        ~WindowSlot() { _window.try_receive([](auto...) {}); }
+
+      private:
+        channel<void()>& _window;
+    };
+
+    Awaitable<void> async_publish_internal(const std::string_view topic, const async_mqtt::buffer& payload_buffer,
+                                           async_mqtt::qos qos, const PublishPropertiesPtr& props);
+
+    /// @brief 连接上唯一的读取协程，按报文标识符把应答分发给等待中的发布者
+    Awaitable<void> async_read_loop();
+
+    /// @brief 按主题过滤器把收到的消息分发给订阅者，代价只与主题层数有关，与订阅者数量无关
+    template <typename PublishPacket> void dispatch_publish(const PublishPacket& p);
+
+    /// @brief 连接建立后把所有过滤器放在一个 SUBSCRIBE 报文里订阅
+    Awaitable<void> async_subscribe_all();
+
+    /// @brief 在本连接的 strand 上判断是否已连接，避免在其他线程读取正在被替换的端点
+    Awaitable<void> async_subscribe_if_connected(std::vector<am::topic_subopts> entries);
+
+    Awaitable<void> async_send_subscribe(std::vector<am::topic_subopts> entries);
+
+    /// @brief 把 QoS0 报文放进本连接 strand 上的队列，可以在任何线程调用
+    void enqueue_qos0(QueuedPublish packet);
+
+    /// @brief 连续发起所有排队的 QoS0 发送，启用了批量写入的端点会把它们合并成一次聚集写
+    void flush_qos0();
+
+    /// @brief 存储转发模式下的发布：没有积压时直接发，否则或者发送失败时追加到磁盘队列，保证消息的先后顺序
+    Awaitable<void> async_publish_or_store(const std::string_view topic, const async_mqtt::buffer& payload_buffer,
+                                           async_mqtt::qos qos, const PublishPropertiesPtr& props);
+
+    /// @brief 把一条发布追加到磁盘队列，记录格式为 [QoS: u8][主题长度: u16][主题][负载]
+    void store_publish(const am::buffer& topic, std::span<const am::buffer> payloads, am::qos qos);
+
+    /// @brief 保持连接：断开以后按指数退避重连，启用存储转发时每次连上都先补发磁盘队列里积压的消息
+    Awaitable<void> async_supervise();
+
+    /// @brief 按顺序补发磁盘队列里的消息，每次取一个窗口的消息并行发布，全部成功以后再移动读游标
+    ///
+    /// broker 拒绝的消息计为丢弃，照样移动读游标；连接还在却补发失败时断开连接，由 `async_supervise()` 重连以后再补发，
+    /// 否则 `_live` 一直为 false，之后的消息都只能进磁盘队列
+    Awaitable<void> async_replay();
+
+    Awaitable<void> async_replay_one(StoredPublish publish);
+
+    void report_drain(size_t replayed, std::chrono::steady_clock::time_point started_at);
+
+    /// @brief `interval` 刷盘策略：定期把磁盘队列写入磁盘
+    Awaitable<void> async_sync_loop();
+
+    /// @brief 按连接的协议版本构造 PUBLISH 报文，必须在发送前一刻在本连接的 strand 上调用
+    ///
+    /// v5 连接上为频繁发布的主题使用别名：第一次带上完整主题登记别名，之后只发别名。
+    /// 同一连接上的报文按调用顺序写出，所以登记一定在使用之前到达 broker。
+    am::packet_variant make_publish_packet(am::packet_id_t pid, const am::buffer& topic, const am::buffer& payload,
+                                           am::qos qos, const PublishPropertiesPtr& props);
+
+    /// @brief 按连接的协议版本构造只带报文标识符的应答报文
+    template <typename V311Packet, typename V5Packet> am::packet_variant make_ack(am::packet_id_t pid) const;
+
+    static boost::system::error_code reason_code_error(uint8_t reason_code);
+
+    void complete_pending(am::packet_id_t pid, boost::system::error_code ec);
+
+    void fail_pending(boost::system::error_code ec);
+
+    /// @brief 在本连接的 strand 上启动后台协程，协程结束之前持有连接的引用
+    void spawn_detached(Awaitable<void> task);
+
+    Awaitable<void> async_lock();
+
+    void unlock();
+
+    Awaitable<void> async_connect();
+
+    /// @brief 关闭连接
+    /// @return
+    Awaitable<void> async_close() noexcept;
+
+    static std::optional<StoredPublish> decode_stored_publish(std::span<const uint8_t> record);
+
+    static std::span<const uint8_t> as_bytes(const am::buffer& buffer);
+
+    void count_dropped(uint64_t count);
+
+    void count_replayed(uint64_t count);
+
+  private:
+    static constexpr size_t MAX_QOS0_QUEUE = 65536;
+    static constexpr size_t STORE_HEADER_SIZE = 3;
+    static constexpr std::chrono::seconds RECONNECT_MIN_DELAY{1};
+    static constexpr std::chrono::seconds RECONNECT_MAX_DELAY{30};
+    static constexpr std::chrono::seconds DRAIN_REPORT_INTERVAL{5};
+
+    const MqttConnectionOptions _options;
+    const std::shared_ptr<spdlog::logger> _logger;
+    MqttSubscriptions* const _subscriptions;
+    const std::shared_ptr<NodeMetrics> _metrics;
+    MqttConnectionStats _stats;
+
+    asio::any_io_executor _strand;
+    std::unique_ptr<Endpoint> _endpoint;      ///< 只在本连接的 strand 上访问
+    std::atomic<bool> _connected = false;     ///< 只在本连接的 strand 上修改，可以在任何线程读取
+    std::unique_ptr<channel<void()>> _lock;   ///< 连接和断开不能与其他操作并发
+    std::unique_ptr<channel<void()>> _window; ///< 容量为窗口大小的信号量
+    boost::unordered_flat_map<am::packet_id_t, std::shared_ptr<PendingPublish>> _pending;
+
+    std::vector<QueuedPublish> _qos0_queue; ///< 只在本连接的 strand 上访问
+    bool _qos0_flush_scheduled = false;
+    size_t _qos0_dropped = 0;
+
+    // 重连和存储转发，除了 `_live` 和 `_stopping` 以外都只在本连接的 strand 上访问
+    std::unique_ptr<SegmentLog> _store;
+    std::unique_ptr<channel<void()>> _link_closed; ///< 读取协程退出时通知重连协程
+    std::unique_ptr<asio::steady_timer> _retry_timer;
+    std::unique_ptr<asio::steady_timer> _sync_timer;
+    std::atomic<bool> _live = false; ///< 已连接并且磁盘队列已经清空，新消息可以直接发送
+    std::atomic<bool> _stopping = false;
+
+    TopicAliasAllocator _topic_aliases; ///< 只在本连接的 strand 上访问
+};
+
+}; // namespace edgelink::plugins::mqtt
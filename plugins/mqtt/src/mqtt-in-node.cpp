@@ -1,7 +1,11 @@
+#include <boost/asio/experimental/channel.hpp>
+
 #include <edgelink/plugin.hpp>
 #include "mqtt.hpp"
+#include "topic-trie.hpp"
 
 using namespace edgelink;
+using boost::asio::experimental::channel;
 
 namespace edgelink::plugins::mqtt {
 
@@ -29,33 +33,154 @@ namespace edgelink::plugins::mqtt {
     },
 */
 
-class MqttInNode : public SourceNode, public std::enable_shared_from_this<MqttInNode> {
+namespace {
+
+/// @brief 检查是否为合法的 UTF-8 序列（不检查过长编码和代理区）
+bool is_utf8(const std::string_view text) {
+    size_t i = 0;
+    while (i < text.size()) {
+        auto c = static_cast<uint8_t>(text[i]);
+        size_t extra = c < 0x80 ? 0 : (c >> 5) == 0x6 ? 1 : (c >> 4) == 0xe ? 2 : (c >> 3) == 0x1e ? 3 : 4;
+        if (extra == 4 || i + extra >= text.size()) {
+            return false;
+        }
+        for (size_t k = 1; k <= extra; k++) {
+            if ((static_cast<uint8_t>(text[i + k]) >> 6) != 0x2) {
+                return false;
+            }
+        }
+        i += extra + 1;
+    }
+    return true;
+}
+
+}; // namespace
+
+class MqttInNode : public SourceNode, public IMqttSubscriber {
   public:
+    /// @brief 已经转到本节点 strand 上、还没有发送完的消息数上限，超出的消息直接丢弃
+    static constexpr size_t MAX_PENDING_EMITS = 1024;
+
     MqttInNode(const std::string_view id, const JsonObject& config, const INodeDescriptor* desc, IFlow* flow)
         : SourceNode(id, desc, flow, config), _mqtt_broker_node_id(config.at("broker").as_string()),
           _topic(config.at("topic").as_string()),
-          _qos(boost::lexical_cast<uint8_t>(config.at("qos").as_string().c_str())),
-          _data_type(config.at("datatype").as_string()), _nl(config.at("nl").as_bool()),
-          _rap(config.at("rap").as_bool()), _rh(config.at("rh").to_number<int>()),
-          _inputs(config.at("input").to_number<size_t>()) {
-        //
+          _qos(static_cast<async_mqtt::qos>(edgelink::value_or<int>(config, "qos", 0))),
+          _data_type(edgelink::value_or(config, "datatype", std::string_view("auto-detect"))),
+          _nl(edgelink::value_or(config, "nl", false)), _rap(edgelink::value_or(config, "rap", true)),
+          _rh(edgelink::value_or<int>(config, "rh", 0)),
+          _inputs(edgelink::value_or<unsigned int>(config, "inputs", 0)) {
+        if (_qos > async_mqtt::qos::exactly_once) {
+            throw InvalidDataException(fmt::format("'mqtt in' 节点的 QoS 无效：{0}", static_cast<int>(_qos)));
+        }
+        if (!TopicTrie<IMqttSubscriber*>::is_valid_filter(_topic)) {
+            throw InvalidDataException(fmt::format("'mqtt in' 节点的主题过滤器无效：'{0}'", _topic));
+        }
+        // 引擎在创建流程之前已经创建了全局节点，broker 的 ID 写错时在创建流程的时候就报错
+        _broker = this->flow()->engine()->resolve_global_node<IMqttBrokerEndpoint>(_mqtt_broker_node_id);
     }
 
-  protected:
-    Awaitable<void> on_async_run() override {
-        //
+    Awaitable<void> async_start() override {
+        // 同一个 broker 上的所有 `mqtt in` 节点共用 broker 节点的连接和读取协程，这里只注册一次订阅，
+        // 不另外启动协程，订阅失败的异常交给流程记录
+        _broker->subscribe(_topic, _qos, this);
         co_return;
     }
 
+    Awaitable<void> async_stop() override {
+        _broker->unsubscribe(_topic, this);
+        // `unsubscribe()` 返回以后不会再有新的消息转过来，等已经转过来的消息发送完，节点才能被销毁
+        co_await boost::asio::co_spawn(this->executor(), this->async_wait_idle(), boost::asio::use_awaitable);
+    }
+
+    void on_mqtt_publish(const async_mqtt::buffer& topic, const async_mqtt::buffer& payload, async_mqtt::qos qos,
+                         bool retain) override {
+        // 运行在 broker 的 strand 上，不能等待下游：下游处理不过来时积压的消息有上限，超出的丢弃
+        if (_pending.fetch_add(1, std::memory_order_relaxed) >= MAX_PENDING_EMITS) {
+            _pending.fetch_sub(1, std::memory_order_relaxed);
+            auto const dropped = _dropped.fetch_add(1, std::memory_order_relaxed) + 1;
+            if (std::has_single_bit(dropped)) {
+                this->logger()->warn("'mqtt in' 节点积压的消息超过 {0} 条，新消息被丢弃（累计 {1} 条）",
+                                     MAX_PENDING_EMITS, dropped);
+            }
+            return;
+        }
+        // 复制缓冲区只增加引用计数，转到本节点的 strand 上再构造消息
+        boost::asio::co_spawn(this->executor(), this->async_emit(topic, payload, qos, retain),
+                              [this](std::exception_ptr ex) { this->on_emit_done(ex); });
+    }
+
+  protected:
+    Awaitable<void> on_async_run() override { co_return; }
+
+  private:
+    /// @brief 在本节点的 strand 上执行
+    void on_emit_done(std::exception_ptr ex) {
+        if (ex) {
+            try {
+                std::rethrow_exception(ex);
+            } catch (std::exception& e) {
+                this->logger()->error("'mqtt in' 节点发送消息出错：{0}", e.what());
+            }
+        }
+        if (_pending.fetch_sub(1, std::memory_order_acq_rel) == 1 && _idle) {
+            _idle->try_send();
+        }
+    }
+
+    /// @brief 在本节点的 strand 上执行，和 `on_emit_done` 串行，不会错过最后一次通知
+    Awaitable<void> async_wait_idle() {
+        if (_pending.load(std::memory_order_acquire) == 0) {
+            co_return;
+        }
+        _idle = std::make_unique<channel<void()>>(this->executor(), 1);
+        co_await _idle->async_receive(boost::asio::use_awaitable);
+    }
+
+    Awaitable<void> async_emit(async_mqtt::buffer topic, async_mqtt::buffer payload, async_mqtt::qos qos,
+                               bool retain) {
+        auto msg = std::make_shared<Msg>(this->flow()->create_msg_storage(), this);
+        msg->set_topic(std::string_view(topic.data(), topic.size()));
+
+        const std::string_view text(payload.data(), payload.size());
+        if (_data_type == "buffer" || !is_utf8(text)) {
+            // 负载直接引用收到的报文，不经过 `std::string`
+            auto owner = std::make_shared<async_mqtt::buffer>(std::move(payload));
+            auto bytes = std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(owner->data()), owner->size());
+            msg->set_payload(MsgBuffer(std::move(owner), bytes));
+        } else if (_data_type == "utf8") {
+            msg->set_payload(JsonValue(text, msg->storage()));
+        } else {
+            // `json` 和 `auto-detect`：能解析成 JSON 就用解析结果，自动识别时解析失败就当作字符串
+            boost::system::error_code ec;
+            auto parsed = boost::json::parse(text, ec, msg->storage());
+            if (!ec) {
+                msg->set_payload(std::move(parsed));
+            } else if (_data_type == "json") {
+                this->logger()->error("'mqtt in' 节点收到的负载不是合法的 JSON：{0}", ec.message());
+                co_return;
+            } else {
+                msg->set_payload(JsonValue(text, msg->storage()));
+            }
+        }
+
+        msg->insert_or_assign("qos", JsonValue(static_cast<int64_t>(qos)));
+        msg->insert_or_assign("retain", JsonValue(retain));
+        co_await this->async_send_to_one_port(std::move(msg));
+    }
+
   private:
     std::string _mqtt_broker_node_id;
+    IMqttBrokerEndpoint* _broker = nullptr; ///< 在构造函数里解析一次
     const std::string _topic;
-    const uint8_t _qos;
+    const async_mqtt::qos _qos;
     const std::string _data_type;
     const bool _nl;
     const bool _rap;
     const int _rh;
     const size_t _inputs;
+    std::atomic<size_t> _pending = 0;       ///< 已经转到本节点 strand 上、还没有发送完的消息
+    std::atomic<size_t> _dropped = 0;       ///< 积压超过上限被丢弃的消息
+    std::unique_ptr<channel<void()>> _idle; ///< 停机时等待积压的消息发送完，只在本节点的 strand 上访问
 };
 
 RTTR_PLUGIN_REGISTRATION {
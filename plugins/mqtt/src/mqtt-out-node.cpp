@@ -20,16 +20,24 @@ namespace edgelink::plugins::mqtt {
         "correl": "",
         "expiry": "",
         "broker": "",
+        "maxInFlight": 16,
         "x": 870,
         "y": 320,
         "wires": []
     }
+
+    `maxInFlight` 是 EdgeLink 的扩展：同时交给 broker 节点、等待应答的消息数量，
+    配合 broker 节点的 `publishWindow` 让 QoS1/QoS2 的发布可以流水线式进行
+
+    `respTopic`、`contentType`、`userProps`、`correl` 和 `expiry` 是 MQTT v5 的发布属性，
+    在构造节点时转换一次，之后的每次发布共享同一份属性
 */
 
 class MqttOutNode : public SinkNode, public std::enable_shared_from_this<MqttOutNode> {
   public:
     MqttOutNode(const std::string_view id, const JsonObject& config, const INodeDescriptor* desc, IFlow* flow)
-        : SinkNode(id, desc, flow, config), _mqtt_broker_node_id(config.at("broker").as_string()) {
+        : SinkNode(id, desc, flow, config), _mqtt_broker_node_id(config.at("broker").as_string()),
+          _max_in_flight(std::max(edgelink::value_or<unsigned int>(config, "maxInFlight", DEFAULT_MAX_IN_FLIGHT), 1U)) {
         try {
             //
             if (auto topic_value = config.if_contains("topic")) {
@@ -64,6 +72,11 @@ class MqttOutNode : public SinkNode, public std::enable_shared_from_this<MqttOut
                     // 保持为空
                 }
             }
+
+            _properties = parse_properties(config);
+
+            // 引擎在创建流程之前已经创建了全局节点，这里解析一次，之后任何时候收到消息都能直接使用
+            _broker = this->flow()->engine()->resolve_global_node<IMqttBrokerEndpoint>(_mqtt_broker_node_id);
         } catch (std::exception& ex) {
             this->logger()->error("加载 MQTT Out 节点配置发生错误：{0}", ex.what());
             throw;
@@ -71,40 +84,43 @@ class MqttOutNode : public SinkNode, public std::enable_shared_from_this<MqttOut
     }
 
     Awaitable<void> async_start() override {
-
         this->logger()->info("MQTT OUT > 启动");
         co_return;
     }
 
     Awaitable<void> async_stop() override { co_return; }
 
+    size_t max_in_flight() const override { return _max_in_flight; }
+
     Awaitable<void> receive_async(MsgPtr msg) override {
 
-        if (!msg->data().contains("payload")) {
+        // 只读访问，避免触发消息的写时复制
+        const Msg& cmsg = *msg;
+
+        if (!cmsg.has_payload()) {
             co_return;
         }
 
-        auto topic = _node_topic.has_value() ? std::string_view(*_node_topic)
-                                             : std::string_view(msg->data().at("topic").as_string());
-        auto qos = _node_qos.has_value() ? *_node_qos : async_mqtt::qos(msg->data().at("qos").to_number<int>());
-
-        auto json_payload_value = msg->data().at("payload");
+        auto topic = _node_topic.has_value() ? std::string_view(*_node_topic) : cmsg.topic().value_or("");
+        auto qos = _node_qos.has_value() ? *_node_qos : async_mqtt::qos(cmsg.at("qos").to_number<int>());
 
-        auto mqtt_node = this->flow()->engine()->get_global_node(_mqtt_broker_node_id);
-        auto mqtt = dynamic_cast<IMqttBrokerEndpoint*>(mqtt_node);
-        if (mqtt == nullptr) {
-            auto error_msg = "参数指定的 broker 节点不是 'mqtt-broker' 节点类型";
-            this->logger()->error(error_msg);
-            throw InvalidDataException(error_msg);
+        // 二进制负载直接发送，不经过 JSON
+        if (auto payload_buffer = cmsg.payload_buffer()) {
+            auto bytes = payload_buffer->as_string_view();
+            co_await _broker->async_publish(topic, async_mqtt::allocate_buffer(bytes.begin(), bytes.end()), qos,
+                                           _properties);
+            co_return;
         }
 
+        auto const& json_payload_value = cmsg.payload();
+
         std::optional<async_mqtt::buffer> buf_to_send;
 
         switch (json_payload_value.kind()) {
 
         case JsonKind::array: { // 是数组就假定要发送的是字节数组
             // 注意不能直接发，这里是 boost::array，需要转换 buffer
-            auto json_array = json_payload_value.as_array();
+            auto const& json_array = json_payload_value.as_array();
             std::vector<char> bytes(json_array.size());
             for (size_t i = 0; i < json_array.size(); i++) {
                 auto v = json_array.at(i);
@@ -135,17 +151,59 @@ class MqttOutNode : public SinkNode, public std::enable_shared_from_this<MqttOut
         } // switch
 
         if (buf_to_send) {
-            co_await mqtt->async_publish(topic, *buf_to_send, qos);
+            co_await _broker->async_publish(topic, *buf_to_send, qos, _properties);
         }
 
         co_return;
     }
 
+    Awaitable<void> receive_batch_async(MsgBatchPtr batch) override {
+        // 批量消息里只有数值负载，按列逐个发布
+        auto qos = _node_qos.value_or(async_mqtt::qos::at_most_once);
+        auto const payloads = std::as_const(*batch).payloads();
+        for (size_t i = 0; i < payloads.size(); i++) {
+            auto topic = _node_topic.has_value() ? std::string_view(*_node_topic) : batch->topic_at(i).value_or("");
+            auto payload_text = boost::json::serialize(JsonValue(payloads[i]));
+            co_await _broker->async_publish(topic, async_mqtt::allocate_buffer(payload_text), qos, _properties);
+        }
+    }
+
   private:
+    static PublishPropertiesPtr parse_properties(const JsonObject& config) {
+        namespace am = async_mqtt;
+        am::properties props;
+        if (auto resp_topic = edgelink::value_or(config, "respTopic", std::string_view("")); !resp_topic.empty()) {
+            props.emplace_back(am::property::response_topic{am::allocate_buffer(resp_topic)});
+        }
+        if (auto content_type = edgelink::value_or(config, "contentType", std::string_view(""));
+            !content_type.empty()) {
+            props.emplace_back(am::property::content_type{am::allocate_buffer(content_type)});
+        }
+        if (auto correl = edgelink::value_or(config, "correl", std::string_view("")); !correl.empty()) {
+            props.emplace_back(am::property::correlation_data{am::allocate_buffer(correl)});
+        }
+        if (auto expiry = edgelink::value_or(config, "expiry", std::string_view("")); !expiry.empty()) {
+            props.emplace_back(am::property::message_expiry_interval{boost::lexical_cast<uint32_t>(expiry)});
+        }
+        if (auto user_props = edgelink::value_or(config, "userProps", std::string_view("")); !user_props.empty()) {
+            for (auto const& [key, value] : boost::json::parse(user_props).as_object()) {
+                auto text = value.is_string() ? std::string(value.as_string()) : boost::json::serialize(value);
+                props.emplace_back(am::property::user_property{am::allocate_buffer(key), am::allocate_buffer(text)});
+            }
+        }
+        return props.empty() ? nullptr : std::make_shared<const am::properties>(std::move(props));
+    }
+
+  private:
+    static constexpr unsigned int DEFAULT_MAX_IN_FLIGHT = 16;
+
     std::string _mqtt_broker_node_id;
+    const unsigned int _max_in_flight;
+    IMqttBrokerEndpoint* _broker = nullptr; ///< 在构造函数里解析一次，之后不再变化
     std::optional<std::string> _node_topic;
     std::optional<async_mqtt::qos> _node_qos;
     std::optional<bool> _node_retail;
+    PublishPropertiesPtr _properties; ///< 为空表示没有 v5 发布属性
 };
 
 RTTR_PLUGIN_REGISTRATION {
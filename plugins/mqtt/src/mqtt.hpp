@@ -4,12 +4,31 @@ namespace edgelink::plugins::mqtt {
 
 using Endpoint = async_mqtt::endpoint<async_mqtt::role::client, boost::asio::basic_stream_socket<boost::asio::ip::tcp>>;
 
+/// @brief 接收 broker 转发的 PUBLISH 报文
+///
+/// 回调在 broker 节点的 strand 上执行，实现者应当尽快把工作转交给自己的执行器。
+/// 主题和负载都引用收到的报文的内存，复制它们只增加引用计数。
+struct IMqttSubscriber {
+    virtual void on_mqtt_publish(const async_mqtt::buffer& topic, const async_mqtt::buffer& payload,
+                                 async_mqtt::qos qos, bool retain) = 0;
+};
+
+/// @brief 发布者构造一次、在多次发布之间共享的 MQTT v5 发布属性
+using PublishPropertiesPtr = std::shared_ptr<const async_mqtt::properties>;
+
 struct IMqttBrokerEndpoint {
 
     virtual bool is_connected() const = 0;
 
+    /// @brief 注册订阅，同一个 broker 上所有的订阅共用一个连接和一个读取协程，可以在任何线程调用
+    virtual void subscribe(const std::string_view topic_filter, async_mqtt::qos qos, IMqttSubscriber* subscriber) = 0;
+
+    /// @brief 取消 `subscribe()` 注册的订阅，可以在任何线程调用
+    virtual void unsubscribe(const std::string_view topic_filter, IMqttSubscriber* subscriber) = 0;
+
+    /// @brief 发布一条消息，`props` 是 MQTT v5 的发布属性，可以为空；v3.1.1 连接会忽略它
     virtual Awaitable<void> async_publish(const std::string_view topic, const async_mqtt::buffer& payload_buffer,
-                                          async_mqtt::qos qos) = 0;
+                                          async_mqtt::qos qos, const PublishPropertiesPtr& props) = 0;
 
     virtual Awaitable<void> async_publish_string(const std::string_view topic, const std::string_view payload,
                                                  async_mqtt::qos qos) = 0;
@@ -0,0 +1,118 @@
+#pragma once
+
+namespace edgelink::plugins::mqtt {
+
+/// @brief 为发布最频繁的主题分配 MQTT v5 主题别名
+///
+/// 按主题统计发布次数，用“次数 × 每次能省下的字节数”衡量一个主题值不值得占用别名。别名用完以后，
+/// 新主题的收益要超过收益最低的别名的两倍才会抢占它，避免两个主题来回争夺同一个别名。
+/// 统计的主题数量有上限，超出时把所有计数减半并淘汰归零的主题，让统计跟上流量的变化。
+///
+/// 别名只在一个连接内有效，每次连上以后用 broker 在 CONNACK 里给出的上限调用 `reset()`，
+/// 发布次数的统计会保留下来。不是线程安全的，应当只在 broker 节点的 strand 上使用。
+class TopicAliasAllocator {
+  public:
+    struct Assignment {
+        uint16_t alias = 0;      ///< 0 表示不使用别名
+        bool registered = false; ///< 别名已经在这个连接上登记过，发送时可以省略主题
+    };
+
+    /// @param limit 本端最多使用的别名数量，实际数量还受 broker 允许的上限约束
+    explicit TopicAliasAllocator(uint16_t limit) : _limit(limit) {}
+
+    /// @brief 新连接建立以后调用，`maximum` 是 broker 允许的别名数量，为 0 时不使用别名
+    void reset(uint16_t maximum) {
+        for (auto& [_, entry] : _topics) {
+            entry.alias = 0;
+        }
+        _aliases.clear();
+        _capacity = std::min(maximum, _limit);
+    }
+
+    /// @brief 记录一次发布并决定这次发布是否使用别名
+    Assignment assign(const std::string_view topic) {
+        if (_capacity == 0 || topic.size() <= ALIAS_OVERHEAD) {
+            return {};
+        }
+
+        auto it = _topics.find(topic);
+        if (it == _topics.end()) {
+            if (_topics.size() >= this->candidate_limit()) {
+                this->decay();
+            }
+            it = _topics.emplace(std::string(topic), Entry{}).first;
+        }
+        auto& entry = it->second;
+        entry.count++;
+        if (entry.alias != 0) {
+            return {.alias = entry.alias, .registered = true};
+        }
+        if (entry.count < MIN_PUBLISHES) {
+            return {};
+        }
+
+        uint16_t alias = 0;
+        if (_aliases.size() < _capacity) {
+            _aliases.emplace_back(topic);
+            alias = static_cast<uint16_t>(_aliases.size());
+        } else {
+            size_t victim = 0;
+            uint64_t victim_score = std::numeric_limits<uint64_t>::max();
+            for (size_t i = 0; i < _aliases.size(); i++) {
+                auto const s = score(_topics.find(_aliases[i])->second, _aliases[i].size());
+                if (s < victim_score) {
+                    victim = i;
+                    victim_score = s;
+                }
+            }
+            if (score(entry, topic.size()) <= victim_score * 2) {
+                return {};
+            }
+            _topics.find(_aliases[victim])->second.alias = 0;
+            _aliases[victim] = std::string(topic);
+            alias = static_cast<uint16_t>(victim + 1);
+        }
+        entry.alias = alias;
+        return {.alias = alias, .registered = false};
+    }
+
+    /// @brief 当前连接上已经分配的别名数量
+    size_t size() const { return _aliases.size(); }
+
+  private:
+    struct Entry {
+        uint64_t count = 0;
+        uint16_t alias = 0;
+    };
+
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(const std::string_view sv) const { return std::hash<std::string_view>{}(sv); }
+    };
+
+    static uint64_t score(const Entry& entry, size_t topic_size) { return entry.count * (topic_size - ALIAS_OVERHEAD); }
+
+    size_t candidate_limit() const { return static_cast<size_t>(_limit) * 4 + 64; }
+
+    void decay() {
+        for (auto& [_, entry] : _topics) {
+            entry.count /= 2;
+        }
+        boost::unordered::erase_if(_topics,
+                                   [](auto const& kv) { return kv.second.count == 0 && kv.second.alias == 0; });
+    }
+
+  private:
+    /// @brief 主题别名属性占用的字节数：1 字节属性标识符加 2 字节别名
+    static constexpr size_t ALIAS_OVERHEAD = 3;
+
+    /// @brief 主题至少发布过这么多次才分配别名，只发一次的主题用别名反而多花 3 个字节
+    static constexpr uint64_t MIN_PUBLISHES = 2;
+
+    const uint16_t _limit;
+    uint16_t _capacity = 0;
+    boost::unordered_flat_map<std::string, Entry, StringHash, std::equal_to<>> _topics;
+    std::vector<std::string> _aliases; ///< 第 i 个元素是别名 i + 1 对应的主题
+};
+
+}; // namespace edgelink::plugins::mqtt
@@ -0,0 +1,181 @@
+#pragma once
+
+namespace edgelink::plugins::mqtt {
+
+/// @brief 按 MQTT 主题过滤器组织订阅者的前缀树，支持 `+` 和 `#` 通配符
+///
+/// 树的每一层对应主题的一级。匹配一个主题只沿着主题的各级以及沿途的 `+`、`#` 分支往下走，
+/// 代价取决于主题的层数和实际命中的分支，与订阅者的总数无关。
+///
+/// 按照 MQTT 规范，以 `$` 开头的主题（比如 `$SYS/...`）不会被第一级的通配符匹配。
+template <typename T> class TopicTrie {
+  public:
+    /// @brief 加入订阅，同一个过滤器可以有多个订阅者
+    void insert(const std::string_view filter, T value) {
+        if (!is_valid_filter(filter)) {
+            throw InvalidDataException(fmt::format("无效的 MQTT 主题过滤器：'{0}'", filter));
+        }
+        Node* node = &_root;
+        for_each_level(filter, [&](const std::string_view level) {
+            if (level == "#") {
+                return;
+            } else if (level == "+") {
+                if (!node->plus) {
+                    node->plus = std::make_unique<Node>();
+                }
+                node = node->plus.get();
+            } else {
+                auto it = node->children.find(level);
+                if (it == node->children.end()) {
+                    it = node->children.emplace(std::string(level), std::make_unique<Node>()).first;
+                }
+                node = it->second.get();
+            }
+        });
+        (ends_with_hash(filter) ? node->hash_values : node->values).push_back(std::move(value));
+        _size++;
+    }
+
+    /// @brief 移除一个订阅，返回是否找到；空出来的分支会被回收
+    bool erase(const std::string_view filter, const T& value) {
+        if (!is_valid_filter(filter)) {
+            return false;
+        }
+        std::vector<std::string_view> levels;
+        for_each_level(filter, [&](const std::string_view level) { levels.push_back(level); });
+        if (!erase_at(_root, levels, 0, value)) {
+            return false;
+        }
+        _size--;
+        return true;
+    }
+
+    /// @brief 对与主题匹配的每个订阅调用一次 `visitor(const T&)`，同一订阅者用不同过滤器订阅时会被调用多次
+    template <typename Visitor> void match(const std::string_view topic, Visitor&& visitor) const {
+        boost::container::small_vector<std::string_view, 16> levels;
+        for_each_level(topic, [&](const std::string_view level) { levels.push_back(level); });
+        match_at(_root, std::span<const std::string_view>(levels.data(), levels.size()), 0, visitor);
+    }
+
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    /// @brief 检查过滤器：不能为空，`+` 和 `#` 必须独占一级，`#` 只能在最后一级
+    static bool is_valid_filter(const std::string_view filter) {
+        if (filter.empty()) {
+            return false;
+        }
+        bool valid = true;
+        size_t remaining = filter.size();
+        for_each_level(filter, [&](const std::string_view level) {
+            remaining -= std::min(remaining, level.size() + 1);
+            if (level.find_first_of("+#") == std::string_view::npos) {
+                return;
+            }
+            if (level.size() != 1 || (level == "#" && remaining != 0)) {
+                valid = false;
+            }
+        });
+        return valid;
+    }
+
+  private:
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(const std::string_view sv) const { return std::hash<std::string_view>{}(sv); }
+    };
+
+    struct Node {
+        boost::unordered_flat_map<std::string, std::unique_ptr<Node>, StringHash, std::equal_to<>> children;
+        std::unique_ptr<Node> plus;
+        std::vector<T> values;      ///< 过滤器在这一级结束
+        std::vector<T> hash_values; ///< 过滤器在这一级之后是 `#`
+
+        bool empty() const { return children.empty() && !plus && values.empty() && hash_values.empty(); }
+    };
+
+    /// @brief 按 `/` 切分，保留空的级别（`a//b` 有三级，`/a` 的第一级为空）
+    template <typename Func> static void for_each_level(const std::string_view text, Func&& func) {
+        size_t begin = 0;
+        for (;;) {
+            auto end = text.find('/', begin);
+            if (end == std::string_view::npos) {
+                func(text.substr(begin));
+                return;
+            }
+            func(text.substr(begin, end - begin));
+            begin = end + 1;
+        }
+    }
+
+    static bool ends_with_hash(const std::string_view filter) {
+        return filter == "#" || (filter.size() >= 2 && filter.substr(filter.size() - 2) == "/#");
+    }
+
+    template <typename Visitor>
+    static void match_at(const Node& node, std::span<const std::string_view> levels, size_t depth, Visitor& visitor) {
+        // `a/#` 也匹配 `a` 本身
+        for (auto const& v : node.hash_values) {
+            if (depth > 0 || levels.front().empty() || levels.front().front() != '$') {
+                visitor(v);
+            }
+        }
+        if (depth == levels.size()) {
+            for (auto const& v : node.values) {
+                visitor(v);
+            }
+            return;
+        }
+
+        auto const level = levels[depth];
+        if (auto it = node.children.find(level); it != node.children.end()) {
+            match_at(*it->second, levels, depth + 1, visitor);
+        }
+        if (node.plus && !(depth == 0 && !level.empty() && level.front() == '$')) {
+            match_at(*node.plus, levels, depth + 1, visitor);
+        }
+    }
+
+    static bool erase_value(std::vector<T>& values, const T& value) {
+        auto it = std::find(values.begin(), values.end(), value);
+        if (it == values.end()) {
+            return false;
+        }
+        values.erase(it);
+        return true;
+    }
+
+    static bool erase_at(Node& node, std::span<const std::string_view> levels, size_t depth, const T& value) {
+        if (depth == levels.size()) {
+            return erase_value(node.values, value);
+        }
+        auto const level = levels[depth];
+        if (level == "#") {
+            return erase_value(node.hash_values, value);
+        }
+
+        std::unique_ptr<Node>* child = nullptr;
+        if (level == "+") {
+            child = &node.plus;
+        } else if (auto it = node.children.find(level); it != node.children.end()) {
+            child = &it->second;
+        }
+        if (child == nullptr || !*child || !erase_at(**child, levels, depth + 1, value)) {
+            return false;
+        }
+        if ((*child)->empty()) {
+            if (level == "+") {
+                node.plus.reset();
+            } else {
+                node.children.erase(node.children.find(level));
+            }
+        }
+        return true;
+    }
+
+  private:
+    Node _root;
+    size_t _size = 0;
+};
+
+}; // namespace edgelink::plugins::mqtt
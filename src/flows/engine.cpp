@@ -1,3 +1,5 @@
+#include <boost/asio/experimental/channel.hpp>
+
 #include "edgelink/edgelink.hpp"
 #include "edgelink/flows/dependency-sorter.hpp"
 #include "./engine.hpp"
@@ -9,7 +11,12 @@ namespace edgelink {
 
 Engine::Engine(const EdgeLinkSettings& el_config, const IFlowFactory& flow_factory)
     : _logger(spdlog::default_logger()->clone("Engine")), _settings(el_config), _flow_factory(flow_factory),
-      _flows_json_path(el_config.flows_json_path) {
+      _flows_json_path(el_config.flows_json_path), _metrics(std::make_unique<MetricsRegistry>()) {
+
+    if (el_config.msg_arena_enabled) {
+        _msg_arena_pool = std::make_shared<MsgArenaPool>();
+        _logger->info("已启用消息 arena 分配");
+    }
 
     // std::vector<std::unique_ptr<IFlow>> create_flows(const boost::json::array& flows_config);
 }
@@ -23,6 +30,12 @@ Engine::~Engine() {
     asio::co_spawn(io_context, this->async_stop(), asio::detached);
     io_context.run();
 
+    // 流程和全局节点销毁时要从指标注册表里移除自己的指标，必须先于注册表销毁
+    _flows.clear();
+    _flow_index.clear();
+    _global_node_index.clear();
+    _global_nodes.clear();
+
     _logger->info("流程引擎已关闭");
 }
 
@@ -33,7 +46,11 @@ Awaitable<void> Engine::async_start() {
 
     _logger->info("流程引擎 > 开始加载流配置：'{0}'", _flows_json_path);
 
+    // 重新启动时先销毁上一次的流程，再销毁它们引用的全局节点
     _flows.clear();
+    _flow_index.clear();
+    _global_node_index.clear();
+    _global_nodes.clear();
 
     std::ifstream flows_file(_flows_json_path);
     auto flows_config =
@@ -43,13 +60,18 @@ Awaitable<void> Engine::async_start() {
         throw BadFlowConfigException("There are no node in the configuration file of the flows!");
     }
 
-    auto global_nodes = _flow_factory.create_global_nodes(flows_config, this);
+    // 只遍历一次配置，全局节点和各个流程都从同一个索引里取各自的元素
+    const FlowConfigIndex config_index(flows_config);
+
+    auto global_nodes = _flow_factory.create_global_nodes(config_index, this);
     for (auto& gn : global_nodes) {
+        _global_node_index.insert_or_assign(gn->id(), gn.get());
         _global_nodes.emplace_back(std::move(gn));
     }
 
-    auto flows = _flow_factory.create_flows(flows_config, this);
+    auto flows = _flow_factory.create_flows(config_index, this);
     for (auto& flow : flows) {
+        _flow_index.insert_or_assign(flow->id(), flow.get());
         _flows.emplace_back(std::move(flow));
     }
 
@@ -57,23 +79,71 @@ Awaitable<void> Engine::async_start() {
     _logger->info("开始启动流程引擎");
     _stop_source = std::make_unique<std::stop_source>();
 
-    for (auto& node : _global_nodes) {
-        _logger->debug("正在启动全局节点：{0}", node->id());
-        boost::asio::co_spawn(executor, node->async_start(), boost::asio::detached);
-    }
+    // 全局节点（比如 MQTT broker）要在流程启动之前启动完毕：流程节点在启动和收到消息时就会使用它们，
+    // 它们在启动时设置的执行器等状态也要先于这些访问对其他线程可见
+    co_await this->async_start_global_nodes(executor);
 
     for (auto& flow : _flows) {
         _logger->debug("正在启动流程：{0}", flow->id());
-        boost::asio::co_spawn(executor, flow->async_start(), boost::asio::detached);
+        flow->bind_executor(executor);
+        boost::asio::co_spawn(flow->executor(), flow->async_start(), boost::asio::detached);
+    }
+
+    if (!_settings.metrics_file.empty()) {
+        _metrics_timer = std::make_unique<asio::steady_timer>(asio::make_strand(executor));
+        asio::co_spawn(_metrics_timer->get_executor(), this->async_dump_metrics(_stop_source->get_token()),
+                       asio::detached);
+        _logger->info("节点指标将定期写入：'{0}'", _settings.metrics_file.string());
     }
     _logger->info("流程引擎已启动");
 }
 
+Awaitable<void> Engine::async_start_global_nodes(const asio::any_io_executor& executor) {
+    if (_global_nodes.empty()) {
+        co_return;
+    }
+    // 全局节点之间互不依赖，同时启动，全部完成以后再返回。
+    // channel 不是线程安全的，各个节点的完成通知回到同一个 strand 上发送，也在这个 strand 上等待
+    auto done = std::make_shared<asio::experimental::channel<void()>>(asio::make_strand(executor),
+                                                                      _global_nodes.size());
+    for (auto& node : _global_nodes) {
+        _logger->debug("正在启动全局节点：{0}", node->id());
+        // 每个全局节点一个 strand，节点可以从 `this_coro::executor` 获得它
+        asio::co_spawn(asio::make_strand(executor), node->async_start(),
+                       [this, done, id = std::string(node->id())](std::exception_ptr ex) {
+                           if (ex) {
+                               // 一个全局节点启动失败不影响其他节点和流程，使用它的节点会在发送时报错
+                               try {
+                                   std::rethrow_exception(ex);
+                               } catch (std::exception& e) {
+                                   _logger->error("全局节点 '{0}' 启动失败：{1}", id, e.what());
+                               }
+                           }
+                           asio::post(done->get_executor(), [done] { done->try_send(); });
+                       });
+    }
+    co_await asio::co_spawn(
+        done->get_executor(),
+        [done, count = _global_nodes.size()]() -> Awaitable<void> {
+            for (size_t i = 0; i < count; i++) {
+                co_await done->async_receive(asio::use_awaitable);
+            }
+        },
+        asio::use_awaitable);
+}
+
 Awaitable<void> Engine::async_stop() {
     // 给出线程池停止信号
     _logger->info("开始请求流程引擎停止...");
+    if (!_stop_source) { // 从未启动过
+        co_return;
+    }
     _stop_source->request_stop();
 
+    if (_metrics_timer) {
+        asio::post(_metrics_timer->get_executor(), [timer = _metrics_timer.get()] { timer->cancel(); });
+    }
+
     for (auto it = _flows.rbegin(); it != _flows.rend(); ++it) {
         auto ref = std::reference_wrapper<IFlow>(**it); // 使用 std::reference_wrapper
         co_await ref.get().async_stop();
@@ -90,4 +160,18 @@ Awaitable<void> Engine::async_stop() {
     co_return;
 }
 
+Awaitable<void> Engine::async_dump_metrics(std::stop_token stop_token) {
+    auto const interval = std::chrono::milliseconds(std::max<size_t>(_settings.metrics_interval_ms, 100));
+    while (!stop_token.stop_requested()) {
+        _metrics_timer->expires_after(interval);
+        boost::system::error_code ec;
+        co_await _metrics_timer->async_wait(asio::redirect_error(asio::use_awaitable, ec));
+        try {
+            _metrics->dump(_settings.metrics_file);
+        } catch (std::exception& ex) {
+            _logger->warn("写入节点指标失败：{0}", ex.what());
+        }
+    }
+}
+
 }; // namespace edgelink
\ No newline at end of file
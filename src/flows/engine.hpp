@@ -17,38 +17,45 @@ class Engine : public IEngine, private std::enable_shared_from_this<Engine>, pri
 
     const EdgeLinkSettings& settings() const override { return _settings; }
 
+    MsgArenaPool* msg_arena_pool() const override { return _msg_arena_pool.get(); }
+
+    MetricsRegistry& metrics() const override { return *_metrics; }
+
     Awaitable<void> async_start() override;
     Awaitable<void> async_stop() override;
 
     inline IFlow* get_flow(const std::string_view flow_id) const override {
-        for (auto& flow : _flows) {
-            if (flow->id() == flow_id) {
-                return flow.get();
-            }
-        }
-        return nullptr;
+        auto it = _flow_index.find(flow_id);
+        return it != _flow_index.end() ? it->second : nullptr;
     }
 
     inline IStandaloneNode* get_global_node(const std::string_view node_id) const override {
-        for (auto& node : _global_nodes) {
-            if (node->id() == node_id) {
-                return node.get();
-            }
-        }
-        return nullptr;
+        auto it = _global_node_index.find(node_id);
+        return it != _global_node_index.end() ? it->second : nullptr;
     }
 
+  private:
+    /// @brief 在各自的 strand 上启动所有全局节点，等待它们全部启动完毕
+    Awaitable<void> async_start_global_nodes(const boost::asio::any_io_executor& executor);
+
+    /// @brief 按照设置的间隔把节点指标写入文件，停止的时候再写最后一次
+    Awaitable<void> async_dump_metrics(std::stop_token stop_token);
+
   private:
     std::shared_ptr<spdlog::logger> _logger;
     const EdgeLinkSettings& _settings;
     const IFlowFactory& _flow_factory;
     const std::string _flows_json_path;
     std::vector<std::unique_ptr<IStandaloneNode>> _global_nodes;
+    boost::unordered_flat_map<std::string_view, IStandaloneNode*> _global_node_index; ///< 键引用节点自己持有的 ID
 
     std::unique_ptr<std::stop_source> _stop_source;
     bool _disabled;
     std::vector<std::unique_ptr<IFlow>> _flows;
-
+    boost::unordered_flat_map<std::string_view, IFlow*> _flow_index;
+    std::shared_ptr<MsgArenaPool> _msg_arena_pool;
+    std::unique_ptr<MetricsRegistry> _metrics;
+    std::unique_ptr<boost::asio::steady_timer> _metrics_timer;
 };
 
 }; // namespace edgelink
\ No newline at end of file
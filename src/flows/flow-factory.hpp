@@ -14,14 +14,17 @@ class FlowFactory : public edgelink::IFlowFactory, private Noncopyable {
   public:
     FlowFactory(const IRegistry& registry);
 
-    std::vector<std::unique_ptr<IFlow>> create_flows(const JsonArray& flows_config, IEngine* engine) const override;
+    using IFlowFactory::create_flows;
+    using IFlowFactory::create_global_nodes;
 
-    std::vector<std::unique_ptr<edgelink::IStandaloneNode>> create_global_nodes(const JsonArray& flows_config,
+    std::vector<std::unique_ptr<IFlow>> create_flows(const FlowConfigIndex& index, IEngine* engine) const override;
+
+    std::vector<std::unique_ptr<edgelink::IStandaloneNode>> create_global_nodes(const FlowConfigIndex& index,
                                                                                 IEngine* engine) const override;
 
   private:
-    std::unique_ptr<edgelink::IFlow> create_flow(const JsonArray& flows_config,
-                                                 const JsonObject& flow_node, IEngine* engine) const;
+    std::unique_ptr<edgelink::IFlow> create_flow(const FlowConfigIndex& index, const JsonObject& flow_node,
+                                                 IEngine* engine) const;
 
   private:
     std::shared_ptr<spdlog::logger> _logger;
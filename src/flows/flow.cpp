@@ -13,23 +13,134 @@ namespace edgelink::flows {
 Flow::Flow(const JsonObject& json_config, IEngine* engine)
     : _logger(spdlog::default_logger()->clone("Flow")), _id(json_config.at("id").as_string()),
       _label(json_config.at("label").as_string()), _disabled(edgelink::value_or(json_config, "disabled", true)),
-      _engine(engine), _nodes() {
+      _sync_delivery(edgelink::value_or(json_config, "syncDelivery", false)), _engine(engine), _nodes(),
+      _msg_arena_histogram(std::make_shared<MsgArenaHistogram>()) {
     BOOST_ASSERT(engine != nullptr);
 }
 
 Flow::~Flow() {
-    //
+    // 指标由引擎持有，可能比流程活得更久，不能再让它读取已经销毁的邮箱；
+    // `set_mailbox()` 会等正在读取邮箱的 `snapshot()` 结束，邮箱在析构函数返回以后才销毁。
+    // 流程销毁以后它的节点也不再出现在指标里，重新加载时节点 ID 变了，旧的指标不会越积越多
+    auto& registry = _engine->metrics();
+    for (auto const& [_, metrics] : _node_metrics) {
+        metrics->set_mailbox(nullptr);
+        registry.remove(*metrics);
+    }
+}
+
+void Flow::emplace_node(std::unique_ptr<IFlowNode>&& node, const MailboxOptions& mailbox_options) {
+    _mailbox_options.emplace(node.get(), mailbox_options);
+    _node_index.insert_or_assign(node->id(), node.get());
+    _nodes.emplace_back(std::move(node));
+}
+
+void Flow::compile_routes() {
+    _mailboxes.clear();
+    _routing_table = RoutingTable::build(
+        _nodes,
+        [this](const IFlowNode* node) {
+            auto const& options = _mailbox_options.at(node);
+            auto& mailbox = _mailboxes[node];
+            mailbox = std::make_unique<Mailbox>(options);
+            return mailbox.get();
+        },
+        _sync_delivery);
+
+    _sync_delivering.clear();
+    for (auto const& node : _nodes) {
+        if (_routing_table.sync_source_of(node.get()) != nullptr) {
+            _sync_delivering.emplace(node.get(), false);
+        }
+    }
+
+    auto& registry = _engine->metrics();
+    for (auto const& node : _nodes) {
+        auto metrics = registry.get_or_create(node->id(), node->type(), _id);
+        metrics->set_mailbox(this->mailbox_of(node.get()));
+        _node_metrics.insert_or_assign(node.get(), std::move(metrics));
+    }
+}
+
+Mailbox* Flow::mailbox_of(const IFlowNode* node) const {
+    auto it = _mailboxes.find(node);
+    return it != _mailboxes.end() ? it->second.get() : nullptr;
+}
+
+void Flow::bind_executor(const boost::asio::any_io_executor& executor) {
+    _strand.emplace(boost::asio::make_strand(executor));
+    boost::unordered_flat_set<const IFlowNode*> bound;
+    for (auto const& node : _nodes) {
+        this->bind_node_executor(node.get(), executor, bound);
+    }
+}
+
+void Flow::bind_node_executor(IFlowNode* node, const boost::asio::any_io_executor& executor,
+                              boost::unordered_flat_set<const IFlowNode*>& bound) {
+    if (!bound.insert(node).second) {
+        return;
+    }
+    // 同步投递的目标节点使用上游的 strand，所以先绑定上游；同步链的长度有上限，递归不会太深
+    if (auto* source = _routing_table.sync_source_of(node)) {
+        this->bind_node_executor(source, executor, bound);
+        node->bind_executor(source->executor());
+    } else {
+        node->bind_executor(executor);
+    }
 }
 
 Awaitable<void> Flow::async_start() {
-    //
-    auto executor = co_await boost::asio::this_coro::executor;
+    BOOST_ASSERT(_strand);
     _stop_source = std::make_unique<std::stop_source>();
 
+    // 先启动会接收消息的节点，等它们启动完毕以后再开始投递，最后启动数据源：
+    // 这样任何节点收到第一条消息之前，它的 `async_start` 都已经执行完了
+    auto is_source = [](const IFlowNode& node) {
+        return node.descriptor() != nullptr && node.descriptor()->kind() == NodeKind::SOURCE;
+    };
+    for (auto const& node : _nodes) {
+        if (!is_source(*node)) {
+            co_await this->async_start_node(*node);
+        }
+    }
+
+    // 同步投递的目标节点只从同步连线接收消息，由发送方的协程投递，不需要投递协程
+    std::vector<std::pair<IFlowNode*, Mailbox*>> drains;
     for (auto const& node : _nodes) {
-        _logger->debug("正在启动流程节点：[id={0}, type={1}]", node->id(), node->type());
-        boost::asio::co_spawn(executor, node->async_start(), boost::asio::detached);
+        if (auto mailbox = this->mailbox_of(node.get()); mailbox && !_routing_table.sync_source_of(node.get())) {
+            for (size_t i = 0; i < std::max<size_t>(node->max_in_flight(), 1); i++) {
+                drains.emplace_back(node.get(), mailbox);
+            }
+        }
+    }
+    // 投递协程可能挂起在节点里（比如等待 broker 的应答），流程停止时要等它们全部退出，节点和邮箱才能销毁
+    _drain_count = drains.size();
+    _drains_done = std::make_shared<boost::asio::experimental::channel<void()>>(*_strand, drains.size());
+    for (auto const& [node, mailbox] : drains) {
+        // channel 不是线程安全的，退出的通知回到流程的 strand 上发送
+        boost::asio::co_spawn(node->executor(), this->async_drain(node, mailbox),
+                              [done = _drains_done](std::exception_ptr) {
+                                  boost::asio::post(done->get_executor(), [done] { done->try_send(); });
+                              });
+    }
+
+    for (auto const& node : _nodes) {
+        if (is_source(*node)) {
+            co_await this->async_start_node(*node);
+        }
+    }
+    co_return;
+}
+
+Awaitable<void> Flow::async_start_node(IFlowNode& node) {
+    _logger->debug("正在启动流程节点：[id={0}, type={1}]", node.id(), node.type());
+    // 节点在自己的 strand 上启动，节点的定时器等也随之绑定到该 strand
+    try {
+        co_await boost::asio::co_spawn(node.executor(), node.async_start(), boost::asio::use_awaitable);
         _logger->debug("流程节点已启动");
+    } catch (std::exception& ex) {
+        // 与之前一样，一个节点启动失败不影响同一流程里的其他节点
+        _logger->error("流程节点 '{0}' 启动失败：{1}", node.id(), ex.what());
     }
 }
 
@@ -38,6 +149,19 @@ Awaitable<void> Flow::async_stop() {
     _logger->debug("开始请求流程 '{0}' 停止...", this->id());
     _stop_source->request_stop();
 
+    // 先关闭邮箱，不再接收新消息，投递协程取完剩下的消息以后退出；等它们全部退出以后才停止节点
+    for (auto const& [_, mailbox] : _mailboxes) {
+        mailbox->close();
+    }
+    co_await boost::asio::co_spawn(
+        *_strand,
+        [this]() -> Awaitable<void> {
+            for (; _drain_count > 0; _drain_count--) {
+                co_await _drains_done->async_receive(boost::asio::use_awaitable);
+            }
+        },
+        boost::asio::use_awaitable);
+
     for (auto it = _nodes.rbegin(); it != _nodes.rend(); ++it) {
         auto ref = std::reference_wrapper<IFlowNode>(**it);
         _logger->info("正在停止流程节点：[id={0}, type={1}]", ref.get().id(), ref.get().type());
@@ -49,61 +173,206 @@ Awaitable<void> Flow::async_stop() {
     co_return;
 }
 
-Awaitable<void> Flow::async_send_many(std::vector<std::unique_ptr<Envelope>>&& envelopes) {
+Awaitable<void> Flow::async_send_many(IFlowNode* source, std::span<const MsgPtr> msgs) {
+    auto const ports = _routing_table.ports_of(source);
+    if (msgs.size() > ports.size()) {
+        throw std::out_of_range(fmt::format("节点 '{0}' 发送的消息超出端口数量", source->id()));
+    }
 
-    this->_on_send_event(this, envelopes);
+    // 绝大多数节点只连了少数几条线，信封直接放在协程帧里
+    EnvelopeVector envelopes;
+    RouteVector routes;
+    bool msg_sent = false;
+    for (size_t iport = 0; iport < msgs.size(); iport++) {
+        auto const& msg = msgs[iport];
+        if (!msg) {
+            continue;
+        }
+        for (auto const& route : _routing_table.destinations(ports[iport])) {
+            envelopes.emplace_back(msg, msg_sent, source, ports[iport].port, route.node);
+            routes.push_back(&route);
+            msg_sent = true;
+        }
+    }
+
+    co_await this->async_dispatch(source, envelopes, routes);
+}
 
-    for (auto&& e : envelopes) {
-        this->on_pre_route_event()(this, e.get());
+Awaitable<void> Flow::async_send_batch(IFlowNode* source, size_t port, MsgBatchPtr batch) {
+    auto const ports = _routing_table.ports_of(source);
+    if (port >= ports.size()) {
+        throw std::out_of_range(fmt::format("节点 '{0}' 发送的消息超出端口数量", source->id()));
+    }
+    if (!batch || batch->empty()) {
+        co_return;
+    }
 
-        if (e->clone_message) {
-            e->msg = std::move(e->msg->clone());
+    EnvelopeVector envelopes;
+    RouteVector routes;
+    bool batch_sent = false;
+    for (auto const& route : _routing_table.destinations(ports[port])) {
+        envelopes.emplace_back(batch, batch_sent, source, ports[port].port, route.node);
+        routes.push_back(&route);
+        batch_sent = true;
+    }
+
+    co_await this->async_dispatch(source, envelopes, routes);
+}
+
+Awaitable<void> Flow::async_dispatch(IFlowNode* source, EnvelopeVector& envelopes, RouteVector& routes) {
+    if (!envelopes.empty()) {
+        uint64_t samples = 0;
+        for (auto const& e : envelopes) {
+            samples += e.sample_count();
         }
+        this->metrics_of(source).add_out(samples);
     }
 
-    auto exec = co_await this_coro::executor;
+    this->_on_send_event(this, std::span<Envelope>(envelopes.data(), envelopes.size()));
+
+    for (auto& e : envelopes) {
+        this->on_pre_route_event()(this, &e);
 
-    for (auto&& e : envelopes) {
-        // co_await this->async_send_one(std::move(e));
-        boost::asio::co_spawn(exec, this->async_send_one_internal(std::move(e)), boost::asio::detached);
+        if (e.clone_message) {
+            if (e.batch) {
+                e.batch = std::make_shared<MsgBatch>(*e.batch);
+            } else {
+                e.msg = e.msg->clone();
+            }
+        }
+    }
+
+    // 同步连线的目标节点与发送方共用 strand，消息直接在发送方的协程里交给它；
+    // 其余的放入目标节点的邮箱，邮箱满的时候（`block` 策略）发送方在这里挂起，形成背压；
+    // 沿环的回边发送时不挂起，否则环上的节点会互相等待（见 `RoutingTable::build()`）
+    // 邮箱满了被丢弃的消息由邮箱自己计数，这里只记录发往已关闭邮箱的消息
+    for (size_t i = 0; i < envelopes.size(); i++) {
+        auto const destination = envelopes[i].destination_node;
+        auto* mailbox = routes[i]->mailbox;
+        if (routes[i]->sync) {
+            auto const destination_executor = destination->executor();
+            if (co_await this_coro::executor == destination_executor) {
+                co_await this->async_deliver_sync(std::move(envelopes[i]), *routes[i]);
+            } else {
+                // 发送方还不在自己的 strand 上（比如还在脚本工作者的 strand 上），先切换过去
+                co_await boost::asio::co_spawn(destination_executor,
+                                               this->async_deliver_sync(std::move(envelopes[i]), *routes[i]),
+                                               boost::asio::use_awaitable);
+            }
+            continue;
+        }
+        bool pushed = false;
+        if (routes[i]->back_edge) {
+            pushed = mailbox->try_push(std::move(envelopes[i]));
+            if (!pushed && !mailbox->is_closed()) {
+                this->log_back_edge_drop(source, destination);
+            }
+        } else {
+            pushed = co_await mailbox->async_push(std::move(envelopes[i]));
+        }
+        if (!pushed && mailbox->is_closed()) {
+            this->metrics_of(destination).add_dropped();
+        }
     }
-    co_return;
 }
 
-Awaitable<void> Flow::async_send_one_internal(std::unique_ptr<Envelope> envelope) {
+Awaitable<void> Flow::async_deliver_sync(Envelope envelope, const RoutingTable::Route& route) {
+    auto* mailbox = route.mailbox;
+    if (mailbox->is_closed()) {
+        this->metrics_of(route.node).add_dropped();
+        co_return;
+    }
 
-    // 线程池中处理流程
-    //
-    bool can_deliver = false;
-    switch (envelope->destination_node->descriptor()->kind()) {
+    auto& delivering = _sync_delivering.at(route.node);
+    std::optional<Envelope> next;
+    if (!delivering) {
+        next.emplace(std::move(envelope));
+    } else {
+        // 目标节点正在处理发送方的另一个协程送来的消息：排进邮箱，由正在投递的协程按顺序接着处理，
+        // 所以目标节点的消息既不会交错执行，也不会越过邮箱里更早的消息
+        if (!co_await mailbox->async_push(std::move(envelope))) {
+            if (mailbox->is_closed()) {
+                this->metrics_of(route.node).add_dropped();
+            }
+            co_return;
+        }
+        if (delivering) {
+            co_return;
+        }
+        // 在邮箱里等待空位的时候那次投递已经结束了，由这里接着取
+        next = mailbox->try_pop();
+    }
 
-    case NodeKind::PIPE:
-    case NodeKind::SINK:
-    case NodeKind::JUNCTION: {
-        can_deliver = true;
-    } break;
+    delivering = true;
+    while (next) {
+        co_await this->async_deliver_inline(std::move(*next));
+        next = mailbox->try_pop();
+    }
+    delivering = false;
+}
 
-    default:
-        auto error_msg = fmt::format("错误的节点类型 [msg_id={0}, source={1}, destination={2}]", envelope->msg->id(),
-                                     envelope->source_node->id(), envelope->destination_node->id());
-        _logger->error(error_msg);
-        throw InvalidDataException(error_msg);
+void Flow::log_back_edge_drop(const IFlowNode* source, const IFlowNode* destination) {
+    // 环上过载的时候每条消息都可能被丢弃，日志按 2 的幂次记录，不让它刷屏
+    auto const dropped = _back_edge_dropped.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (std::has_single_bit(dropped)) {
+        _logger->warn("节点 '{0}' 的邮箱已满，沿环的回边从节点 '{1}' 发来的消息被丢弃（流程中累计 {2} 条）",
+                      destination->id(), source->id(), dropped);
     }
+}
 
-    if (can_deliver) {
-        this->on_pre_deliver_event()(this, envelope.get());
-        co_await envelope->destination_node->receive_async(envelope->msg);
-        this->on_post_deliver_event()(this, envelope.get());
+Awaitable<void> Flow::async_drain(IFlowNode* node, Mailbox* mailbox) {
+    auto& metrics = this->metrics_of(node);
+    while (auto envelope = co_await mailbox->async_pop()) {
+        try {
+            co_await this->async_deliver(*envelope, metrics);
+        } catch (std::exception& ex) {
+            _logger->error("节点 '{0}' 处理消息时发生错误：{1}", node->id(), ex.what());
+        }
     }
 }
 
-IFlowNode* Flow::get_node(const std::string_view id) const {
-    for (auto&& n : _nodes) {
-        if (n->id() == id) {
-            return n.get();
+Awaitable<void> Flow::async_deliver_inline(Envelope envelope) {
+    try {
+        co_await this->async_deliver(envelope, this->metrics_of(envelope.destination_node));
+    } catch (std::exception& ex) {
+        // 与异步投递一样，目标节点的异常不传给发送方
+        _logger->error("节点 '{0}' 处理消息时发生错误：{1}", envelope.destination_node->id(), ex.what());
+    }
+}
+
+Awaitable<void> Flow::async_deliver(Envelope& envelope, NodeMetrics& metrics) {
+    // 目标节点的类型在编译路由表的时候已经检查过
+    this->on_pre_deliver_event()(this, &envelope);
+    metrics.add_in(envelope.sample_count());
+    auto const begin = std::chrono::steady_clock::now();
+    try {
+        if (envelope.batch) {
+            co_await envelope.destination_node->receive_batch_async(envelope.batch);
+        } else {
+            co_await envelope.destination_node->receive_async(envelope.msg);
         }
+    } catch (...) {
+        metrics.add_error();
+        throw;
+    }
+    metrics.record_latency(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count()));
+    this->on_post_deliver_event()(this, &envelope);
+}
+
+IFlowNode* Flow::get_node(const std::string_view id) const {
+    auto it = _node_index.find(id);
+    if (it == _node_index.end()) {
+        throw std::runtime_error(fmt::format("找不到节点 ID：{0}", id));
+    }
+    return it->second;
+}
+
+boost::json::storage_ptr Flow::create_msg_storage() {
+    if (auto pool = _engine->msg_arena_pool()) {
+        return pool->acquire(_msg_arena_histogram);
     }
-    throw std::runtime_error(fmt::format("找不到节点 ID：{0}", id));
+    return {};
 }
 
 }; // namespace edgelink::flows
\ No newline at end of file
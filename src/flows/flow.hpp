@@ -1,6 +1,9 @@
 #pragma once
 
+#include <boost/asio/experimental/channel.hpp>
+
 #include "edgelink/utils.hpp"
+#include "routing-table.hpp"
 
 namespace edgelink {
 class FlowNode;
@@ -26,28 +29,89 @@ class Flow : public IFlow, private Noncopyable {
     bool is_disabled() const override { return _disabled; }
     IEngine* engine() const override { return _engine; }
 
+    /// @brief 是否启用同步投递：沿同步连线发送的消息直接在发送方的协程里交给目标节点，见 `RoutingTable::Route::sync`
+    bool is_sync_delivery() const { return _sync_delivery; }
+
     Awaitable<void> async_start() override;
     Awaitable<void> async_stop() override;
 
-    Awaitable<void> async_send_many(std::vector<std::unique_ptr<Envelope>>&& envelopes) override;
+    Awaitable<void> async_send_many(IFlowNode* source, std::span<const MsgPtr> msgs) override;
+    Awaitable<void> async_send_batch(IFlowNode* source, size_t port, MsgBatchPtr batch) override;
 
     IFlowNode* get_node(const std::string_view id) const override;
 
-    inline void emplace_node(std::unique_ptr<IFlowNode>&& node) { _nodes.emplace_back(std::move(node)); }
+    void bind_executor(const boost::asio::any_io_executor& executor) override;
+    boost::asio::any_io_executor executor() const override { return *_strand; }
+
+    boost::json::storage_ptr create_msg_storage() override;
+
+    /// @brief 加入节点
+    /// @param mailbox_options 节点作为消息目标时的邮箱设置
+    void emplace_node(std::unique_ptr<IFlowNode>&& node, const MailboxOptions& mailbox_options = {});
+
+    /// @brief 所有节点都加入以后编译路由表，同时为每个有输入连线的节点创建邮箱
+    void compile_routes();
+
+    const RoutingTable& routing_table() const { return _routing_table; }
+
+    /// @brief 节点的邮箱，没有输入连线的节点没有邮箱
+    Mailbox* mailbox_of(const IFlowNode* node) const;
 
   private:
-    Awaitable<void> async_send_one_internal(std::unique_ptr<Envelope> envelope);
+    using EnvelopeVector = boost::container::small_vector<Envelope, 4>;
+    using RouteVector = boost::container::small_vector<const RoutingTable::Route*, 4>;
+
+    /// @brief 触发发送钩子、按需克隆，然后投递或放入目标节点的邮箱
+    Awaitable<void> async_dispatch(IFlowNode* source, EnvelopeVector& envelopes, RouteVector& routes);
+
+    /// @brief 记录沿回边发送时被丢弃的消息，`block` 策略下也是如此
+    void log_back_edge_drop(const IFlowNode* source, const IFlowNode* destination);
+
+    /// @brief 绑定节点的执行器，同步投递的目标节点与上游共用 strand
+    void bind_node_executor(IFlowNode* node, const boost::asio::any_io_executor& executor,
+                            boost::unordered_flat_set<const IFlowNode*>& bound);
+
+    /// @brief 沿同步连线投递，在目标节点的 strand 上调用；目标节点正忙的时候排进它的邮箱，由正在投递的协程取出
+    Awaitable<void> async_deliver_sync(Envelope envelope, const RoutingTable::Route& route);
+
+    /// @brief 从节点的邮箱中取出消息并投递，每个节点有 `max_in_flight()` 个这样的协程，流程停止时等待它们全部退出
+    Awaitable<void> async_drain(IFlowNode* node, Mailbox* mailbox);
+
+    /// @brief 在节点的执行器上启动节点并等待启动完毕，启动失败只记录日志
+    Awaitable<void> async_start_node(IFlowNode& node);
+    Awaitable<void> async_deliver_inline(Envelope envelope);
+    Awaitable<void> async_deliver(Envelope& envelope, NodeMetrics& metrics);
+
+    NodeMetrics& metrics_of(const IFlowNode* node) const { return *_node_metrics.at(node); }
 
   private:
     std::shared_ptr<spdlog::logger> _logger;
     const std::string _id;
     const std::string _label;
     const bool _disabled;
+    const bool _sync_delivery;
     IEngine* const _engine;
     std::vector<std::unique_ptr<IFlowNode>> _nodes;
+    boost::unordered_flat_map<std::string_view, IFlowNode*> _node_index; ///< 键引用节点自己持有的 ID
+    boost::unordered_flat_map<const IFlowNode*, MailboxOptions> _mailbox_options;
+    boost::unordered_flat_map<const IFlowNode*, std::unique_ptr<Mailbox>> _mailboxes;
+    RoutingTable _routing_table;
+    boost::unordered_flat_map<const IFlowNode*, std::shared_ptr<NodeMetrics>> _node_metrics;
+    std::optional<Strand> _strand;
 
     std::atomic<uint64_t> _msg_id_counter; // 初始化计数器为0
 
+    /// @brief 同步投递的目标节点是否正在处理消息，只在目标节点的 strand 上访问
+    boost::unordered_flat_map<const IFlowNode*, bool> _sync_delivering;
+
+    std::shared_ptr<MsgArenaHistogram> _msg_arena_histogram; ///< 本流程消息的内存用量统计
+
+    /// @brief 启动的投递协程数量，每个投递协程退出时向 `_drains_done` 发送一次
+    size_t _drain_count = 0;
+    std::shared_ptr<boost::asio::experimental::channel<void()>> _drains_done;
+
+    std::atomic<uint64_t> _back_edge_dropped = 0; ///< 沿回边发送时因为邮箱满了而丢弃的消息数
+
     std::unique_ptr<std::stop_source> _stop_source;
 
   private:
@@ -15,6 +15,11 @@ class JunctionNode : public FlowNode {
         // 直接分发消息
         co_await this->async_send_to_one_port(msg);
     }
+
+    Awaitable<void> receive_batch_async(MsgBatchPtr batch) override {
+        // 批量消息也原样转发，不展开
+        co_await this->async_send_batch(std::move(batch));
+    }
 };
 
 RTTR_REGISTRATION {
@@ -48,14 +48,14 @@ struct PropertyEntry {
     std::string p;
     std::optional<std::string> vt;
     std::optional<JsonValue> v;
+    propex::PropertyPath path; ///< 编译好的 `p`
 
     PropertyEntry(const std::string_view p, const std::string_view vt, const JsonValue& v)
-        : p(p), vt(vt), v(v) {
+        : p(p), vt(vt), v(v), path(p) {
         //
     }
 
-    explicit PropertyEntry(const JsonObject& obj) {
-        this->p = std::string(obj.at("p").as_string());
+    explicit PropertyEntry(const JsonObject& obj) : p(obj.at("p").as_string()), path(p) {
 
         if (auto jvt = obj.if_contains("vt")) {
             this->vt = std::string(jvt->as_string());
@@ -144,11 +144,11 @@ class InjectNode : public SourceNode {
 
   private:
     std::shared_ptr<Msg> create_msg() {
-        auto msg = std::make_shared<Msg>(this);
+        auto msg = std::make_shared<Msg>(this->flow()->create_msg_storage(), this);
 
         for (auto const& prop : _props) {
             auto parsed_value = propex::evaluate_property_value(prop.v.value(), prop.vt.value(), *this, *msg);
-            msg->data()[prop.p] = std::move(parsed_value);
+            msg->set_propex(prop.path, std::move(parsed_value));
         }
 
         return msg;
@@ -37,6 +37,12 @@ class DebugNode : public SinkNode {
         co_return;
     }
 
+    Awaitable<void> receive_batch_async(MsgBatchPtr batch) override {
+        // 整个批次输出一次，而不是每个样本一次
+        fmt::print("node {0}\n{1}\n", this->name(), boost::json::serialize(batch->to_json()));
+        co_return;
+    }
+
     /*
   private:
     const bool _active;
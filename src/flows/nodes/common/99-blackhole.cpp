@@ -14,7 +14,7 @@ class BlackholeNode : public SinkNode {
 
     Awaitable<void> receive_async(MsgPtr msg) override {
         //
-        MsgID msg_id = msg->data().at("id").to_number<MsgID>();
+        MsgID msg_id = msg->id();
         spdlog::info("BlackholeNode > 吃掉了消息：[msg.id={0}]", msg_id);
         co_return;
     }
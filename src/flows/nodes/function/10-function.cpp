@@ -3,6 +3,9 @@
 #include <quickjspp.hpp>
 
 #include "edgelink/edgelink.hpp"
+#include "quickjs-bridge.hpp"
+#include "quickjs-runtime-pool.hpp"
+#include "script-executor.hpp"
 
 using namespace edgelink;
 
@@ -102,18 +105,44 @@ constexpr char JS_USER_FUNC_TEMPLATE[] = R"(
     }};
 )";
 
+// 消息直接以 JS 对象传入，返回值也直接转换回 C++，不经过 JSON 文本
+constexpr char JS_USER_FUNC_NATIVE_TEMPLATE[] = R"(
+    function __el_user_func_native(context, msg) {{
+        const user_func = function() {{
+        /* 用户代码开始 */
+        {0};
+        /* 用户代码结束 */
+        }};
+        return user_func();
+    }};
+)";
+
 struct ModuleEntry {
     const std::string module;
     const std::string var;
 };
 
+/// @brief 前置脚本的源码，进程内只读取一次
+const std::string& prelude_source() {
+    static const std::string source = [] {
+        auto prelude_js_path = std::filesystem::current_path() / "resources" / "nodes" / "function" / "prelude.js";
+        std::ifstream file(prelude_js_path, std::ios::binary);
+        if (!file) {
+            throw IOException(fmt::format("找不到 function 节点的前置脚本：'{0}'", prelude_js_path.string()));
+        }
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }();
+    return source;
+}
+
 class FunctionNode : public FlowNode {
 
   public:
     FunctionNode(const std::string_view id, const JsonObject& config, const INodeDescriptor* desc, IFlow* flow)
         : FlowNode(id, desc, flow, config), _outputs(config.at("outputs").to_number<size_t>()),
           _func(config.at("func").as_string()), _initialize(config.at("initialize").as_string()),
-          _finalize(config.at("finalize").as_string()), _runtime(), _context(_runtime) {
+          _finalize(config.at("finalize").as_string()),
+          _bridge_mode(js::parse_bridge_mode(edgelink::value_or(config, "jsBridge", std::string_view("native")))) {
 
         for (auto const& module_json : config.at("libs").as_array()) {
             auto const& entry = module_json.as_object();
@@ -125,52 +154,34 @@ class FunctionNode : public FlowNode {
         }
 
         try {
-            auto& m = _context.addModule("EdgeLink");
-
-            m.class_<EvalContext>("EvalContext");
-
-            m.class_<EvalEnv>("EvalEnv")
-                .fun<&EvalEnv::generate_msg_id>("generateMsgID")
-                .property<&EvalEnv::get_node_id>("nodeID")
-                .property<&EvalEnv::get_node_name>("nodeName")
-                .property<&EvalEnv::get_output_count>("outputCount");
-
-            // 注册全局变量
-            _context.global()["evalEnv"] = EvalEnv::create(this);
-
-            // 加载前置代码
-
-            // 加载 EdgeLink 模块
-            _context.eval(R"xxx(
-            import * as edgeLink from 'EdgeLink';
-            globalThis.edgeLink = edgeLink;
-        )xxx",
-                          "<import>", JS_EVAL_TYPE_MODULE);
-
-            auto prelude_js_path = std::filesystem::current_path() / "resources" / "nodes" / "function" / "prelude.js";
-            _context.evalFile(prelude_js_path.c_str());
-
-            auto js_user_func = fmt::format(JS_USER_FUNC_TEMPLATE, _func);
-            _context.eval(js_user_func);
-
-            _user_func_cb =
-                static_cast<std::function<const std::string(std::shared_ptr<EvalContext>, const std::string&)>>(
-                    _context.eval("__el_user_func"));
+            auto exec_mode = js::parse_exec_mode(edgelink::value_or(config, "execMode", std::string_view("serialized")));
+            auto workers = edgelink::value_or<unsigned int>(config, "workers", std::thread::hardware_concurrency());
+            if (exec_mode == js::ExecMode::KEYED) {
+                _order_key.emplace(edgelink::value_or(config, "orderKey", std::string_view("topic")));
+            }
 
-        } catch (qjs::exception) {
-            auto exc = _context.getException();
-            this->logger()->error("QuickJS 错误：{0}", static_cast<const std::string>(exc));
-            throw InvalidDataException("function 内置的脚本解析异常");
+            auto& pool = js::RuntimePool::instance(flow->engine()->settings());
+            _executor = std::make_unique<js::ScriptExecutor>(
+                exec_mode, workers, pool, [this, &pool](js::ScriptWorker& worker) { this->setup_worker(worker, pool); });
+        } catch (std::exception& ex) {
+            this->logger()->error("加载 function 节点的脚本发生错误：{0}", ex.what());
+            throw;
         }
     }
 
+    /// @brief 每个工作者同时处理一条消息
+    size_t max_in_flight() const override { return _executor->worker_count(); }
+
     Awaitable<void> async_start() override {
-        _context.eval(_initialize);
+        // 工作者的 strand 直接建立在线程池上，这样节点的 strand 只负责按顺序分发消息
+        _executor->bind_executor(this->io_executor());
+        // 每个工作者都有自己的全局状态，初始化脚本在每个工作者上都执行一次
+        co_await _executor->async_run_all([this](js::ScriptWorker& worker) { worker.context().eval(_initialize); });
         co_return;
     }
 
     Awaitable<void> async_stop() override {
-        _context.eval(_finalize);
+        co_await _executor->async_run_all([this](js::ScriptWorker& worker) { worker.context().eval(_finalize); });
         co_return;
     }
 
@@ -180,13 +191,24 @@ class FunctionNode : public FlowNode {
 
         try {
 
-            auto const msg_json_text = msg->to_string();
-            const std::string result_json = _user_func_cb(eval_ctx, msg_json_text);
+            // 只在执行脚本的时候占用工作者，发送消息之前释放
+            auto eval_result =
+                co_await _executor->async_run(this->order_key_of(*msg), [&](js::ScriptWorker& worker) {
+                    return _bridge_mode == js::BridgeMode::JSON ? this->eval_json(worker, eval_ctx, *msg)
+                                                                : this->eval_native(worker, eval_ctx, *msg);
+                });
+            if (!eval_result) {
+                // 脚本出错，错误已经记录
+                // TODO 这里报告错误给 flow
+                co_return;
+            }
 
             // 后续处理执行成果
-            auto js_result = boost::json::parse(result_json);
+            auto& js_result = *eval_result;
 
-            if (js_result.kind() == JsonKind::array) { // 多个端口消息的情况
+            if (js_result.is_null()) { // 返回 null 或 undefined 表示不发送任何消息
+                co_return;
+            } else if (js_result.kind() == JsonKind::array) { // 多个端口消息的情况
                 auto array = js_result.as_array();
                 if (array.size() > this->output_ports().size()) {
                     auto error_msg = "JS 脚本输出错误的端口数";
@@ -198,24 +220,20 @@ class FunctionNode : public FlowNode {
                 for (auto& msg_json_value : array) {
                     // 直接分发消息，只有是对象的才分发
                     if (msg_json_value.kind() == JsonKind::object) {
-                        auto msg_json = msg_json_value.as_object();
-                        auto evaled_msg = std::make_shared<Msg>(msg_json, msg->birth_place());
+                        // arena 只能属于一个消息，多个消息各自复制到自己的存储里
+                        auto msg_json = JsonObject(msg_json_value.as_object(), this->flow()->create_msg_storage());
+                        auto evaled_msg = std::make_shared<Msg>(std::move(msg_json), msg->birth_place());
                         msgs.emplace_back(std::move(evaled_msg));
                     }
                 }
                 co_await this->async_send_to_many_port(std::forward<std::vector<std::shared_ptr<Msg>>>(msgs));
             } else if (js_result.kind() == JsonKind::object) { // 单个端口消息的情况
-                auto object_result = js_result.as_object();
+                auto object_result = std::move(js_result.as_object());
                 auto evaled_msg = std::make_shared<Msg>(std::move(object_result), msg->birth_place());
                 co_await this->async_send_to_one_port(std::move(evaled_msg));
             } else { // 其他类型不支持
-                this->logger()->error("不支持的消息格式：{0}", result_json);
+                this->logger()->error("不支持的消息格式：{0}", boost::json::serialize(js_result));
             }
-        } catch (qjs::exception) {
-            auto exc = _context.getException();
-            this->logger()->error("QuickJS 错误：{0}", static_cast<const std::string>(exc));
-            // TODO 这里报告错误给 flow
-            co_return;
         } catch (std::exception& ex) {
             this->logger()->error("错误：{0}", ex.what());
             throw;
@@ -223,17 +241,152 @@ class FunctionNode : public FlowNode {
         co_return;
     }
 
+    /// @brief `parallel` 模式下消息不需要保持顺序，不经过节点的 strand，由各个工作者自己串行化
+    bool is_concurrent() const override { return _executor->mode() == js::ExecMode::PARALLEL; }
+
+  private:
+    /// @brief 初始化一个工作者的上下文，调用者已经持有运行时的锁
+    void setup_worker(js::ScriptWorker& worker, js::RuntimePool& pool) {
+        auto& context = worker.context();
+        try {
+            auto& m = context.addModule("EdgeLink");
+
+            m.class_<EvalContext>("EvalContext");
+
+            m.class_<EvalEnv>("EvalEnv")
+                .fun<&EvalEnv::generate_msg_id>("generateMsgID")
+                .property<&EvalEnv::get_node_id>("nodeID")
+                .property<&EvalEnv::get_node_name>("nodeName")
+                .property<&EvalEnv::get_output_count>("outputCount");
+
+            // 注册全局变量
+            context.global()["evalEnv"] = EvalEnv::create(this);
+
+            // 加载前置代码
+
+            // 加载 EdgeLink 模块
+            context.eval(R"xxx(
+            import * as edgeLink from 'EdgeLink';
+            globalThis.edgeLink = edgeLink;
+        )xxx",
+                         "<import>", JS_EVAL_TYPE_MODULE);
+
+            // 前置脚本和用户函数都只编译一次，之后直接加载字节码
+            auto& bytecode_cache = pool.bytecode_cache();
+            auto ctx = worker.ctx();
+
+            js::eval_bytecode(ctx, *bytecode_cache.get_or_compile(ctx, prelude_source(), "prelude.js"));
+
+            const bool json_mode = _bridge_mode == js::BridgeMode::JSON;
+            auto js_user_func = fmt::format(json_mode ? JS_USER_FUNC_TEMPLATE : JS_USER_FUNC_NATIVE_TEMPLATE, _func);
+            js::eval_bytecode(ctx, *bytecode_cache.get_or_compile(ctx, js_user_func, "<function>"));
+
+            JSValue global = JS_GetGlobalObject(ctx);
+            worker.set_user_func(JS_GetPropertyStr(ctx, global, json_mode ? "__el_user_func" : "__el_user_func_native"));
+            JS_FreeValue(ctx, global);
+
+        } catch (qjs::exception) {
+            auto exc = context.getException();
+            this->logger()->error("QuickJS 错误：{0}", static_cast<const std::string>(exc));
+            throw InvalidDataException("function 内置的脚本解析异常");
+        }
+    }
+
+    /// @brief `keyed` 模式下消息的键的哈希，其他模式下为 0
+    uint64_t order_key_of(const Msg& msg) const {
+        if (!_order_key) {
+            return 0;
+        }
+        try {
+            auto const& key = msg.at_propex(*_order_key);
+            if (key.is_string()) {
+                return std::hash<std::string_view>{}(std::string_view(key.get_string()));
+            }
+            return std::hash<std::string>{}(boost::json::serialize(key));
+        } catch (std::exception&) {
+            // 没有键的消息都归到同一个工作者
+            return 0;
+        }
+    }
+
+    /// @brief 以 JSON 文本的方式调用用户函数，调用者需要持有运行时的锁
+    /// @return 脚本的返回值，脚本抛出异常时返回空
+    std::optional<JsonValue> eval_json(js::ScriptWorker& worker, std::shared_ptr<EvalContext> eval_ctx,
+                                       const Msg& msg) {
+        auto ctx = worker.ctx();
+        auto js_eval_ctx = worker.context().newValue(eval_ctx);
+        auto const msg_json_text = msg.to_string();
+
+        JSValue args[2] = {js_eval_ctx.v, JS_NewStringLen(ctx, msg_json_text.data(), msg_json_text.size())};
+        JSValue result = JS_Call(ctx, worker.user_func(), JS_UNDEFINED, 2, args);
+        JS_FreeValue(ctx, args[1]);
+
+        if (JS_IsException(result)) {
+            this->logger()->error("QuickJS 错误：{0}", js::take_exception_message(ctx));
+            return std::nullopt;
+        }
+        if (!JS_IsString(result)) { // JSON.stringify(undefined)
+            JS_FreeValue(ctx, result);
+            return JsonValue(nullptr);
+        }
+
+        size_t len = 0;
+        const char* result_json = JS_ToCStringLen(ctx, &len, result);
+        JS_FreeValue(ctx, result);
+        if (result_json == nullptr) {
+            this->logger()->error("QuickJS 错误：{0}", js::take_exception_message(ctx));
+            return std::nullopt;
+        }
+        std::optional<JsonValue> json_result;
+        try {
+            json_result.emplace(
+                boost::json::parse(std::string_view(result_json, len), this->flow()->create_msg_storage()));
+        } catch (...) {
+            JS_FreeCString(ctx, result_json);
+            throw;
+        }
+        JS_FreeCString(ctx, result_json);
+        return json_result;
+    }
+
+    /// @brief 通过消息桥直接调用用户函数，调用者需要持有运行时的锁
+    /// @return 脚本的返回值，脚本抛出异常时返回空
+    std::optional<JsonValue> eval_native(js::ScriptWorker& worker, std::shared_ptr<EvalContext> eval_ctx,
+                                         const Msg& msg) {
+        auto ctx = worker.ctx();
+        js::MsgBridge bridge(ctx, _bridge_mode);
+
+        auto js_eval_ctx = worker.context().newValue(eval_ctx);
+        JSValue args[2] = {js_eval_ctx.v, bridge.wrap(msg)};
+        JSValue result = JS_Call(ctx, worker.user_func(), JS_UNDEFINED, 2, args);
+        JS_FreeValue(ctx, args[1]);
+
+        if (JS_IsException(result)) {
+            this->logger()->error("QuickJS 错误：{0}", js::take_exception_message(ctx));
+            return std::nullopt;
+        }
+
+        std::optional<JsonValue> json_result;
+        try {
+            json_result.emplace(bridge.unwrap(result, this->flow()->create_msg_storage()));
+        } catch (...) {
+            JS_FreeValue(ctx, result);
+            throw;
+        }
+        JS_FreeValue(ctx, result);
+        return json_result;
+    }
+
   private:
     const size_t _outputs;
     const std::string _func;
     const std::string _initialize;
     const std::string _finalize;
     unsigned int _noerr;
+    const js::BridgeMode _bridge_mode;
     std::vector<ModuleEntry> _modules;
-    qjs::Runtime _runtime;
-    qjs::Context _context;
-
-    std::function<const std::string(std::shared_ptr<EvalContext>, const std::string&)> _user_func_cb;
+    std::optional<propex::PropertyPath> _order_key;   ///< `keyed` 模式下决定消息分配到哪个工作者
+    std::unique_ptr<js::ScriptExecutor> _executor;
 };
 
 RTTR_REGISTRATION {
@@ -1,4 +1,5 @@
 #include "edgelink/edgelink.hpp"
+#include "range-kernels.hpp"
 
 using namespace edgelink;
 
@@ -32,18 +33,91 @@ static double parse_json_number(const JsonObject& config, const std::string_view
     return boost::lexical_cast<double>(str_value.c_str());
 }
 
+/// @brief 二进制负载中的元素类型，由节点的 `bufferType` 配置指定，按本机字节序存放
+enum class BufferType { FLOAT64, FLOAT32, INT8, UINT8, INT16, UINT16, INT32, UINT32 };
+
+static BufferType parse_buffer_type(const JsonObject& config) {
+    const std::string_view text = edgelink::value_or(config, "bufferType", std::string_view("float64"));
+    static const std::array<std::pair<std::string_view, BufferType>, 8> TYPES{{
+        {"float64", BufferType::FLOAT64},
+        {"float32", BufferType::FLOAT32},
+        {"int8", BufferType::INT8},
+        {"uint8", BufferType::UINT8},
+        {"int16", BufferType::INT16},
+        {"uint16", BufferType::UINT16},
+        {"int32", BufferType::INT32},
+        {"uint32", BufferType::UINT32},
+    }};
+    for (auto const& [name, type] : TYPES) {
+        if (name == text) {
+            return type;
+        }
+    }
+    throw InvalidDataException(fmt::format("不支持的 bufferType 选项：'{0}'", text));
+}
+
+template <typename T> static void decode_buffer(const MsgBuffer& buffer, std::vector<double>& values) {
+    values.resize(buffer.size() / sizeof(T));
+    for (size_t i = 0; i < values.size(); i++) {
+        T elem;
+        std::memcpy(&elem, buffer.data() + i * sizeof(T), sizeof(T));
+        values[i] = static_cast<double>(elem);
+    }
+}
+
+template <typename T> static Bytes encode_buffer(std::span<const double> values) {
+    Bytes bytes(values.size() * sizeof(T));
+    for (size_t i = 0; i < values.size(); i++) {
+        T elem;
+        if constexpr (std::is_floating_point_v<T>) {
+            elem = static_cast<T>(values[i]);
+        } else {
+            // 整数类型饱和到取值范围，NaN 记为 0
+            auto n = std::isnan(values[i]) ? 0.0 : std::round(values[i]);
+            n = std::clamp(n, static_cast<double>(std::numeric_limits<T>::min()),
+                           static_cast<double>(std::numeric_limits<T>::max()));
+            elem = static_cast<T>(n);
+        }
+        std::memcpy(bytes.data() + i * sizeof(T), &elem, sizeof(T));
+    }
+    return bytes;
+}
+
+template <typename TFunc> static auto visit_buffer_type(BufferType type, TFunc&& func) {
+    switch (type) {
+    case BufferType::FLOAT32:
+        return func(float{});
+    case BufferType::INT8:
+        return func(int8_t{});
+    case BufferType::UINT8:
+        return func(uint8_t{});
+    case BufferType::INT16:
+        return func(int16_t{});
+    case BufferType::UINT16:
+        return func(uint16_t{});
+    case BufferType::INT32:
+        return func(int32_t{});
+    case BufferType::UINT32:
+        return func(uint32_t{});
+    default:
+        return func(double{});
+    }
+}
+
 class RangeNode : public FlowNode {
   public:
     RangeNode(const std::string_view id, const JsonObject& config, const INodeDescriptor* desc, IFlow* flow)
-        : FlowNode(id, desc, flow, config),             //
-          _minin(parse_json_number(config, "minin")),   //
-          _maxin(parse_json_number(config, "maxin")),   //
-          _minout(parse_json_number(config, "minout")), //
-          _maxout(parse_json_number(config, "maxout")), //
-          _action(config.at("action").as_string()),     //
-          _round(config.at("round").as_bool()),         //
-          _property(config.at("property").as_string())  //
-    {
+        : FlowNode(id, desc, flow, config),
+          _params{
+              .minin = parse_json_number(config, "minin"),
+              .maxin = parse_json_number(config, "maxin"),
+              .minout = parse_json_number(config, "minout"),
+              .maxout = parse_json_number(config, "maxout"),
+              .action = kernels::parse_range_action(config.at("action").as_string()),
+              .round = config.at("round").as_bool(),
+          },
+          _property(config.at("property").as_string()), _is_payload(config.at("property").as_string() == "payload"),
+          _buffer_type(parse_buffer_type(config)) {
         //
     }
 
@@ -52,43 +126,80 @@ class RangeNode : public FlowNode {
     Awaitable<void> async_stop() override { co_return; }
 
     Awaitable<void> receive_async(MsgPtr msg) override {
-        if (std::isnan(_minin) || std::isnan(_maxin) || std::isnan(_minout) || std::isnan(_maxout)) {
+        if (!this->is_configured()) {
             co_return;
         }
 
-        auto value = msg->at_propex(_property);
-        if (value.is_number()) {
-            double n = value.to_number<double>();
-            if (_action == "clamp") {
-                if (n < _minin) {
-                    n = _minin;
-                }
-                if (n > _maxin) {
-                    n = _maxin;
-                }
-            }
-            if (_action == "roll") {
-                auto divisor = _maxin - _minin;
-                n = std::fmod(std::fmod(n - _minin, divisor + divisor), divisor) + _minin;
+        // 二进制负载按 `bufferType` 解释为数值数组
+        if (_is_payload) {
+            if (auto buffer = std::as_const(*msg).payload_buffer()) {
+                msg->set_payload(this->map_buffer(*buffer));
+                co_await this->async_send_to_one_port(msg);
+                co_return;
             }
-            n = ((n - _minin) / (_maxin - _minin) * (_maxout - _minout)) + _minout;
-            if (_round) {
-                n = static_cast<int64_t>(std::round(n));
-            }
-            msg->at_propex(_property) = n;
+        }
+
+        auto const& value = std::as_const(*msg).at_propex(_property);
+        if (value.is_number()) {
+            msg->at_propex(_property) = kernels::range_map_one(value.to_number<double>(), _params);
+            co_await this->async_send_to_one_port(msg);
+        } else if (value.is_array()) {
+            this->map_array(msg->at_propex(_property).as_array());
             co_await this->async_send_to_one_port(msg);
         }
         co_return;
     }
 
+    Awaitable<void> receive_batch_async(MsgBatchPtr batch) override {
+        // 只有处理负载的时候才能直接按列计算，其他属性在批量消息里不存在，只能逐条展开
+        if (!_is_payload) {
+            co_await FlowNode::receive_batch_async(std::move(batch));
+            co_return;
+        }
+        if (!this->is_configured()) {
+            co_return;
+        }
+
+        kernels::range_map(batch->payloads(), _params);
+        co_await this->async_send_batch(std::move(batch));
+    }
+
+  private:
+    bool is_configured() const {
+        return !(std::isnan(_params.minin) || std::isnan(_params.maxin) || std::isnan(_params.minout) ||
+                 std::isnan(_params.maxout));
+    }
+
+    /// @brief 数组中的数值元素批量映射，其他元素保持不变
+    void map_array(JsonArray& array) const {
+        std::vector<double> values;
+        values.reserve(array.size());
+        for (auto const& elem : array) {
+            values.push_back(elem.is_number() ? elem.to_number<double>() : 0.0);
+        }
+        kernels::range_map(values, _params);
+        for (size_t i = 0; i < array.size(); i++) {
+            if (array[i].is_number()) {
+                array[i] = values[i];
+            }
+        }
+    }
+
+    MsgBuffer map_buffer(const MsgBuffer& buffer) const {
+        return visit_buffer_type(_buffer_type, [&buffer, this](auto elem) {
+            using T = decltype(elem);
+            std::vector<double> values;
+            decode_buffer<T>(buffer, values);
+            kernels::range_map(values, _params);
+            return MsgBuffer(encode_buffer<T>(values));
+        });
+    }
+
   private:
-    double _minin;
-    double _maxin;
-    double _minout;
-    double _maxout;
-    const std::string _action;
-    bool _round;
-    const std::string _property;
+    const kernels::RangeParams _params;
+    const propex::PropertyPath _property;
+    const bool _is_payload;
+    const BufferType _buffer_type;
 };
 
 RTTR_REGISTRATION {
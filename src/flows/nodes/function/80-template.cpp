@@ -23,7 +23,7 @@ class TemplateNode : public FlowNode {
     Awaitable<void> receive_async(MsgPtr msg) override {
 
         JsonValue wrapped_msg = JsonObject({
-            {_field, JsonValue(msg->data().at(_field))},
+            {_field, JsonValue(std::as_const(*msg).at(_field))},
         });
         std::stringstream out;
         boost::mustache::render(_template, out, wrapped_msg, {});
@@ -31,7 +31,7 @@ class TemplateNode : public FlowNode {
         auto json_text = out.str();
         auto parsed_msg_field_value = boost::json::parse(json_text);
 
-        msg->data()[_field] = parsed_msg_field_value;
+        msg->insert_or_assign(_field, std::move(parsed_msg_field_value));
 
         co_await this->async_send_to_one_port(msg);
 
@@ -0,0 +1,494 @@
+#include "edgelink/edgelink.hpp"
+#include "quickjs-bridge.hpp"
+
+namespace edgelink::js {
+
+namespace {
+
+/// @brief 转换时允许的最大嵌套层数，超过了多半是循环引用
+constexpr int MAX_DEPTH = 256;
+
+/// @brief 离开作用域时释放 JS 值
+struct ScopedValue {
+    JSContext* ctx;
+    JSValue value;
+
+    ~ScopedValue() { JS_FreeValue(ctx, value); }
+};
+
+/// @brief 离开作用域时释放 `JS_GetOwnPropertyNames` 返回的属性表
+struct ScopedPropertyEnum {
+    JSContext* ctx;
+    JSPropertyEnum* tab;
+    uint32_t len;
+
+    ~ScopedPropertyEnum() {
+        for (uint32_t i = 0; i < len; i++) {
+            JS_FreeAtom(ctx, tab[i].atom);
+        }
+        js_free(ctx, tab);
+    }
+};
+
+[[noreturn]] void throw_pending_exception(JSContext* ctx) {
+    throw InvalidDataException(fmt::format("QuickJS 错误：{0}", take_exception_message(ctx)));
+}
+
+JSClassID handle_class_id() {
+    static JSClassID class_id = [] {
+        JSClassID id = 0;
+        JS_NewClassID(&id);
+        return id;
+    }();
+    return class_id;
+}
+
+void define_value(JSContext* ctx, JSValueConst obj, const std::string_view key, JSValue value) {
+    if (JS_IsException(value)) {
+        throw_pending_exception(ctx);
+    }
+    JSAtom atom = JS_NewAtomLen(ctx, key.data(), key.size());
+    int r = JS_DefinePropertyValue(ctx, obj, atom, value, JS_PROP_C_W_E);
+    JS_FreeAtom(ctx, atom);
+    if (r < 0) {
+        throw_pending_exception(ctx);
+    }
+}
+
+/// @brief `JSON.stringify` 会跳过的值
+inline bool is_skipped(JSContext* ctx, JSValueConst value) {
+    return JS_IsUndefined(value) || JS_IsSymbol(value) || JS_IsFunction(ctx, value);
+}
+
+inline JsonValue number_to_json(double d, const boost::json::storage_ptr& sp) {
+    if (!std::isfinite(d)) {
+        return JsonValue(nullptr, sp);
+    }
+    // 和 JSON 文本往返一样，整数值的浮点数还原为整数
+    if (d == std::trunc(d) && std::fabs(d) < 9007199254740992.0) {
+        return JsonValue(static_cast<int64_t>(d), sp);
+    }
+    return JsonValue(d, sp);
+}
+
+/// @param lookup 形如 `const JsonValue*(const void* getter)` 的函数，用来识别未被访问过的惰性属性
+template <typename TLookup>
+JsonValue convert(JSContext* ctx, JSValueConst value, const boost::json::storage_ptr& sp, int depth,
+                  const TLookup& lookup) {
+    switch (JS_VALUE_GET_NORM_TAG(value)) {
+
+    case JS_TAG_INT:
+        return JsonValue(static_cast<int64_t>(JS_VALUE_GET_INT(value)), sp);
+
+    case JS_TAG_BOOL:
+        return JsonValue(JS_VALUE_GET_BOOL(value) != 0, sp);
+
+    case JS_TAG_FLOAT64:
+        return number_to_json(JS_VALUE_GET_FLOAT64(value), sp);
+
+    case JS_TAG_STRING: {
+        size_t len = 0;
+        const char* str = JS_ToCStringLen(ctx, &len, value);
+        if (str == nullptr) {
+            throw_pending_exception(ctx);
+        }
+        JsonValue result(boost::json::string_view(str, len), sp);
+        JS_FreeCString(ctx, str);
+        return result;
+    }
+
+    case JS_TAG_OBJECT:
+        break;
+
+    default: // null、undefined、symbol、bigint 等
+        return JsonValue(nullptr, sp);
+    }
+
+    if (depth > MAX_DEPTH) {
+        throw InvalidDataException("脚本返回的对象嵌套太深，可能存在循环引用");
+    }
+
+    // 和 JSON.stringify 一样优先使用 toJSON()，比如 Date
+    {
+        ScopedValue to_json{ctx, JS_GetPropertyStr(ctx, value, "toJSON")};
+        if (JS_IsException(to_json.value)) {
+            throw_pending_exception(ctx);
+        }
+        if (JS_IsFunction(ctx, to_json.value)) {
+            ScopedValue replaced{ctx, JS_Call(ctx, to_json.value, value, 0, nullptr)};
+            if (JS_IsException(replaced.value)) {
+                throw_pending_exception(ctx);
+            }
+            return convert(ctx, replaced.value, sp, depth + 1, lookup);
+        }
+    }
+
+    int is_array = JS_IsArray(ctx, value);
+    if (is_array < 0) {
+        throw_pending_exception(ctx);
+    }
+
+    if (is_array) {
+        int64_t len = 0;
+        {
+            ScopedValue len_value{ctx, JS_GetPropertyStr(ctx, value, "length")};
+            if (JS_ToInt64(ctx, &len, len_value.value) < 0) {
+                throw_pending_exception(ctx);
+            }
+        }
+        JsonArray array(sp);
+        array.reserve(static_cast<size_t>(len));
+        for (int64_t i = 0; i < len; i++) {
+            ScopedValue elem{ctx, JS_GetPropertyUint32(ctx, value, static_cast<uint32_t>(i))};
+            if (JS_IsException(elem.value)) {
+                throw_pending_exception(ctx);
+            }
+            if (is_skipped(ctx, elem.value)) {
+                array.emplace_back(nullptr);
+            } else {
+                array.push_back(convert(ctx, elem.value, sp, depth + 1, lookup));
+            }
+        }
+        return JsonValue(std::move(array));
+    }
+
+    ScopedPropertyEnum props{ctx, nullptr, 0};
+    if (JS_GetOwnPropertyNames(ctx, &props.tab, &props.len, value, JS_GPN_STRING_MASK | JS_GPN_ENUM_ONLY) < 0) {
+        throw_pending_exception(ctx);
+    }
+
+    JsonObject obj(sp);
+    obj.reserve(props.len);
+    for (uint32_t i = 0; i < props.len; i++) {
+        const JSAtom atom = props.tab[i].atom;
+
+        JSPropertyDescriptor desc;
+        int found = JS_GetOwnProperty(ctx, &desc, value, atom);
+        if (found < 0) {
+            throw_pending_exception(ctx);
+        } else if (found == 0) {
+            continue;
+        }
+
+        const char* key_cstr = JS_AtomToCString(ctx, atom);
+        if (key_cstr == nullptr) {
+            JS_FreeValue(ctx, desc.value);
+            JS_FreeValue(ctx, desc.getter);
+            JS_FreeValue(ctx, desc.setter);
+            throw_pending_exception(ctx);
+        }
+        std::string key(key_cstr);
+        JS_FreeCString(ctx, key_cstr);
+
+        JSValue prop_value;
+        if (desc.flags & JS_PROP_GETSET) {
+            const JsonValue* source = JS_IsObject(desc.getter) ? lookup(JS_VALUE_GET_PTR(desc.getter)) : nullptr;
+            JS_FreeValue(ctx, desc.getter);
+            JS_FreeValue(ctx, desc.setter);
+            JS_FreeValue(ctx, desc.value);
+            if (source != nullptr) {
+                // 脚本没有碰过的惰性属性，直接复制原来的值
+                obj.emplace(key, JsonValue(*source, sp));
+                continue;
+            }
+            prop_value = JS_GetProperty(ctx, value, atom);
+        } else {
+            JS_FreeValue(ctx, desc.getter);
+            JS_FreeValue(ctx, desc.setter);
+            prop_value = desc.value;
+        }
+
+        ScopedValue prop{ctx, prop_value};
+        if (JS_IsException(prop.value)) {
+            throw_pending_exception(ctx);
+        }
+        if (!is_skipped(ctx, prop.value)) {
+            obj.emplace(key, convert(ctx, prop.value, sp, depth + 1, lookup));
+        }
+    }
+    return JsonValue(std::move(obj));
+}
+
+}; // namespace
+
+BridgeMode parse_bridge_mode(const std::string_view text) {
+    if (text == "json") {
+        return BridgeMode::JSON;
+    } else if (text == "native") {
+        return BridgeMode::NATIVE;
+    } else if (text == "lazy") {
+        return BridgeMode::LAZY;
+    } else {
+        throw InvalidDataException(fmt::format("不支持的 jsBridge 选项：'{0}'", text));
+    }
+}
+
+std::string take_exception_message(JSContext* ctx) {
+    ScopedValue exc{ctx, JS_GetException(ctx)};
+    std::string message;
+    if (const char* str = JS_ToCString(ctx, exc.value)) {
+        message = str;
+        JS_FreeCString(ctx, str);
+    } else {
+        message = "未知错误";
+    }
+
+    if (JS_IsError(ctx, exc.value)) {
+        ScopedValue stack{ctx, JS_GetPropertyStr(ctx, exc.value, "stack")};
+        if (JS_IsString(stack.value)) {
+            if (const char* str = JS_ToCString(ctx, stack.value)) {
+                message.push_back('\n');
+                message.append(str);
+                JS_FreeCString(ctx, str);
+            }
+        }
+    }
+    return message;
+}
+
+JSValue to_js(JSContext* ctx, const JsonValue& value) {
+    switch (value.kind()) {
+
+    case JsonKind::null:
+        return JS_NULL;
+
+    case JsonKind::bool_:
+        return JS_NewBool(ctx, value.get_bool());
+
+    case JsonKind::int64:
+        return JS_NewInt64(ctx, value.get_int64());
+
+    case JsonKind::uint64:
+        return JS_NewFloat64(ctx, static_cast<double>(value.get_uint64()));
+
+    case JsonKind::double_:
+        return JS_NewFloat64(ctx, value.get_double());
+
+    case JsonKind::string: {
+        auto const& str = value.get_string();
+        return JS_NewStringLen(ctx, str.data(), str.size());
+    }
+
+    case JsonKind::array: {
+        JSValue array = JS_NewArray(ctx);
+        if (JS_IsException(array)) {
+            return array;
+        }
+        uint32_t index = 0;
+        for (auto const& elem : value.get_array()) {
+            JSValue v = to_js(ctx, elem);
+            if (JS_IsException(v) || JS_DefinePropertyValueUint32(ctx, array, index++, v, JS_PROP_C_W_E) < 0) {
+                JS_FreeValue(ctx, array);
+                return JS_EXCEPTION;
+            }
+        }
+        return array;
+    }
+
+    case JsonKind::object: {
+        JSValue obj = JS_NewObject(ctx);
+        if (JS_IsException(obj)) {
+            return obj;
+        }
+        for (auto const& kv : value.get_object()) {
+            JSValue v = to_js(ctx, kv.value());
+            if (JS_IsException(v)) {
+                JS_FreeValue(ctx, obj);
+                return v;
+            }
+            JSAtom atom = JS_NewAtomLen(ctx, kv.key().data(), kv.key().size());
+            int r = JS_DefinePropertyValue(ctx, obj, atom, v, JS_PROP_C_W_E);
+            JS_FreeAtom(ctx, atom);
+            if (r < 0) {
+                JS_FreeValue(ctx, obj);
+                return JS_EXCEPTION;
+            }
+        }
+        return obj;
+    }
+
+    default:
+        return JS_NULL;
+    }
+}
+
+JsonValue from_js(JSContext* ctx, JSValueConst value, const boost::json::storage_ptr& sp) {
+    auto no_lazy = [](const void*) -> const JsonValue* { return nullptr; };
+    return convert(ctx, value, sp, 0, no_lazy);
+}
+
+MsgBridge::MsgBridge(JSContext* ctx, BridgeMode mode) : _ctx(ctx), _mode(mode), _handle(JS_UNDEFINED) {
+    if (_mode == BridgeMode::LAZY) {
+        auto rt = JS_GetRuntime(ctx);
+        auto class_id = handle_class_id();
+        if (!JS_IsRegisteredClass(rt, class_id)) {
+            JSClassDef def{};
+            def.class_name = "EdgeLinkMsgBridge";
+            JS_NewClass(rt, class_id, &def);
+        }
+        _handle = JS_NewObjectClass(ctx, static_cast<int>(class_id));
+        if (JS_IsException(_handle)) {
+            throw_pending_exception(ctx);
+        }
+        JS_SetOpaque(_handle, this);
+    }
+}
+
+MsgBridge::~MsgBridge() {
+    for (auto getter : _getter_refs) {
+        JS_FreeValue(_ctx, getter);
+    }
+    if (JS_IsObject(_handle)) {
+        // 脚本可能把惰性对象保存下来了，让它们的 getter 失效
+        JS_SetOpaque(_handle, nullptr);
+        JS_FreeValue(_ctx, _handle);
+    }
+}
+
+JSValue MsgBridge::wrap(const Msg& msg) {
+    JSValue obj = JS_NewObject(_ctx);
+    if (JS_IsException(obj)) {
+        throw_pending_exception(_ctx);
+    }
+    try {
+        msg.for_each([this, obj](std::string_view key, const JsonValue& value) {
+            if (_mode == BridgeMode::LAZY) {
+                this->define_lazy_property(obj, key, value);
+            } else {
+                define_value(_ctx, obj, key, to_js(_ctx, value));
+            }
+        });
+    } catch (...) {
+        JS_FreeValue(_ctx, obj);
+        throw;
+    }
+    return obj;
+}
+
+JsonValue MsgBridge::unwrap(JSValueConst value, const boost::json::storage_ptr& sp) {
+    auto lookup = [this](const void* getter) -> const JsonValue* {
+        auto it = _getters.find(getter);
+        return it != _getters.end() ? _sources[it->second] : nullptr;
+    };
+    return convert(_ctx, value, sp, 0, lookup);
+}
+
+JSValue MsgBridge::to_js_lazy(const JsonValue& value) {
+    switch (value.kind()) {
+    case JsonKind::object:
+        return this->make_lazy_object(value.get_object());
+
+    case JsonKind::array: {
+        JSValue array = JS_NewArray(_ctx);
+        if (JS_IsException(array)) {
+            return array;
+        }
+        uint32_t index = 0;
+        for (auto const& elem : value.get_array()) {
+            JSValue v = this->to_js_lazy(elem);
+            if (JS_IsException(v) || JS_DefinePropertyValueUint32(_ctx, array, index++, v, JS_PROP_C_W_E) < 0) {
+                JS_FreeValue(_ctx, array);
+                return JS_EXCEPTION;
+            }
+        }
+        return array;
+    }
+
+    default:
+        return to_js(_ctx, value);
+    }
+}
+
+JSValue MsgBridge::make_lazy_object(const JsonObject& obj) {
+    JSValue js_obj = JS_NewObject(_ctx);
+    if (JS_IsException(js_obj)) {
+        return js_obj;
+    }
+    try {
+        for (auto const& kv : obj) {
+            this->define_lazy_property(js_obj, kv.key(), kv.value());
+        }
+    } catch (...) {
+        JS_FreeValue(_ctx, js_obj);
+        throw;
+    }
+    return js_obj;
+}
+
+void MsgBridge::define_lazy_property(JSValueConst obj, const std::string_view key, const JsonValue& value) {
+    if (!value.is_structured()) {
+        // 标量直接转换，比创建 getter 便宜
+        define_value(_ctx, obj, key, to_js(_ctx, value));
+        return;
+    }
+
+    const size_t index = _sources.size();
+    _sources.push_back(&value);
+
+    JSValue data[3] = {
+        _handle,
+        JS_NewInt32(_ctx, static_cast<int32_t>(index)),
+        JS_NewStringLen(_ctx, key.data(), key.size()),
+    };
+    JSValue getter = JS_NewCFunctionData(_ctx, &MsgBridge::lazy_getter, 0, 0, 3, data);
+    JSValue setter = JS_NewCFunctionData(_ctx, &MsgBridge::lazy_setter, 1, 0, 3, data);
+    JS_FreeValue(_ctx, data[2]);
+    if (JS_IsException(getter) || JS_IsException(setter)) {
+        JS_FreeValue(_ctx, getter);
+        JS_FreeValue(_ctx, setter);
+        throw_pending_exception(_ctx);
+    }
+
+    _getter_refs.push_back(JS_DupValue(_ctx, getter));
+    _getters.emplace(JS_VALUE_GET_PTR(getter), index);
+
+    JSAtom atom = JS_NewAtomLen(_ctx, key.data(), key.size());
+    int r = JS_DefinePropertyGetSet(_ctx, obj, atom, getter, setter, JS_PROP_CONFIGURABLE | JS_PROP_ENUMERABLE);
+    JS_FreeAtom(_ctx, atom);
+    if (r < 0) {
+        throw_pending_exception(_ctx);
+    }
+}
+
+JSValue MsgBridge::lazy_getter(JSContext* ctx, JSValueConst this_val, int, JSValueConst*, int, JSValue* func_data) {
+    auto self = static_cast<MsgBridge*>(JS_GetOpaque(func_data[0], handle_class_id()));
+    if (self == nullptr) {
+        return JS_ThrowTypeError(ctx, "message object is no longer valid outside of the function call");
+    }
+
+    JSValue value;
+    try {
+        value = self->to_js_lazy(*self->_sources.at(static_cast<size_t>(JS_VALUE_GET_INT(func_data[1]))));
+    } catch (const std::exception& ex) {
+        return JS_ThrowInternalError(ctx, "%s", ex.what());
+    }
+    if (JS_IsException(value)) {
+        return value;
+    }
+
+    if (JS_IsObject(this_val)) {
+        // 替换成普通的数据属性，以后的访问不再经过 getter
+        JSAtom atom = JS_ValueToAtom(ctx, func_data[2]);
+        int r = JS_DefinePropertyValue(ctx, this_val, atom, JS_DupValue(ctx, value), JS_PROP_C_W_E);
+        JS_FreeAtom(ctx, atom);
+        if (r < 0) {
+            JS_FreeValue(ctx, value);
+            return JS_EXCEPTION;
+        }
+    }
+    return value;
+}
+
+JSValue MsgBridge::lazy_setter(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv, int,
+                               JSValue* func_data) {
+    if (!JS_IsObject(this_val)) {
+        return JS_UNDEFINED;
+    }
+    JSValue new_value = argc > 0 ? JS_DupValue(ctx, argv[0]) : JS_UNDEFINED;
+    JSAtom atom = JS_ValueToAtom(ctx, func_data[2]);
+    int r = JS_DefinePropertyValue(ctx, this_val, atom, new_value, JS_PROP_C_W_E);
+    JS_FreeAtom(ctx, atom);
+    return r < 0 ? JS_EXCEPTION : JS_UNDEFINED;
+}
+
+}; // namespace edgelink::js
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <quickjs/quickjs.h>
+
+namespace edgelink::js {
+
+/// @brief 消息在 C++ 和脚本之间传递的方式
+enum class BridgeMode {
+    JSON,   ///< 序列化为 JSON 文本，在脚本里解析（旧的方式）
+    NATIVE, ///< 直接构造 JS 对象
+    LAZY,   ///< 构造惰性对象，对象和数组属性在脚本第一次访问时才转换
+};
+
+/// @brief 解析节点配置中的 `jsBridge` 值：`json`、`native` 或 `lazy`
+BridgeMode parse_bridge_mode(const std::string_view text);
+
+/// @brief 取出 QuickJS 上下文中挂起的异常，并转换为字符串
+std::string take_exception_message(JSContext* ctx);
+
+/// @brief 把 JSON 值深复制为 JS 值，返回的值由调用者释放
+JSValue to_js(JSContext* ctx, const JsonValue& value);
+
+/// @brief 把 JS 值转换为 JSON 值，规则与 `JSON.stringify` 相同
+JsonValue from_js(JSContext* ctx, JSValueConst value, const boost::json::storage_ptr& sp = {});
+
+/// @brief 一次脚本调用中的消息桥
+///
+/// 惰性模式下，脚本没有碰过的属性在转换回 C++ 的时候直接复制原来的 JSON 值，不经过 JS。
+/// 惰性对象引用着原消息，所以消息桥的生存期内原消息必须保持不变；桥销毁后，
+/// 被脚本保存下来的惰性属性再被访问会抛出 JS 异常。
+class MsgBridge final : private Noncopyable {
+  public:
+    MsgBridge(JSContext* ctx, BridgeMode mode);
+    ~MsgBridge();
+
+    /// @brief 把消息转换为 JS 对象，返回的值由调用者释放
+    JSValue wrap(const Msg& msg);
+
+    /// @brief 把脚本返回的值转换回 JSON
+    JsonValue unwrap(JSValueConst value, const boost::json::storage_ptr& sp);
+
+  private:
+    JSValue to_js_lazy(const JsonValue& value);
+    JSValue make_lazy_object(const JsonObject& obj);
+    void define_lazy_property(JSValueConst obj, const std::string_view key, const JsonValue& value);
+
+    static JSValue lazy_getter(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv, int magic,
+                               JSValue* func_data);
+    static JSValue lazy_setter(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst* argv, int magic,
+                               JSValue* func_data);
+
+  private:
+    JSContext* _ctx;
+    const BridgeMode _mode;
+    JSValue _handle; ///< 持有指向本对象的不透明指针，供惰性 getter 使用
+    std::vector<const JsonValue*> _sources;
+    std::vector<JSValue> _getter_refs;                ///< 保持 getter 存活，保证地址在桥的生存期内不会被复用
+    std::unordered_map<const void*, size_t> _getters; ///< 惰性 getter 函数对象 -> `_sources` 下标
+};
+
+}; // namespace edgelink::js
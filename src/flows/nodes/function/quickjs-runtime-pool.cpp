@@ -0,0 +1,231 @@
+#include "edgelink/edgelink.hpp"
+#include "version-config.h"
+#include "quickjs-bridge.hpp"
+#include "quickjs-runtime-pool.hpp"
+
+namespace edgelink::js {
+
+namespace {
+
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+inline uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/// @brief 字节码文件头
+struct BytecodeFileHeader {
+    char magic[8];
+    uint64_t hash;
+    uint64_t size;
+    uint64_t checksum;
+};
+
+constexpr char BYTECODE_FILE_MAGIC[8] = {'E', 'L', 'Q', 'J', 'S', 'B', 'C', '1'};
+
+/// @brief 缓存的字节码大小上限，更大的脚本不写缓存，读取时文件头里超过它的大小视为损坏
+constexpr uint64_t MAX_BYTECODE_SIZE = 64 * 1024 * 1024;
+
+/// @brief 字节码和程序的构建相关，哈希里混入版本和指针宽度
+const uint64_t SOURCE_HASH_SALT = [] {
+    const std::string salt = fmt::format("{0}/{1}/{2}", EDGELINK_VERSION, GIT_REVISION, sizeof(void*));
+    return fnv1a(FNV_OFFSET_BASIS, salt.data(), salt.size());
+}();
+
+[[noreturn]] void throw_js_exception(JSContext* ctx) {
+    throw InvalidDataException(fmt::format("QuickJS 错误：{0}", take_exception_message(ctx)));
+}
+
+}; // namespace
+
+BytecodeCache::BytecodeCache(std::filesystem::path dir) : _dir(std::move(dir)) {}
+
+uint64_t BytecodeCache::hash_source(const std::string_view source) {
+    return fnv1a(SOURCE_HASH_SALT, source.data(), source.size());
+}
+
+std::shared_ptr<const Bytes> BytecodeCache::get_or_compile(JSContext* ctx, const std::string& source,
+                                                           const char* filename) {
+    const auto hash = hash_source(source);
+    {
+        std::lock_guard lock(_mutex);
+        if (auto it = _memory.find(hash); it != _memory.end()) {
+            return it->second;
+        }
+    }
+
+    auto bytecode = this->load_file(hash);
+    if (!bytecode) {
+        JSValue func = JS_Eval(ctx, source.c_str(), source.size(), filename,
+                               JS_EVAL_TYPE_GLOBAL | JS_EVAL_FLAG_COMPILE_ONLY);
+        if (JS_IsException(func)) {
+            throw_js_exception(ctx);
+        }
+
+        size_t size = 0;
+        uint8_t* buf = JS_WriteObject(ctx, &size, func, JS_WRITE_OBJ_BYTECODE);
+        JS_FreeValue(ctx, func);
+        if (buf == nullptr) {
+            throw_js_exception(ctx);
+        }
+        auto compiled = std::make_shared<Bytes>(buf, buf + size);
+        js_free(ctx, buf);
+
+        this->save_file(hash, *compiled);
+        bytecode = std::move(compiled);
+    }
+
+    std::lock_guard lock(_mutex);
+    return _memory.emplace(hash, std::move(bytecode)).first->second;
+}
+
+std::shared_ptr<const Bytes> BytecodeCache::load_file(uint64_t hash) const {
+    if (_dir.empty()) {
+        return nullptr;
+    }
+
+    auto path = _dir / fmt::format("{0:016x}.qjsbc", hash);
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return nullptr;
+    }
+
+    BytecodeFileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, BYTECODE_FILE_MAGIC, sizeof(header.magic)) != 0 || header.hash != hash) {
+        return nullptr;
+    }
+
+    // 分配之前先核对文件头里的大小，截断或者损坏的文件不能导致启动时分配一大块内存
+    std::error_code ec;
+    auto const file_size = std::filesystem::file_size(path, ec);
+    if (ec || header.size > MAX_BYTECODE_SIZE || file_size != sizeof(header) + header.size) {
+        spdlog::warn("QuickJS 字节码缓存文件已损坏，重新编译：{0:016x}", hash);
+        return nullptr;
+    }
+
+    auto bytecode = std::make_shared<Bytes>(header.size);
+    if (!file.read(reinterpret_cast<char*>(bytecode->data()), static_cast<std::streamsize>(header.size)) ||
+        fnv1a(FNV_OFFSET_BASIS, bytecode->data(), bytecode->size()) != header.checksum) {
+        // QuickJS 不校验字节码，损坏的缓存文件必须在这里挡住
+        spdlog::warn("QuickJS 字节码缓存文件已损坏，重新编译：{0:016x}", hash);
+        return nullptr;
+    }
+    return bytecode;
+}
+
+void BytecodeCache::save_file(uint64_t hash, const Bytes& bytecode) const {
+    if (_dir.empty() || bytecode.size() > MAX_BYTECODE_SIZE) {
+        return;
+    }
+
+    // 缓存只是优化，写不进去就算了
+    std::error_code ec;
+    std::filesystem::create_directories(_dir, ec);
+    if (ec) {
+        spdlog::debug("无法创建 QuickJS 字节码缓存目录 '{0}'：{1}", _dir.string(), ec.message());
+        return;
+    }
+
+    BytecodeFileHeader header;
+    std::memcpy(header.magic, BYTECODE_FILE_MAGIC, sizeof(header.magic));
+    header.hash = hash;
+    header.size = bytecode.size();
+    header.checksum = fnv1a(FNV_OFFSET_BASIS, bytecode.data(), bytecode.size());
+
+    // 先写临时文件再改名，避免其他进程读到写了一半的文件
+    auto path = _dir / fmt::format("{0:016x}.qjsbc", hash);
+    auto tmp_path = path;
+    tmp_path += fmt::format(".{0}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(bytecode.data()), static_cast<std::streamsize>(bytecode.size()));
+        if (!file) {
+            std::filesystem::remove(tmp_path, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmp_path, ec);
+    }
+}
+
+void eval_bytecode(JSContext* ctx, const Bytes& bytecode) {
+    JSValue func = JS_ReadObject(ctx, bytecode.data(), bytecode.size(), JS_READ_OBJ_BYTECODE);
+    if (JS_IsException(func)) {
+        throw_js_exception(ctx);
+    }
+    JSValue result = JS_EvalFunction(ctx, func); // func 的所有权转移给 JS_EvalFunction
+    if (JS_IsException(result)) {
+        throw_js_exception(ctx);
+    }
+    JS_FreeValue(ctx, result);
+}
+
+std::unique_lock<std::mutex> SharedRuntime::enter() {
+    std::unique_lock lock(_mutex);
+    JS_UpdateStackTop(_runtime.rt);
+    return lock;
+}
+
+std::shared_ptr<Strand> SharedRuntime::strand(const boost::asio::any_io_executor& executor) {
+    std::lock_guard lock(_strand_mutex);
+    auto strand = _strand.lock();
+    // 引擎重启以后执行器可能换了，旧的 strand 随着还在使用它的节点一起销毁
+    if (!strand || strand->get_inner_executor() != executor) {
+        strand = std::make_shared<Strand>(boost::asio::make_strand(executor));
+        _strand = strand;
+    }
+    return strand;
+}
+
+RuntimeLease::RuntimeLease(std::shared_ptr<SharedRuntime> runtime) : _runtime(std::move(runtime)) {
+    _runtime->_context_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+RuntimeLease::~RuntimeLease() { _runtime->_context_count.fetch_sub(1, std::memory_order_relaxed); }
+
+RuntimePool::RuntimePool(size_t max_runtimes, std::filesystem::path cache_dir)
+    : _max_runtimes(max_runtimes), _bytecode_cache(std::move(cache_dir)) {}
+
+std::unique_ptr<RuntimeLease> RuntimePool::acquire() {
+    if (_max_runtimes == 0) {
+        return this->acquire_dedicated();
+    }
+
+    std::lock_guard lock(_mutex);
+    if (_runtimes.size() < _max_runtimes) {
+        auto runtime = std::make_shared<SharedRuntime>();
+        _runtimes.push_back(runtime);
+        return std::make_unique<RuntimeLease>(std::move(runtime));
+    }
+
+    auto least_used = std::min_element(_runtimes.begin(), _runtimes.end(), [](auto const& a, auto const& b) {
+        return a->context_count() < b->context_count();
+    });
+    return std::make_unique<RuntimeLease>(*least_used);
+}
+
+std::unique_ptr<RuntimeLease> RuntimePool::acquire_dedicated() {
+    return std::make_unique<RuntimeLease>(std::make_shared<SharedRuntime>());
+}
+
+size_t RuntimePool::runtime_count() const {
+    std::lock_guard lock(_mutex);
+    return _runtimes.size();
+}
+
+RuntimePool& RuntimePool::instance(const EdgeLinkSettings& settings) {
+    static RuntimePool pool(settings.js_runtime_pool_size, settings.home_path / "cache" / "quickjs");
+    return pool;
+}
+
+}; // namespace edgelink::js
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <quickjs/quickjs.h>
+#include <quickjspp.hpp>
+
+namespace edgelink::js {
+
+/// @brief QuickJS 字节码缓存
+///
+/// 脚本按源码的哈希编译一次，字节码保存在内存中，同时写入磁盘目录，下次启动直接加载。
+/// 哈希里混入了程序的版本号，不同版本编译出的字节码不会被误用。
+class BytecodeCache final : private Noncopyable {
+  public:
+    /// @param dir 磁盘缓存目录，为空时只缓存在内存里
+    explicit BytecodeCache(std::filesystem::path dir);
+
+    /// @brief 获取全局脚本的字节码，缓存中没有时用 `ctx` 编译
+    /// @param source 脚本源码，QuickJS 要求以 '\0' 结尾，所以这里用 std::string
+    std::shared_ptr<const Bytes> get_or_compile(JSContext* ctx, const std::string& source, const char* filename);
+
+    static uint64_t hash_source(const std::string_view source);
+
+  private:
+    std::shared_ptr<const Bytes> load_file(uint64_t hash) const;
+    void save_file(uint64_t hash, const Bytes& bytecode) const;
+
+  private:
+    const std::filesystem::path _dir;
+    std::mutex _mutex;
+    std::unordered_map<uint64_t, std::shared_ptr<const Bytes>> _memory;
+};
+
+/// @brief 在上下文中执行字节码
+void eval_bytecode(JSContext* ctx, const Bytes& bytecode);
+
+/// @brief 可以被多个节点共享的 QuickJS 运行时
+///
+/// 同一个运行时中的所有上下文都不能被并发使用：脚本都在 `strand()` 上依次执行，
+/// 使用者在执行任何 JS 代码（包括创建和销毁上下文）之前还要调用 `enter()`
+class SharedRuntime final : private Noncopyable {
+  public:
+    SharedRuntime() = default;
+
+    qjs::Runtime& runtime() { return _runtime; }
+
+    /// @brief 锁住运行时，并把 QuickJS 记录的栈顶更新为当前线程的栈
+    ///
+    /// 运行时在加载流程的线程上创建，脚本却在线程池的任意线程上执行，QuickJS 按记录的栈顶检查栈溢出，
+    /// 不更新的话会误报溢出或者失去保护。脚本之间已经由 strand 互斥，这把锁只和上下文的创建、销毁竞争
+    std::unique_lock<std::mutex> enter();
+
+    /// @brief 使用这个运行时的所有工作者共用的 strand，由工作者持有，随最后一个使用它的节点销毁
+    std::shared_ptr<Strand> strand(const boost::asio::any_io_executor& executor);
+
+    size_t context_count() const { return _context_count.load(std::memory_order_relaxed); }
+
+  private:
+    friend class RuntimePool;
+
+    qjs::Runtime _runtime;
+    std::mutex _mutex;
+    std::mutex _strand_mutex;
+    std::weak_ptr<Strand> _strand;
+    std::atomic<size_t> _context_count = 0;
+};
+
+/// @brief 运行时租约，销毁时把运行时的上下文计数减一
+class RuntimeLease final : private Noncopyable {
+  public:
+    explicit RuntimeLease(std::shared_ptr<SharedRuntime> runtime);
+    ~RuntimeLease();
+
+    SharedRuntime& operator*() const { return *_runtime; }
+    SharedRuntime* operator->() const { return _runtime.get(); }
+
+  private:
+    std::shared_ptr<SharedRuntime> _runtime;
+};
+
+/// @brief function 节点共享的运行时池和字节码缓存
+class RuntimePool final : private Noncopyable {
+  public:
+    /// @param max_runtimes 最多创建的运行时数量，为 0 时每个节点使用独立的运行时
+    RuntimePool(size_t max_runtimes, std::filesystem::path cache_dir);
+
+    /// @brief 租用一个运行时：池子未满时新建，满了以后选择上下文最少的那个
+    std::unique_ptr<RuntimeLease> acquire();
+
+    /// @brief 新建一个不与其他节点共享的运行时，用于需要真正并行执行的场合
+    std::unique_ptr<RuntimeLease> acquire_dedicated();
+
+    BytecodeCache& bytecode_cache() { return _bytecode_cache; }
+
+    size_t runtime_count() const;
+
+    /// @brief 进程内所有 function 节点共享的池，第一次调用时按程序配置创建
+    static RuntimePool& instance(const EdgeLinkSettings& settings);
+
+  private:
+    const size_t _max_runtimes;
+    BytecodeCache _bytecode_cache;
+    mutable std::mutex _mutex;
+    std::vector<std::shared_ptr<SharedRuntime>> _runtimes;
+};
+
+}; // namespace edgelink::js
@@ -0,0 +1,152 @@
+#include "edgelink/edgelink.hpp"
+#include "range-kernels.hpp"
+
+// x86 上用函数级的 target 属性单独编译 AVX2 版本，运行时按 CPU 能力选择，整个程序不需要 -mavx2；
+// aarch64 的 NEON 支持双精度向量。armhf（ARMv7）的 NEON 只有单精度，所以那里使用标量实现。
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EL_RANGE_KERNEL_AVX2 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define EL_RANGE_KERNEL_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace edgelink::kernels {
+
+namespace {
+
+/// @brief `roll` 需要精确的 `fmod`，没有对应的向量指令，先逐个元素回绕，再交给向量实现缩放
+RangeParams roll_in_place(std::span<double> values, const RangeParams& params) {
+    if (params.action != RangeAction::ROLL) {
+        return params;
+    }
+    auto const divisor = params.maxin - params.minin;
+    for (auto& n : values) {
+        n = std::fmod(std::fmod(n - params.minin, divisor + divisor), divisor) + params.minin;
+    }
+    auto scale_params = params;
+    scale_params.action = RangeAction::SCALE;
+    return scale_params;
+}
+
+#if EL_RANGE_KERNEL_AVX2
+
+__attribute__((target("avx2"))) void range_map_avx2(std::span<double> values, const RangeParams& params) {
+    auto const p = roll_in_place(values, params);
+
+    const __m256d minin = _mm256_set1_pd(p.minin);
+    const __m256d maxin = _mm256_set1_pd(p.maxin);
+    const __m256d minout = _mm256_set1_pd(p.minout);
+    const __m256d in_span = _mm256_set1_pd(p.maxin - p.minin);
+    const __m256d out_span = _mm256_set1_pd(p.maxout - p.minout);
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d sign_mask = _mm256_set1_pd(-0.0);
+    const bool clamp = p.action == RangeAction::CLAMP;
+
+    double* data = values.data();
+    size_t i = 0;
+    for (; i + 4 <= values.size(); i += 4) {
+        __m256d v = _mm256_loadu_pd(data + i);
+        if (clamp) {
+            // 操作数的顺序保证 NaN 原样保留，与标量实现一致
+            v = _mm256_max_pd(minin, v);
+            v = _mm256_min_pd(maxin, v);
+        }
+        v = _mm256_add_pd(_mm256_mul_pd(_mm256_div_pd(_mm256_sub_pd(v, minin), in_span), out_span), minout);
+        if (p.round) {
+            // 没有“四舍五入、远离零”的舍入模式：先截断，小数部分不小于 0.5 时再向外进一
+            __m256d t = _mm256_round_pd(v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+            __m256d frac = _mm256_andnot_pd(sign_mask, _mm256_sub_pd(v, t));
+            __m256d away = _mm256_or_pd(_mm256_and_pd(v, sign_mask), one);
+            v = _mm256_blendv_pd(t, _mm256_add_pd(t, away), _mm256_cmp_pd(frac, half, _CMP_GE_OQ));
+        }
+        _mm256_storeu_pd(data + i, v);
+    }
+    for (; i < values.size(); i++) {
+        data[i] = range_map_one(data[i], p);
+    }
+}
+
+bool cpu_has_avx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+
+#elif EL_RANGE_KERNEL_NEON
+
+void range_map_neon(std::span<double> values, const RangeParams& params) {
+    auto const p = roll_in_place(values, params);
+
+    const float64x2_t minin = vdupq_n_f64(p.minin);
+    const float64x2_t maxin = vdupq_n_f64(p.maxin);
+    const float64x2_t minout = vdupq_n_f64(p.minout);
+    const float64x2_t in_span = vdupq_n_f64(p.maxin - p.minin);
+    const float64x2_t out_span = vdupq_n_f64(p.maxout - p.minout);
+    const bool clamp = p.action == RangeAction::CLAMP;
+
+    double* data = values.data();
+    size_t i = 0;
+    for (; i + 2 <= values.size(); i += 2) {
+        float64x2_t v = vld1q_f64(data + i);
+        if (clamp) {
+            v = vminq_f64(vmaxq_f64(v, minin), maxin);
+        }
+        v = vaddq_f64(vmulq_f64(vdivq_f64(vsubq_f64(v, minin), in_span), out_span), minout);
+        if (p.round) {
+            v = vrndaq_f64(v); // 四舍五入、远离零，与 std::round 相同
+        }
+        vst1q_f64(data + i, v);
+    }
+    for (; i < values.size(); i++) {
+        data[i] = range_map_one(data[i], p);
+    }
+}
+
+#endif
+
+}; // namespace
+
+RangeAction parse_range_action(const std::string_view text) {
+    if (text == "scale") {
+        return RangeAction::SCALE;
+    } else if (text == "clamp") {
+        return RangeAction::CLAMP;
+    } else if (text == "roll") {
+        return RangeAction::ROLL;
+    } else {
+        // 其他动作（比如 `drop`）一直是按 `scale` 处理的
+        return RangeAction::SCALE;
+    }
+}
+
+std::string_view range_kernel_name() {
+#if EL_RANGE_KERNEL_AVX2
+    return cpu_has_avx2() ? "avx2" : "scalar";
+#elif EL_RANGE_KERNEL_NEON
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+void range_map(std::span<double> values, const RangeParams& params) {
+#if EL_RANGE_KERNEL_AVX2
+    if (cpu_has_avx2()) {
+        range_map_avx2(values, params);
+        return;
+    }
+#elif EL_RANGE_KERNEL_NEON
+    range_map_neon(values, params);
+    return;
+#endif
+    range_map_scalar(values, params);
+}
+
+void range_map_scalar(std::span<double> values, const RangeParams& params) {
+    for (auto& n : values) {
+        n = range_map_one(n, params);
+    }
+}
+
+}; // namespace edgelink::kernels
@@ -0,0 +1,53 @@
+#pragma once
+
+namespace edgelink::kernels {
+
+enum class RangeAction {
+    SCALE, ///< 线性缩放
+    CLAMP, ///< 先限制在输入范围内再缩放
+    ROLL,  ///< 先在输入范围内回绕再缩放
+};
+
+/// @brief 解析 range 节点的 `action` 配置，不认识的动作按 `scale` 处理
+RangeAction parse_range_action(const std::string_view text);
+
+struct RangeParams {
+    double minin;
+    double maxin;
+    double minout;
+    double maxout;
+    RangeAction action;
+    bool round;
+};
+
+/// @brief 当前 CPU 上 `range_map` 实际使用的实现：`avx2`、`neon` 或 `scalar`
+std::string_view range_kernel_name();
+
+/// @brief 对数组原地做 range 节点的映射，按 CPU 能力选择 SIMD 实现
+///
+/// 结果与逐个元素调用 `range_map_one` 相同（允许最后一位的舍入误差）。
+void range_map(std::span<double> values, const RangeParams& params);
+
+/// @brief 逐个元素的标量实现，也是没有 SIMD 时的后备实现
+void range_map_scalar(std::span<double> values, const RangeParams& params);
+
+inline double range_map_one(double n, const RangeParams& p) {
+    if (p.action == RangeAction::CLAMP) {
+        if (n < p.minin) {
+            n = p.minin;
+        }
+        if (n > p.maxin) {
+            n = p.maxin;
+        }
+    } else if (p.action == RangeAction::ROLL) {
+        auto divisor = p.maxin - p.minin;
+        n = std::fmod(std::fmod(n - p.minin, divisor + divisor), divisor) + p.minin;
+    }
+    n = ((n - p.minin) / (p.maxin - p.minin) * (p.maxout - p.minout)) + p.minout;
+    if (p.round) {
+        n = std::round(n);
+    }
+    return n;
+}
+
+}; // namespace edgelink::kernels
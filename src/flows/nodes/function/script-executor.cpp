@@ -0,0 +1,77 @@
+#include "edgelink/edgelink.hpp"
+#include "script-executor.hpp"
+
+namespace edgelink::js {
+
+ExecMode parse_exec_mode(const std::string_view text) {
+    if (text == "serialized") {
+        return ExecMode::SERIALIZED;
+    } else if (text == "parallel") {
+        return ExecMode::PARALLEL;
+    } else if (text == "keyed") {
+        return ExecMode::KEYED;
+    } else {
+        throw InvalidDataException(fmt::format("不支持的 execMode 选项：'{0}'", text));
+    }
+}
+
+ScriptWorker::ScriptWorker(std::unique_ptr<RuntimeLease> runtime)
+    : _runtime(std::move(runtime)), _user_func(JS_UNDEFINED) {
+    auto lock = this->enter();
+    _context = std::make_unique<qjs::Context>((**_runtime).runtime());
+}
+
+ScriptWorker::~ScriptWorker() {
+    auto lock = this->enter();
+    JS_FreeValue(_context->ctx, _user_func);
+    _context.reset();
+}
+
+void ScriptWorker::set_user_func(JSValue func) {
+    JS_FreeValue(_context->ctx, _user_func);
+    _user_func = func;
+}
+
+ScriptExecutor::ScriptExecutor(ExecMode mode, size_t worker_count, RuntimePool& pool, const SetupFunc& setup)
+    : _mode(mode) {
+    if (_mode == ExecMode::SERIALIZED || worker_count == 0) {
+        worker_count = 1;
+    }
+
+    for (size_t i = 0; i < worker_count; i++) {
+        // 只有一个工作者的时候可以共享运行时；多个工作者各自独占运行时，否则它们会在同一把锁上排队
+        auto runtime = worker_count == 1 ? pool.acquire() : pool.acquire_dedicated();
+        auto worker = std::make_unique<ScriptWorker>(std::move(runtime));
+        {
+            auto lock = worker->enter();
+            setup(*worker);
+        }
+        _workers.emplace_back(std::move(worker));
+    }
+}
+
+void ScriptExecutor::bind_executor(const boost::asio::any_io_executor& executor) {
+    for (auto& worker : _workers) {
+        worker->_strand = (**worker->_runtime).strand(executor);
+    }
+}
+
+ScriptWorker& ScriptExecutor::select(uint64_t key) {
+    switch (_mode) {
+    case ExecMode::KEYED:
+        return *_workers[key % _workers.size()];
+
+    case ExecMode::PARALLEL: {
+        // 选择排队最少的工作者
+        auto it = std::min_element(_workers.begin(), _workers.end(), [](auto const& a, auto const& b) {
+            return a->_in_flight.load(std::memory_order_relaxed) < b->_in_flight.load(std::memory_order_relaxed);
+        });
+        return **it;
+    }
+
+    default:
+        return *_workers.front();
+    }
+}
+
+}; // namespace edgelink::js
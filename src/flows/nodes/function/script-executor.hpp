@@ -0,0 +1,112 @@
+#pragma once
+
+#include "quickjs-runtime-pool.hpp"
+
+namespace edgelink::js {
+
+/// @brief function 节点执行脚本的方式
+enum class ExecMode {
+    SERIALIZED, ///< 所有消息在同一个上下文里依次执行
+    PARALLEL,   ///< 多个工作者并行执行，每个工作者有自己的上下文和全局状态
+    KEYED,      ///< 按消息的键分配工作者，键相同的消息依次执行
+};
+
+/// @brief 解析节点配置中的 `execMode` 值：`serialized`、`parallel` 或 `keyed`
+ExecMode parse_exec_mode(const std::string_view text);
+
+/// @brief 脚本工作者：一个独占的 QuickJS 上下文，以及执行它的 strand，共享同一个运行时的工作者共用一个 strand
+class ScriptWorker final : private Noncopyable {
+  public:
+    explicit ScriptWorker(std::unique_ptr<RuntimeLease> runtime);
+    ~ScriptWorker();
+
+    qjs::Context& context() { return *_context; }
+    JSContext* ctx() const { return _context->ctx; }
+
+    /// @brief 在当前线程执行 JS 代码之前调用，运行时可能与其他节点共享，见 `SharedRuntime::enter()`
+    std::unique_lock<std::mutex> enter() { return (**_runtime).enter(); }
+
+    JSValueConst user_func() const { return _user_func; }
+
+    /// @brief 设置用户函数，工作者接管该值的所有权
+    void set_user_func(JSValue func);
+
+  private:
+    friend class ScriptExecutor;
+
+    std::unique_ptr<RuntimeLease> _runtime;
+    std::unique_ptr<qjs::Context> _context;
+    JSValue _user_func;
+    std::shared_ptr<Strand> _strand;
+    std::atomic<size_t> _in_flight = 0;
+};
+
+/// @brief 按执行方式把脚本调用分配到工作者上
+///
+/// 每个工作者的调用都经过它的运行时的 strand，所以同一个运行时永远不会被并发使用，
+/// 共享运行时的节点排队时也不会阻塞线程池；不同运行时的工作者之间可以在多个线程上并行。
+class ScriptExecutor final : private Noncopyable {
+  public:
+    using SetupFunc = std::function<void(ScriptWorker&)>;
+
+    /// @param setup 初始化每个工作者的上下文，调用前已经调用过 `ScriptWorker::enter()`
+    ScriptExecutor(ExecMode mode, size_t worker_count, RuntimePool& pool, const SetupFunc& setup);
+
+    ExecMode mode() const { return _mode; }
+    size_t worker_count() const { return _workers.size(); }
+
+    /// @brief 为所有工作者绑定运行时的 strand，在执行器可用以后（节点启动的时候）调用
+    void bind_executor(const boost::asio::any_io_executor& executor);
+
+    /// @brief 依次在所有工作者上执行，用于 initialize 和 finalize 这类每个上下文都要执行一次的脚本
+    template <typename TFunc> Awaitable<void> async_run_all(TFunc func) {
+        for (auto& worker : _workers) {
+            co_await this->async_run_on(*worker, func);
+        }
+    }
+
+    /// @brief 选择一个工作者执行
+    ///
+    /// 脚本在工作者的 strand 上执行，完成以后调用者回到它自己的执行器上继续，
+    /// 所以调用者之后发送消息、访问节点状态仍然在节点的 strand 上。
+    /// @param key 消息的键，只在 `ExecMode::KEYED` 下使用
+    template <typename TFunc>
+    Awaitable<std::invoke_result_t<TFunc&, ScriptWorker&>> async_run(uint64_t key, TFunc func) {
+        auto& worker = this->select(key);
+
+        struct InFlightGuard {
+            std::atomic<size_t>& count;
+            ~InFlightGuard() { count.fetch_sub(1, std::memory_order_relaxed); }
+        };
+        worker._in_flight.fetch_add(1, std::memory_order_relaxed);
+        InFlightGuard guard{worker._in_flight};
+
+        co_return co_await this->async_run_on(worker, func);
+    }
+
+  private:
+    ScriptWorker& select(uint64_t key);
+
+    template <typename TFunc>
+    Awaitable<std::invoke_result_t<TFunc&, ScriptWorker&>> async_run_on(ScriptWorker& worker, TFunc& func) {
+        using Result = std::invoke_result_t<TFunc&, ScriptWorker&>;
+
+        // 运行在 strand 上的部分，到返回之间没有挂起点
+        auto run_entered = [&worker, &func]() -> Result {
+            auto lock = worker.enter();
+            return func(worker);
+        };
+        if (!worker._strand) {
+            co_return run_entered();
+        }
+        co_return co_await boost::asio::co_spawn(
+            *worker._strand, [&run_entered]() -> Awaitable<Result> { co_return run_entered(); },
+            boost::asio::use_awaitable);
+    }
+
+  private:
+    const ExecMode _mode;
+    std::vector<std::unique_ptr<ScriptWorker>> _workers;
+};
+
+}; // namespace edgelink::js
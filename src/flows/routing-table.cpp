@@ -0,0 +1,153 @@
+#include "edgelink/edgelink.hpp"
+#include "routing-table.hpp"
+
+namespace edgelink::flows {
+
+RoutingTable RoutingTable::build(std::span<const std::unique_ptr<IFlowNode>> nodes, const MailboxResolver& mailbox_of,
+                                 bool sync_delivery) {
+    RoutingTable table;
+    table._nodes.reserve(nodes.size());
+    boost::unordered_flat_map<const IFlowNode*, Mailbox*> mailboxes;
+
+    for (auto const& node : nodes) {
+        auto const& ports = node->output_ports();
+        table._nodes.emplace(node.get(), NodeRoutes{static_cast<uint32_t>(table._ports.size()),
+                                                    static_cast<uint32_t>(ports.size())});
+
+        for (auto const& port : ports) {
+            PortRoutes routes{&port, static_cast<uint32_t>(table._destinations.size()),
+                              static_cast<uint32_t>(port.wires().size()), false};
+            for (auto* dest : port.wires()) {
+                switch (dest->descriptor()->kind()) {
+                case NodeKind::PIPE:
+                case NodeKind::SINK:
+                case NodeKind::JUNCTION:
+                    break;
+
+                default:
+                    throw BadFlowConfigException(fmt::format("节点 '{0}' 不能接收消息，但节点 '{1}' 连接到了它",
+                                                             dest->id(), node->id()));
+                }
+                auto [it, inserted] = mailboxes.try_emplace(dest, nullptr);
+                if (inserted) {
+                    it->second = mailbox_of(dest);
+                }
+                table._destinations.push_back(Route{dest, it->second});
+            }
+            table._ports.push_back(routes);
+        }
+    }
+
+    // 统计每个节点的输入连线数
+    boost::unordered_flat_map<const IFlowNode*, uint32_t> fan_in;
+    for (auto const& route : table._destinations) {
+        fan_in[route.node]++;
+    }
+    for (auto& routes : table._ports) {
+        routes.exclusive = routes.count == 1 && fan_in[table._destinations[routes.offset].node] == 1;
+    }
+
+    table.mark_back_edges(nodes);
+    if (sync_delivery) {
+        table.mark_sync_routes(nodes);
+    }
+    return table;
+}
+
+void RoutingTable::mark_back_edges(std::span<const std::unique_ptr<IFlowNode>> nodes) {
+    enum class Color : uint8_t {
+        WHITE, ///< 还没有访问
+        GRAY,  ///< 在遍历栈中
+        BLACK, ///< 已经访问完
+    };
+
+    // 一个节点所有输出端口的连线在 `_destinations` 中是连续的
+    struct Frame {
+        const IFlowNode* node;
+        uint32_t next;
+        uint32_t end;
+    };
+    auto make_frame = [this](const IFlowNode* node) {
+        auto const ports = this->ports_of(node);
+        if (ports.empty()) {
+            return Frame{node, 0, 0};
+        }
+        return Frame{node, ports.front().offset, ports.back().offset + ports.back().count};
+    };
+
+    boost::unordered_flat_map<const IFlowNode*, Color> colors;
+    colors.reserve(nodes.size());
+    std::vector<Frame> stack;
+    for (auto const& root : nodes) {
+        if (colors[root.get()] != Color::WHITE) {
+            continue;
+        }
+        colors[root.get()] = Color::GRAY;
+        stack.push_back(make_frame(root.get()));
+        while (!stack.empty()) {
+            auto& frame = stack.back();
+            if (frame.next == frame.end) {
+                colors[frame.node] = Color::BLACK;
+                stack.pop_back();
+                continue;
+            }
+            auto& route = _destinations[frame.next++];
+            auto& color = colors[route.node];
+            if (color == Color::GRAY) {
+                route.back_edge = true;
+            } else if (color == Color::WHITE) {
+                color = Color::GRAY;
+                stack.push_back(make_frame(route.node));
+            }
+        }
+    }
+}
+
+void RoutingTable::mark_sync_routes(std::span<const std::unique_ptr<IFlowNode>> nodes) {
+    // 每个节点最多只有一条独占的输入连线
+    boost::unordered_flat_map<const IFlowNode*, std::pair<IFlowNode*, Route*>> candidates;
+    for (auto const& node : nodes) {
+        if (node->is_concurrent()) {
+            continue;
+        }
+        auto const& node_routes = _nodes.at(node.get());
+        for (auto& port : std::span<PortRoutes>(_ports).subspan(node_routes.first_port, node_routes.port_count)) {
+            auto& route = _destinations[port.offset];
+            // 同时处理多条消息的节点需要自己的投递协程，不走同步投递
+            if (port.exclusive && !route.back_edge && !route.node->is_concurrent() &&
+                route.node->max_in_flight() == 1) {
+                candidates.emplace(route.node, std::make_pair(node.get(), &route));
+            }
+        }
+    }
+
+    // 节点在同步链上的位置，链首为 0；候选连线不成环，沿上游走总能走到链首
+    boost::unordered_flat_map<const IFlowNode*, size_t> positions;
+    std::vector<const IFlowNode*> path;
+    for (auto const& node : nodes) {
+        for (const IFlowNode* current = node.get(); !positions.contains(current);) {
+            auto it = candidates.find(current);
+            if (it == candidates.end()) {
+                positions.emplace(current, 0);
+                break;
+            }
+            path.push_back(current);
+            current = it->second.first;
+        }
+        while (!path.empty()) {
+            auto const* current = path.back();
+            path.pop_back();
+            auto& [source, route] = candidates.at(current);
+            auto position = positions.at(source) + 1;
+            if (position < MAX_SYNC_CHAIN_LENGTH) {
+                route->sync = true;
+                _sync_sources.emplace(current, source);
+            } else {
+                position = 0;
+            }
+            positions.emplace(current, position);
+        }
+    }
+}
+
+}; // namespace edgelink::flows
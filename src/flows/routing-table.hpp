@@ -0,0 +1,88 @@
+#pragma once
+
+namespace edgelink::flows {
+
+/// @brief 流程预编译的路由表
+///
+/// 流程创建的时候把所有节点的连线展开到一块连续的内存里，发送消息时只需要一次查找，
+/// 不再逐条连线分配 `Envelope`。目标节点的类型也在创建时检查，发送时不再检查。
+class RoutingTable final {
+  public:
+    /// @brief 一条连线的目标
+    struct Route {
+        IFlowNode* node;
+        Mailbox* mailbox;       ///< 目标节点的邮箱
+        bool back_edge = false; ///< 连线指回上游，构成了环（包括自环），邮箱满的时候不能让发送方挂起
+        bool sync = false;      ///< 同步投递：目标节点与发送方共用 strand，消息在发送方的协程里直接交给目标节点
+    };
+
+    /// @brief 一个输出端口的所有目标节点在 `_destinations` 中的区间
+    struct PortRoutes {
+        const OutputPort* port;
+        uint32_t offset;
+        uint32_t count;
+        bool exclusive; ///< 端口只连接了一个节点，而且该节点没有其他输入，可以同步投递
+    };
+
+    RoutingTable() = default;
+    RoutingTable(RoutingTable&&) = default;
+    RoutingTable& operator=(RoutingTable&&) = default;
+
+    using MailboxResolver = std::function<Mailbox*(const IFlowNode* node)>;
+
+    /// @brief 根据节点的输出端口编译路由表
+    /// @param mailbox_of 获取（或者创建）目标节点的邮箱，每个目标节点只调用一次
+    /// @throw BadFlowConfigException 连线指向了不能接收消息的节点
+    ///
+    /// 环上的节点各自在投递协程里等待下游的邮箱腾出空位时会互相等待，所以这里找出每个环上的一条回边，
+    /// 沿回边发送的消息在邮箱满的时候直接丢弃，保证环上总有一个节点能继续取消息
+    /// @param sync_delivery 是否标记可以同步投递的连线，见 `mark_sync_routes()`
+    static RoutingTable build(std::span<const std::unique_ptr<IFlowNode>> nodes, const MailboxResolver& mailbox_of,
+                              bool sync_delivery = false);
+
+    /// @brief 节点的所有输出端口，节点不在表中时返回空
+    std::span<const PortRoutes> ports_of(const IFlowNode* node) const {
+        auto it = _nodes.find(node);
+        if (it == _nodes.end()) {
+            return {};
+        }
+        return std::span<const PortRoutes>(_ports).subspan(it->second.first_port, it->second.port_count);
+    }
+
+    std::span<const Route> destinations(const PortRoutes& port) const {
+        return std::span<const Route>(_destinations).subspan(port.offset, port.count);
+    }
+
+    size_t route_count() const { return _destinations.size(); }
+
+    /// @brief 通过同步连线向节点发送消息的上游节点，节点不是同步投递的目标时返回空
+    IFlowNode* sync_source_of(const IFlowNode* node) const {
+        auto it = _sync_sources.find(node);
+        return it != _sync_sources.end() ? it->second : nullptr;
+    }
+
+    /// @brief 一条同步链上最多的节点数，更长的链从这里断开，改为经过邮箱投递
+    static constexpr size_t MAX_SYNC_CHAIN_LENGTH = 16;
+
+  private:
+    struct NodeRoutes {
+        uint32_t first_port;
+        uint32_t port_count;
+    };
+
+    /// @brief 按节点的顺序深度优先遍历连线，把指向遍历栈中节点的连线标记为回边
+    void mark_back_edges(std::span<const std::unique_ptr<IFlowNode>> nodes);
+
+    /// @brief 标记同步连线：独占的、不是回边的、两端都不是并发节点、目标节点每次只处理一条消息的连线
+    ///
+    /// 同步连线把节点串成链，链上的节点共用链首的 strand；去掉回边以后连线不成环，所以链总有链首，
+    /// 链的长度限制在 `MAX_SYNC_CHAIN_LENGTH` 以内
+    void mark_sync_routes(std::span<const std::unique_ptr<IFlowNode>> nodes);
+
+    std::vector<Route> _destinations;
+    std::vector<PortRoutes> _ports;
+    boost::unordered_flat_map<const IFlowNode*, NodeRoutes> _nodes;
+    boost::unordered_flat_map<const IFlowNode*, IFlowNode*> _sync_sources;
+};
+
+}; // namespace edgelink::flows
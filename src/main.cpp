@@ -48,6 +48,7 @@ int main(int argc, char* argv[]) {
 
     auto exec_path = fs::canonical(std::filesystem::path(argv[0]));
 
+    po::variables_map vm;
     try {
         po::options_description desc("Allowed options");
         desc.add_options()                                                                   //
@@ -63,14 +64,28 @@ int main(int argc, char* argv[]) {
             ("output-file", po::value<std::string>(), "Output file")                         //
             ("project-id,pid", po::value<std::string>(), "Project ID")                       //
             ("device-id,did", po::value<std::string>(), "Device ID")                         //
+            ("msg-arena", po::value<bool>()->default_value(false), "Allocate messages in pooled arenas") //
+            ("js-runtime-pool", po::value<size_t>()->default_value(4),
+             "Number of QuickJS runtimes shared by function nodes, 0 for one per node") //
+            ("worker-threads", po::value<size_t>()->default_value(0),
+             "Number of threads running the flows, 0 for the hardware concurrency") //
+            ("mailbox-capacity", po::value<size_t>()->default_value(256), "Default capacity of node mailboxes") //
+            ("mailbox-overflow", po::value<std::string>()->default_value("block"),
+             "What to do when a node mailbox is full: block, drop-oldest or drop-newest; "
+             "block still drops messages sent back along a loop") //
+            ("metrics-file", po::value<std::string>()->default_value(""),
+             "Periodically dump per-node metrics as JSON to this file") //
+            ("metrics-interval", po::value<size_t>()->default_value(10000),
+             "Interval of the metrics dump in milliseconds") //
             ;
 
-        po::variables_map vm;
         po::store(po::parse_command_line(argc, argv, desc), vm);
 
-        // 如果命令行中包含 --config 选项，读取配置文件
-        if (vm.count("settings")) {
-            std::ifstream config_file(vm["settings"].as<std::string>());
+        // 如果命令行中包含 --settings 选项，读取指定的配置文件，否则读取当前目录下的 edgelink.ini
+        auto settings_path =
+            vm.count("settings") ? fs::path(vm["settings"].as<std::string>()) : fs::path("edgelink.ini");
+        if (vm.count("settings") || fs::exists(settings_path)) {
+            std::ifstream config_file(settings_path);
             po::store(po::parse_config_file(config_file, desc), vm);
         }
 
@@ -95,10 +110,22 @@ int main(int argc, char* argv[]) {
 
     SPDLOG_INFO("日志子系统已初始化");
 
+    auto worker_threads = vm["worker-threads"].as<size_t>();
+    if (worker_threads == 0) {
+        worker_threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+
     EdgeLinkSettings el_settings{
         .home_path = fs::path("./"), // exec_path.parent_path(),
         .executable_location = exec_path.parent_path(),
         .flows_json_path = "./flows.json",
+        .msg_arena_enabled = vm["msg-arena"].as<bool>(),
+        .js_runtime_pool_size = vm["js-runtime-pool"].as<size_t>(),
+        .worker_threads = worker_threads,
+        .mailbox_capacity = vm["mailbox-capacity"].as<size_t>(),
+        .mailbox_overflow = vm["mailbox-overflow"].as<std::string>(),
+        .metrics_file = vm["metrics-file"].as<std::string>(),
+        .metrics_interval_ms = vm["metrics-interval"].as<size_t>(),
     };
 
     const auto injector =
@@ -113,8 +140,8 @@ int main(int argc, char* argv[]) {
 
     // 启动主程序
     try {
-        auto nconcurrency = std::thread::hardware_concurrency() + 1;
-        asio::io_context io_context(nconcurrency);
+        auto nconcurrency = el_settings.worker_threads;
+        asio::io_context io_context(static_cast<int>(nconcurrency));
         SPDLOG_INFO("系统并发数量：{}", nconcurrency);
 
         asio::signal_set signals(io_context, SIGINT, SIGTERM);
@@ -125,7 +152,31 @@ int main(int argc, char* argv[]) {
 
         asio::co_spawn(io_context, app.run_async(), asio::detached);
 
-        io_context.run();
+        // 主线程也是工作线程之一
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < nconcurrency; i++) {
+            workers.emplace_back([&io_context] {
+                try {
+                    io_context.run();
+                } catch (std::exception& ex) {
+                    SPDLOG_CRITICAL("工作线程异常！错误消息：{0}", ex.what());
+                    io_context.stop();
+                }
+            });
+        }
+
+        try {
+            io_context.run();
+        } catch (...) {
+            io_context.stop();
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            throw;
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
         SPDLOG_INFO("系统协程系统已停止，开始进行清理...");
         spdlog::shutdown();
     } catch (std::exception& ex) {
@@ -0,0 +1,45 @@
+#include <edgelink/edgelink.hpp>
+
+using namespace edgelink;
+
+TEST_CASE("Test flow config index") {
+    auto flows_config = boost::json::parse(R"(
+        [
+            { "id": "f1", "type": "tab", "label": "Flow 1", "disabled": false },
+            { "id": "g1", "type": "mqtt-broker", "name": "" },
+            { "id": "j1", "type": "junction", "z": "f1", "name": "", "wires": [["j2"]] },
+            { "id": "f2", "type": "tab", "label": "Flow 2", "disabled": false },
+            { "id": "c1", "type": "comment", "z": "f1", "name": "" },
+            { "id": "j3", "type": "junction", "z": "f2", "name": "", "wires": [] },
+            { "id": "j2", "type": "junction", "z": "f1", "name": "", "wires": [] }
+        ]
+    )")
+                            .as_array();
+
+    FlowConfigIndex index(flows_config);
+
+    SECTION("Flows and global nodes keep the configuration order") {
+        REQUIRE(index.size() == flows_config.size());
+        REQUIRE(index.flows().size() == 2);
+        REQUIRE(index.flows()[0]->at("id").as_string() == "f1");
+        REQUIRE(index.flows()[1]->at("id").as_string() == "f2");
+        REQUIRE(index.global_nodes().size() == 1);
+        REQUIRE(index.global_nodes()[0]->at("id").as_string() == "g1");
+    }
+
+    SECTION("Elements are grouped by flow and comments are skipped") {
+        auto f1 = index.flow_elements("f1");
+        REQUIRE(f1.size() == 2);
+        REQUIRE(f1[0]->at("id").as_string() == "j1");
+        REQUIRE(f1[1]->at("id").as_string() == "j2");
+
+        REQUIRE(index.flow_elements("f2").size() == 1);
+        REQUIRE(index.flow_elements("nope").empty());
+    }
+
+    SECTION("Elements can be found by id without copying the key") {
+        REQUIRE(index.find("j3") == &flows_config[5].as_object());
+        REQUIRE(index.find("c1") != nullptr);
+        REQUIRE(index.find("missing") == nullptr);
+    }
+}
@@ -0,0 +1,79 @@
+#include <edgelink/edgelink.hpp>
+
+using namespace edgelink;
+
+namespace {
+
+class TestNode : public FlowNode {
+  public:
+    TestNode(const JsonObject& config, bool concurrent)
+        : FlowNode("n1", nullptr, nullptr, config), _concurrent(concurrent) {}
+
+    Awaitable<void> async_start() override { co_return; }
+    Awaitable<void> async_stop() override { co_return; }
+
+    bool is_concurrent() const override { return _concurrent; }
+
+  private:
+    const bool _concurrent;
+};
+
+}; // namespace
+
+TEST_CASE("Test FlowNode executor binding") {
+    const JsonObject config{{"type", "test"}, {"name", "Test"}, {"wires", JsonArray{}}};
+    boost::asio::io_context io;
+
+    SECTION("Nodes get their own strand by default") {
+        TestNode a(config, false);
+        TestNode b(config, false);
+        a.bind_executor(io.get_executor());
+        b.bind_executor(io.get_executor());
+
+        REQUIRE(a.executor().target<Strand>() != nullptr);
+        REQUIRE(a.executor() != b.executor());
+    }
+
+    SECTION("Nodes bound to a strand share it") {
+        TestNode head(config, false);
+        TestNode follower(config, false);
+        head.bind_executor(io.get_executor());
+        follower.bind_executor(head.executor());
+
+        REQUIRE(follower.executor() == head.executor());
+    }
+
+    SECTION("Concurrent nodes run directly on the thread pool") {
+        TestNode node(config, true);
+        node.bind_executor(io.get_executor());
+
+        REQUIRE(node.executor().target<Strand>() == nullptr);
+        REQUIRE(node.executor() == boost::asio::any_io_executor(io.get_executor()));
+    }
+
+    SECTION("Messages to one node are never handled concurrently") {
+        TestNode node(config, false);
+        node.bind_executor(io.get_executor());
+
+        std::atomic<int> active = 0;
+        std::atomic<bool> overlapped = false;
+        for (int i = 0; i < 200; i++) {
+            boost::asio::post(node.executor(), [&] {
+                if (active.fetch_add(1) != 0) {
+                    overlapped = true;
+                }
+                std::this_thread::yield();
+                active.fetch_sub(1);
+            });
+        }
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; i++) {
+            threads.emplace_back([&io] { io.run(); });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        REQUIRE_FALSE(overlapped);
+    }
+}
@@ -0,0 +1,97 @@
+#include <edgelink/edgelink.hpp>
+
+using namespace edgelink;
+
+TEST_CASE("Test flow hooks") {
+    Hook<void(int, int*)> hook;
+
+    SECTION("An empty hook does nothing") {
+        REQUIRE(hook.empty());
+        int sum = 0;
+        hook(1, &sum);
+        REQUIRE(sum == 0);
+    }
+
+    SECTION("Subscribers are called in order and can be disconnected") {
+        std::vector<int> calls;
+        auto c1 = hook.connect([&calls](int v, int*) { calls.push_back(v); });
+        auto c2 = hook.connect([&calls](int v, int*) { calls.push_back(v * 10); });
+        REQUIRE(hook.size() == 2);
+
+        hook(1, nullptr);
+        REQUIRE(calls == std::vector<int>{1, 10});
+
+        c1.disconnect();
+        REQUIRE_FALSE(c1.connected());
+        REQUIRE(hook.size() == 1);
+        hook(2, nullptr);
+        REQUIRE(calls == std::vector<int>{1, 10, 20});
+
+        hook.disconnect_all();
+        REQUIRE(hook.empty());
+        hook(3, nullptr);
+        REQUIRE(calls.size() == 3);
+    }
+
+    SECTION("A subscriber can disconnect itself while being called") {
+        int count = 0;
+        HookConnection conn;
+        conn = hook.connect([&](int, int*) {
+            count++;
+            conn.disconnect();
+        });
+
+        hook(1, nullptr);
+        hook(2, nullptr);
+        REQUIRE(count == 1);
+    }
+
+    SECTION("Replaced subscriber lists are reclaimed") {
+        for (int i = 0; i < 100; i++) {
+            auto conn = hook.connect([](int, int*) {});
+            conn.disconnect();
+        }
+        REQUIRE(hook.retired_count() == 0);
+
+        // 调用期间替换下来的列表要等调用结束以后才释放
+        size_t retired_during_call = 0;
+        HookConnection conn;
+        conn = hook.connect([&](int, int*) {
+            conn.disconnect();
+            retired_during_call = hook.retired_count();
+        });
+        hook(1, nullptr);
+        REQUIRE(retired_during_call > 0);
+
+        auto other = hook.connect([](int, int*) {});
+        other.disconnect();
+        REQUIRE(hook.retired_count() == 0);
+    }
+
+    SECTION("Subscribing while other threads invoke the hook") {
+        std::atomic<bool> running = true;
+        std::atomic<int> total = 0;
+        std::vector<std::thread> callers;
+        for (int t = 0; t < 4; t++) {
+            callers.emplace_back([&] {
+                int local = 0;
+                while (running.load()) {
+                    hook(1, &local);
+                }
+                total += local;
+            });
+        }
+
+        for (int i = 0; i < 100; i++) {
+            auto conn = hook.connect([](int v, int* acc) { *acc += v; });
+            conn.disconnect();
+        }
+        auto conn = hook.connect([](int v, int* acc) { *acc += v; });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        running = false;
+        for (auto& t : callers) {
+            t.join();
+        }
+        REQUIRE(total.load() > 0);
+    }
+}
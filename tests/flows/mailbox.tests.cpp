@@ -0,0 +1,155 @@
+#include <edgelink/edgelink.hpp>
+
+using namespace edgelink;
+
+namespace {
+
+Envelope make_envelope(int payload) {
+    auto msg = std::make_shared<Msg>();
+    msg->set_payload(JsonValue(payload));
+    return Envelope(msg, false, nullptr, nullptr, nullptr);
+}
+
+int payload_of(const Envelope& envelope) { return envelope.msg->payload().to_number<int>(); }
+
+}; // namespace
+
+TEST_CASE("Test bounded MPMC queue") {
+    BoundedMpmcQueue<int> queue(3);
+    REQUIRE(queue.capacity() == 4);
+
+    for (int i = 0; i < 4; i++) {
+        int value = i;
+        REQUIRE(queue.try_push(value));
+    }
+    int extra = 99;
+    REQUIRE_FALSE(queue.try_push(extra));
+    REQUIRE(queue.size_approx() == 4);
+
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(queue.try_pop() == i);
+    }
+    REQUIRE_FALSE(queue.try_pop());
+}
+
+TEST_CASE("Test node mailbox") {
+    boost::asio::io_context io;
+
+    SECTION("Overflow policy can be parsed") {
+        REQUIRE(parse_overflow_policy("block") == OverflowPolicy::BLOCK);
+        REQUIRE(parse_overflow_policy("drop-oldest") == OverflowPolicy::DROP_OLDEST);
+        REQUIRE(parse_overflow_policy("drop-newest") == OverflowPolicy::DROP_NEWEST);
+        REQUIRE_THROWS_AS(parse_overflow_policy("whatever"), InvalidDataException);
+    }
+
+    SECTION("drop-newest keeps the first messages") {
+        Mailbox mailbox({.capacity = 2, .overflow = OverflowPolicy::DROP_NEWEST});
+        std::vector<int> received;
+        auto run = [&]() -> Awaitable<void> {
+            for (int i = 0; i < 5; i++) {
+                co_await mailbox.async_push(make_envelope(i));
+            }
+            mailbox.close();
+            while (auto e = co_await mailbox.async_pop()) {
+                received.push_back(payload_of(*e));
+            }
+        };
+        boost::asio::co_spawn(io, run(), boost::asio::detached);
+        io.run();
+
+        REQUIRE(received == std::vector<int>{0, 1});
+        REQUIRE(mailbox.dropped_count() == 3);
+    }
+
+    SECTION("drop-oldest keeps the latest messages") {
+        Mailbox mailbox({.capacity = 2, .overflow = OverflowPolicy::DROP_OLDEST});
+        std::vector<int> received;
+        auto run = [&]() -> Awaitable<void> {
+            for (int i = 0; i < 5; i++) {
+                co_await mailbox.async_push(make_envelope(i));
+            }
+            mailbox.close();
+            while (auto e = co_await mailbox.async_pop()) {
+                received.push_back(payload_of(*e));
+            }
+        };
+        boost::asio::co_spawn(io, run(), boost::asio::detached);
+        io.run();
+
+        REQUIRE(received == std::vector<int>{3, 4});
+        REQUIRE(mailbox.dropped_count() == 3);
+    }
+
+    SECTION("block suspends the sender until there is room") {
+        Mailbox mailbox({.capacity = 2, .overflow = OverflowPolicy::BLOCK});
+        size_t max_depth = 0;
+        std::vector<int> received;
+
+        auto produce = [&]() -> Awaitable<void> {
+            for (int i = 0; i < 100; i++) {
+                co_await mailbox.async_push(make_envelope(i));
+                max_depth = std::max(max_depth, mailbox.depth());
+            }
+            mailbox.close();
+        };
+        auto consume = [&]() -> Awaitable<void> {
+            while (auto e = co_await mailbox.async_pop()) {
+                received.push_back(payload_of(*e));
+            }
+        };
+        boost::asio::co_spawn(io, produce(), boost::asio::detached);
+        boost::asio::co_spawn(io, consume(), boost::asio::detached);
+        io.run();
+
+        REQUIRE(received.size() == 100);
+        REQUIRE(std::is_sorted(received.begin(), received.end()));
+        REQUIRE(max_depth <= mailbox.capacity());
+        REQUIRE(mailbox.dropped_count() == 0);
+    }
+
+    SECTION("try_push never suspends, even with the block policy") {
+        Mailbox mailbox({.capacity = 2, .overflow = OverflowPolicy::BLOCK});
+        for (int i = 0; i < 5; i++) {
+            mailbox.try_push(make_envelope(i));
+        }
+        REQUIRE(mailbox.depth() == 2);
+        REQUIRE(mailbox.dropped_count() == 3);
+
+        mailbox.close();
+        REQUIRE_FALSE(mailbox.try_push(make_envelope(5)));
+        REQUIRE(mailbox.dropped_count() == 3);
+    }
+
+    SECTION("Many producers on many threads lose nothing") {
+        Mailbox mailbox({.capacity = 8, .overflow = OverflowPolicy::BLOCK});
+        std::atomic<int> received = 0;
+        std::atomic<int> producers_left = 4;
+
+        auto produce = [&]() -> Awaitable<void> {
+            for (int i = 0; i < 500; i++) {
+                co_await mailbox.async_push(make_envelope(i));
+            }
+            if (--producers_left == 0) {
+                mailbox.close();
+            }
+        };
+        auto consume = [&]() -> Awaitable<void> {
+            while (auto e = co_await mailbox.async_pop()) {
+                received++;
+            }
+        };
+        for (int i = 0; i < 4; i++) {
+            boost::asio::co_spawn(io, produce(), boost::asio::detached);
+        }
+        boost::asio::co_spawn(boost::asio::make_strand(io), consume(), boost::asio::detached);
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; i++) {
+            threads.emplace_back([&io] { io.run(); });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        REQUIRE(received == 2000);
+    }
+}
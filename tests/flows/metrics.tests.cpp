@@ -0,0 +1,151 @@
+#include <edgelink/edgelink.hpp>
+
+using namespace edgelink;
+
+TEST_CASE("Test latency histogram") {
+
+    SECTION("Buckets are contiguous and cover their values") {
+        REQUIRE(LatencyHistogram::bucket_index(0) == 0);
+        REQUIRE(LatencyHistogram::bucket_index(7) == 7);
+        REQUIRE(LatencyHistogram::bucket_index(8) == 8);
+        REQUIRE(LatencyHistogram::bucket_index(15) == 15);
+        REQUIRE(LatencyHistogram::bucket_index(16) == 16);
+        REQUIRE(LatencyHistogram::bucket_index(17) == 16);
+
+        for (uint64_t v : {1ULL, 9ULL, 100ULL, 1234ULL, 999'999ULL, 123'456'789ULL}) {
+            auto index = LatencyHistogram::bucket_index(v);
+            REQUIRE(LatencyHistogram::bucket_lower_bound(index) <= v);
+            REQUIRE(LatencyHistogram::bucket_upper_bound(index) >= v);
+        }
+
+        REQUIRE(LatencyHistogram::bucket_index(UINT64_MAX) == LatencyHistogram::BUCKET_COUNT - 1);
+    }
+
+    SECTION("Percentiles stay within the bucket precision") {
+        LatencyHistogram histogram;
+        REQUIRE(histogram.percentile(0.5) == 0);
+
+        for (uint64_t i = 1; i <= 1000; i++) {
+            histogram.record(i * 1000);
+        }
+        REQUIRE(histogram.count() == 1000);
+        REQUIRE(histogram.max() == 1'000'000);
+        REQUIRE(histogram.mean() == 500'500.0);
+
+        auto p50 = histogram.percentile(0.50);
+        REQUIRE(p50 >= 500'000);
+        REQUIRE(p50 <= 500'000 * 9 / 8);
+
+        auto p99 = histogram.percentile(0.99);
+        REQUIRE(p99 >= 990'000);
+        REQUIRE(p99 <= 1'000'000);
+        REQUIRE(histogram.percentile(1.0) == 1'000'000);
+    }
+
+    SECTION("Merged histograms add up") {
+        LatencyHistogram a;
+        LatencyHistogram b;
+        for (uint64_t i = 1; i <= 500; i++) {
+            a.record(i * 1000);
+            b.record((i + 500) * 1000);
+        }
+
+        LatencyHistogram merged;
+        merged.merge(a);
+        merged.merge(b);
+        REQUIRE(merged.count() == 1000);
+        REQUIRE(merged.max() == 1'000'000);
+        REQUIRE(merged.mean() == 500'500.0);
+        REQUIRE(merged.percentile(0.50) >= 500'000);
+        REQUIRE(merged.percentile(0.50) <= 500'000 * 9 / 8);
+    }
+}
+
+TEST_CASE("Test node metrics") {
+
+    SECTION("Counters from many threads are summed") {
+        NodeMetrics metrics("node1", "function", "flow1");
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&metrics] {
+                for (int i = 0; i < 1000; i++) {
+                    metrics.add_in();
+                    metrics.add_out(2);
+                    metrics.record_latency(100);
+                }
+                metrics.add_error();
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        auto snap = metrics.snapshot();
+        REQUIRE(snap.node_id == "node1");
+        REQUIRE(snap.msgs_in == 4000);
+        REQUIRE(snap.msgs_out == 8000);
+        REQUIRE(snap.errors == 4);
+        REQUIRE(snap.dropped == 0);
+        REQUIRE(snap.latency_count == 4000);
+        REQUIRE(snap.latency_max_ns == 100);
+    }
+
+    SECTION("Queue depth and overflow drops are read from the mailbox") {
+        boost::asio::io_context io;
+        NodeMetrics metrics("node1", "function", "flow1");
+        Mailbox mailbox({.capacity = 2, .overflow = OverflowPolicy::DROP_NEWEST});
+        metrics.set_mailbox(&mailbox);
+
+        auto push_all = [&mailbox]() -> Awaitable<void> {
+            for (int i = 0; i < 3; i++) {
+                co_await mailbox.async_push(Envelope(std::make_shared<Msg>(), false, nullptr, nullptr, nullptr));
+            }
+        };
+        boost::asio::co_spawn(io, push_all(), boost::asio::detached);
+        io.run();
+
+        auto snap = metrics.snapshot();
+        REQUIRE(snap.queue_depth == 2);
+        REQUIRE(snap.dropped == 1);
+
+        metrics.set_mailbox(nullptr);
+        REQUIRE(metrics.snapshot().queue_depth == 0);
+    }
+}
+
+TEST_CASE("Test metrics registry") {
+    MetricsRegistry registry;
+
+    auto m1 = registry.get_or_create("b", "debug", "flow1");
+    auto m2 = registry.get_or_create("a", "inject", "flow1");
+    REQUIRE(registry.get_or_create("b", "debug", "flow1") == m1);
+
+    m1->add_in();
+    m2->add_out();
+
+    REQUIRE_FALSE(registry.query("nope"));
+    auto snap = registry.query("b");
+    REQUIRE(snap);
+    REQUIRE(snap->msgs_in == 1);
+
+    auto all = registry.query_all();
+    REQUIRE(all.size() == 2);
+    REQUIRE(all[0].node_id == "a");
+    REQUIRE(all[1].node_id == "b");
+
+    auto json = registry.to_json();
+    REQUIRE(json.size() == 2);
+    REQUIRE(json[0].at("type").as_string() == "inject");
+    REQUIRE(json[0].at("out").to_number<uint64_t>() == 1);
+    REQUIRE(json[1].at("latency").as_object().contains("p99_ns"));
+
+    // 同一个 ID 换成了新的指标对象以后，移除旧的对象不影响新的
+    registry.remove(*m1);
+    REQUIRE_FALSE(registry.query("b"));
+    auto m3 = registry.get_or_create("b", "debug", "flow2");
+    registry.remove(*m1);
+    REQUIRE(registry.query("b"));
+    registry.remove(*m3);
+    REQUIRE(registry.query_all().size() == 1);
+}
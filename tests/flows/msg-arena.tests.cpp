@@ -0,0 +1,65 @@
+#include <edgelink/edgelink.hpp>
+
+using namespace edgelink;
+
+TEST_CASE("Test Msg arena") {
+
+    constexpr char PAYLOAD_JSON[] = R"(
+        {
+            "hostInfo": {
+                "cpuLoad": 0.9,
+                "memoryUsage": 300,
+                "memoryTotal": 2048
+            },
+            "version": "0.1.0"
+        }
+    )";
+
+    auto pool = std::make_shared<MsgArenaPool>(4);
+    auto histogram = std::make_shared<MsgArenaHistogram>();
+
+    SECTION("Message properties are allocated in the arena") {
+        auto msg = std::make_shared<Msg>(pool->acquire(histogram), nullptr);
+        msg->set_payload(boost::json::parse(PAYLOAD_JSON, msg->storage()));
+        msg->insert_or_assign("qos", 1);
+
+        REQUIRE(std::as_const(*msg).payload().storage().get() == msg->storage().get());
+        REQUIRE(std::as_const(*msg).at("qos").storage().get() == msg->storage().get());
+        REQUIRE(std::as_const(*msg).at_propex("payload.hostInfo.memoryUsage") == 300);
+    }
+
+    SECTION("The arena is recycled after the last reference is released") {
+        {
+            auto msg = std::make_shared<Msg>(pool->acquire(histogram), nullptr);
+            msg->set_payload(boost::json::parse(PAYLOAD_JSON, msg->storage()));
+            REQUIRE(pool->pooled_count() == 0);
+        }
+        REQUIRE(pool->pooled_count() == 1);
+
+        auto msg = std::make_shared<Msg>(pool->acquire(histogram), nullptr);
+        REQUIRE(pool->pooled_count() == 0);
+    }
+
+    SECTION("Clones keep the arena alive and write to their own storage") {
+        auto msg1 = std::make_shared<Msg>(pool->acquire(histogram), nullptr);
+        msg1->set_payload(boost::json::parse(PAYLOAD_JSON, msg1->storage()));
+        auto msg2 = msg1->clone();
+        msg1.reset();
+        REQUIRE(pool->pooled_count() == 0);
+
+        msg2->at_propex("payload.hostInfo.memoryUsage") = 100;
+        REQUIRE(std::as_const(*msg2).payload().storage().get() == msg2->storage().get());
+        REQUIRE(std::as_const(*msg2).at_propex("payload.hostInfo.memoryUsage") == 100);
+
+        msg2.reset();
+        REQUIRE(pool->pooled_count() == 1);
+    }
+
+    SECTION("The histogram suggests a size that fits most messages") {
+        for (int i = 0; i < 128; i++) {
+            histogram->record(20000);
+        }
+        REQUIRE(histogram->suggest_size() >= 20000);
+        REQUIRE(histogram->suggest_size() < 20000 * 2);
+    }
+}
@@ -0,0 +1,76 @@
+#include <edgelink/edgelink.hpp>
+
+using namespace edgelink;
+
+namespace {
+
+class CollectNode : public FlowNode {
+  public:
+    CollectNode(const JsonObject& config) : FlowNode("n1", nullptr, nullptr, config) {}
+
+    Awaitable<void> async_start() override { co_return; }
+    Awaitable<void> async_stop() override { co_return; }
+
+    Awaitable<void> receive_async(MsgPtr msg) override {
+        received.push_back(msg);
+        co_return;
+    }
+
+    std::vector<MsgPtr> received;
+};
+
+}; // namespace
+
+TEST_CASE("Test columnar message batch") {
+
+    SECTION("Samples are stored by column with a topic dictionary") {
+        MsgBatch batch(1'700'000'000'000);
+        batch.push_back(1.5, "sensor/a");
+        batch.push_back(2.5, "sensor/b");
+        batch.push_back(3.5, "sensor/a");
+        batch.push_back(4.5);
+
+        REQUIRE(batch.size() == 4);
+        REQUIRE(batch.payloads()[2] == 3.5);
+        REQUIRE(batch.topic_dictionary().size() == 2);
+        REQUIRE(batch.topic_ids()[0] == batch.topic_ids()[2]);
+        REQUIRE(batch.topic_at(1) == "sensor/b");
+        REQUIRE_FALSE(batch.topic_at(3));
+        REQUIRE(batch.timestamp_at(3) == 1'700'000'000'000);
+    }
+
+    SECTION("Time offsets are only stored once one is non-zero") {
+        MsgBatch batch(1000);
+        batch.push_back(1.0);
+        batch.push_back(2.0, std::nullopt, 10);
+        REQUIRE(batch.timestamp_at(0) == 1000);
+        REQUIRE(batch.timestamp_at(1) == 1010);
+        REQUIRE(batch.to_json().contains("timeOffset"));
+    }
+
+    SECTION("A sample can be unrolled into a message") {
+        MsgBatch batch(1000);
+        batch.push_back(42.0, "t");
+        auto msg = batch.to_msg(0);
+        REQUIRE(msg->payload().to_number<double>() == 42.0);
+        REQUIRE(msg->topic() == "t");
+        REQUIRE(msg->at("timestamp").to_number<int64_t>() == 1000);
+    }
+
+    SECTION("Nodes without batch support receive the samples one by one") {
+        const JsonObject config{{"type", "test"}, {"name", "Test"}, {"wires", JsonArray{}}};
+        CollectNode node(config);
+
+        auto batch = std::make_shared<MsgBatch>();
+        for (int i = 0; i < 5; i++) {
+            batch->push_back(i, "t");
+        }
+
+        boost::asio::io_context io;
+        boost::asio::co_spawn(io, node.receive_batch_async(batch), boost::asio::detached);
+        io.run();
+
+        REQUIRE(node.received.size() == 5);
+        REQUIRE(node.received[4]->payload().to_number<double>() == 4.0);
+    }
+}
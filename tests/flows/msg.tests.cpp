@@ -26,4 +26,71 @@ TEST_CASE("Test Msg class") {
         msg1.at_propex("payload.hostInfo.memoryUsage") = 100;
         REQUIRE(msg1.at_propex("payload.hostInfo.memoryUsage") == 100);
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Test Msg copy-on-write") {
+
+    constexpr char MSG_JSON[] = R"(
+        {
+            "_msgid": 1,
+            "topic": "/test/test1",
+            "payload": {
+                "hostInfo": {
+                    "cpuLoad": 0.9,
+                    "memoryUsage": 300
+                }
+            }
+        }
+    )";
+
+    auto msg1 = std::make_shared<Msg>(boost::json::parse(MSG_JSON).as_object());
+
+    SECTION("Cloned message shares the properties until written") {
+        auto msg2 = msg1->clone(false);
+        REQUIRE(&std::as_const(*msg1).at("payload") == &std::as_const(*msg2).at("payload"));
+
+        msg2->at_propex("payload.hostInfo.memoryUsage") = 100;
+
+        REQUIRE(std::as_const(*msg1).at_propex("payload.hostInfo.memoryUsage") == 300);
+        REQUIRE(std::as_const(*msg2).at_propex("payload.hostInfo.memoryUsage") == 100);
+        // 没有写过的属性仍然共享
+        REQUIRE(&std::as_const(*msg1).at("topic") == &std::as_const(*msg2).at("topic"));
+    }
+
+    SECTION("Clone with a new id does not affect the original") {
+        auto msg2 = msg1->clone();
+        REQUIRE(msg1->id() == 1);
+        REQUIRE(msg2->id() != msg1->id());
+        REQUIRE(msg2->to_json().at("topic") == "/test/test1");
+    }
+}
+
+TEST_CASE("Test Msg typed fields") {
+
+    SECTION("Typed fields are serialized as normal JSON properties") {
+        auto msg = Msg(42);
+        msg.set_topic("/test/topic");
+        msg.set_payload(JsonValue(3.5));
+        msg.insert_or_assign("qos", 1);
+
+        REQUIRE(msg.id() == 42);
+        REQUIRE(msg.topic() == "/test/topic");
+
+        auto json = boost::json::parse(msg.to_string()).as_object();
+        REQUIRE(json.at("_msgid") == 42);
+        REQUIRE(json.at("topic") == "/test/topic");
+        REQUIRE(json.at("payload") == 3.5);
+        REQUIRE(json.at("qos") == 1);
+        REQUIRE(msg.to_json() == json);
+    }
+
+    SECTION("Buffer payload is shared without copying") {
+        auto msg1 = std::make_shared<Msg>();
+        msg1->set_payload(MsgBuffer(Bytes{1, 2, 3}));
+        auto msg2 = msg1->clone();
+
+        REQUIRE(msg1->payload_buffer()->data() == msg2->payload_buffer()->data());
+        REQUIRE(std::as_const(*msg2).at_propex("payload[2]") == 3);
+        REQUIRE(boost::json::parse(msg2->to_string()).at("payload") == boost::json::parse("[1,2,3]"));
+    }
+}
@@ -0,0 +1,120 @@
+#include <edgelink/edgelink.hpp>
+
+#include "../../../src/flows/nodes/function/quickjs-bridge.hpp"
+
+using namespace edgelink;
+
+namespace {
+
+struct JsFixture {
+    JsFixture() : rt(JS_NewRuntime()), ctx(JS_NewContext(rt)) {}
+    ~JsFixture() {
+        JS_FreeContext(ctx);
+        JS_FreeRuntime(rt);
+    }
+
+    /// @brief 定义并调用 `function (msg) { <body> }`
+    JSValue call(const char* body, JSValueConst arg) {
+        auto code = fmt::format("(function (msg) {{ {0} }})", body);
+        JSValue func = JS_Eval(ctx, code.c_str(), code.size(), "<test>", JS_EVAL_TYPE_GLOBAL);
+        REQUIRE_FALSE(JS_IsException(func));
+        JSValue result = JS_Call(ctx, func, JS_UNDEFINED, 1, &arg);
+        JS_FreeValue(ctx, func);
+        REQUIRE_FALSE(JS_IsException(result));
+        return result;
+    }
+
+    JSRuntime* rt;
+    JSContext* ctx;
+};
+
+}; // namespace
+
+TEST_CASE("Test QuickJS bridge") {
+
+    constexpr char MSG_JSON[] = R"(
+        {
+            "_msgid": 7,
+            "topic": "/test/test1",
+            "payload": {
+                "hostInfo": { "cpuLoad": 0.9, "memoryUsage": 300 },
+                "values": [1, 2.5, "three", null, true],
+                "version": "0.1.0"
+            },
+            "extra": { "a": { "b": 1 } }
+        }
+    )";
+
+    JsFixture js;
+    auto msg = Msg(boost::json::parse(MSG_JSON).as_object());
+
+    SECTION("JSON values survive a round trip") {
+        auto source = boost::json::parse(MSG_JSON);
+        JSValue value = js::to_js(js.ctx, source);
+        REQUIRE(js::from_js(js.ctx, value) == source);
+        JS_FreeValue(js.ctx, value);
+    }
+
+    SECTION("Conversion back follows JSON.stringify rules") {
+        JSValue result = js.call("return { a: undefined, f: function() {}, n: NaN, arr: [undefined], i: 3.0, "
+                                 "d: new Date(0) };",
+                                 JS_UNDEFINED);
+        auto json = js::from_js(js.ctx, result);
+        JS_FreeValue(js.ctx, result);
+        REQUIRE(json == boost::json::parse(R"({"n":null,"arr":[null],"i":3,"d":"1970-01-01T00:00:00.000Z"})"));
+        REQUIRE(json.at("i").is_int64());
+    }
+
+    for (auto mode : {js::BridgeMode::NATIVE, js::BridgeMode::LAZY}) {
+        DYNAMIC_SECTION("Scripts can read and modify messages, mode " << static_cast<int>(mode)) {
+            js::MsgBridge bridge(js.ctx, mode);
+            JSValue js_msg = bridge.wrap(msg);
+            JSValue result = js.call("msg.payload.hostInfo.memoryUsage += msg.payload.values[1] * 2;"
+                                     "msg.topic = msg.topic + '/out';"
+                                     "delete msg.payload.version;"
+                                     "return msg;",
+                                     js_msg);
+            JS_FreeValue(js.ctx, js_msg);
+
+            auto json = bridge.unwrap(result, {});
+            JS_FreeValue(js.ctx, result);
+
+            auto expected = msg.to_json();
+            expected.at("topic") = "/test/test1/out";
+            expected.at("payload").at("hostInfo").at("memoryUsage") = 305;
+            expected.at("payload").as_object().erase("version");
+            REQUIRE(json == expected);
+        }
+    }
+
+    SECTION("Untouched lazy properties are copied without materializing") {
+        js::MsgBridge bridge(js.ctx, js::BridgeMode::LAZY);
+        JSValue js_msg = bridge.wrap(msg);
+        JSValue result = js.call("const desc = Object.getOwnPropertyDescriptor(msg, 'extra');"
+                                 "msg.touched = typeof desc.get === 'function';"
+                                 "return msg;",
+                                 js_msg);
+        JS_FreeValue(js.ctx, js_msg);
+
+        auto json = bridge.unwrap(result, {});
+        JS_FreeValue(js.ctx, result);
+
+        REQUIRE(json.at("touched") == true);
+        REQUIRE(json.at("extra") == msg.to_json().at("extra"));
+    }
+
+    SECTION("Lazy objects kept by the script are invalidated after the call") {
+        JSValue saved;
+        {
+            js::MsgBridge bridge(js.ctx, js::BridgeMode::LAZY);
+            JSValue js_msg = bridge.wrap(msg);
+            saved = js.call("return msg;", js_msg);
+            JS_FreeValue(js.ctx, js_msg);
+        }
+
+        JSValue payload = JS_GetPropertyStr(js.ctx, saved, "payload");
+        REQUIRE(JS_IsException(payload));
+        JS_FreeValue(js.ctx, JS_GetException(js.ctx));
+        JS_FreeValue(js.ctx, saved);
+    }
+}
@@ -0,0 +1,77 @@
+#include <edgelink/edgelink.hpp>
+
+#include "../../../src/flows/nodes/function/quickjs-runtime-pool.hpp"
+
+using namespace edgelink;
+
+TEST_CASE("Test QuickJS bytecode cache and runtime pool") {
+
+    const std::string SOURCE = "globalThis.answer = 6 * 7;";
+
+    auto cache_dir = std::filesystem::temp_directory_path() / "edgelink-tests-qjsbc";
+    std::filesystem::remove_all(cache_dir);
+
+    qjs::Runtime runtime;
+    qjs::Context context(runtime);
+    auto ctx = context.ctx;
+
+    SECTION("Compiled bytecode can be evaluated") {
+        js::BytecodeCache cache(cache_dir);
+        auto bytecode = cache.get_or_compile(ctx, SOURCE, "<test>");
+        REQUIRE(bytecode == cache.get_or_compile(ctx, SOURCE, "<test>"));
+
+        js::eval_bytecode(ctx, *bytecode);
+        REQUIRE(static_cast<int>(context.eval("answer")) == 42);
+    }
+
+    SECTION("Bytecode is loaded from the disk cache") {
+        auto bytecode = js::BytecodeCache(cache_dir).get_or_compile(ctx, SOURCE, "<test>");
+        auto path = cache_dir / fmt::format("{0:016x}.qjsbc", js::BytecodeCache::hash_source(SOURCE));
+        REQUIRE(std::filesystem::exists(path));
+
+        auto loaded = js::BytecodeCache(cache_dir).get_or_compile(ctx, SOURCE, "<test>");
+        REQUIRE(*loaded == *bytecode);
+    }
+
+    SECTION("Corrupted cache files are ignored") {
+        auto bytecode = js::BytecodeCache(cache_dir).get_or_compile(ctx, SOURCE, "<test>");
+        auto path = cache_dir / fmt::format("{0:016x}.qjsbc", js::BytecodeCache::hash_source(SOURCE));
+        {
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(-1, std::ios::end);
+            file.put('\xFF');
+        }
+
+        auto recompiled = js::BytecodeCache(cache_dir).get_or_compile(ctx, SOURCE, "<test>");
+        REQUIRE(*recompiled == *bytecode);
+    }
+
+    SECTION("Cache files whose header size does not match are ignored") {
+        auto bytecode = js::BytecodeCache(cache_dir).get_or_compile(ctx, SOURCE, "<test>");
+        auto path = cache_dir / fmt::format("{0:016x}.qjsbc", js::BytecodeCache::hash_source(SOURCE));
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+        REQUIRE(*js::BytecodeCache(cache_dir).get_or_compile(ctx, SOURCE, "<test>") == *bytecode);
+
+        // 文件头里的大小字段在魔数和哈希之后
+        {
+            const uint64_t huge = uint64_t(1) << 60;
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(16);
+            file.write(reinterpret_cast<const char*>(&huge), sizeof(huge));
+        }
+        REQUIRE(*js::BytecodeCache(cache_dir).get_or_compile(ctx, SOURCE, "<test>") == *bytecode);
+    }
+
+    SECTION("Runtime pool is bounded and balances contexts") {
+        js::RuntimePool pool(2, {});
+        auto a = pool.acquire();
+        auto b = pool.acquire();
+        auto c = pool.acquire();
+        REQUIRE(pool.runtime_count() == 2);
+        REQUIRE(&**a != &**b);
+        REQUIRE((&**c == &**a || &**c == &**b));
+        REQUIRE((*a)->context_count() + (*b)->context_count() == 3);
+    }
+
+    std::filesystem::remove_all(cache_dir);
+}
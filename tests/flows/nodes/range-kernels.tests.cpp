@@ -0,0 +1,83 @@
+#include <edgelink/edgelink.hpp>
+
+#include "../../../src/flows/nodes/function/range-kernels.hpp"
+
+using namespace edgelink;
+using namespace edgelink::kernels;
+
+namespace {
+
+bool same_value(double a, double b) {
+    if (std::isnan(a) || std::isnan(b)) {
+        return std::isnan(a) && std::isnan(b);
+    }
+    // aarch64 上标量代码可能被编译器合并成乘加指令，允许最后一位的差别
+    return std::abs(a - b) <= 1e-12 * std::max(1.0, std::abs(b));
+}
+
+}; // namespace
+
+TEST_CASE("Test range node kernels") {
+
+    SECTION("Actions can be parsed") {
+        REQUIRE(parse_range_action("scale") == RangeAction::SCALE);
+        REQUIRE(parse_range_action("clamp") == RangeAction::CLAMP);
+        REQUIRE(parse_range_action("roll") == RangeAction::ROLL);
+        REQUIRE(parse_range_action("drop") == RangeAction::SCALE);
+    }
+
+    SECTION("Single values are mapped like the range node") {
+        RangeParams p{.minin = 0, .maxin = 10, .minout = 0, .maxout = 100, .action = RangeAction::SCALE};
+        REQUIRE(range_map_one(5, p) == 50);
+        REQUIRE(range_map_one(20, p) == 200);
+
+        p.action = RangeAction::CLAMP;
+        REQUIRE(range_map_one(20, p) == 100);
+        REQUIRE(range_map_one(-3, p) == 0);
+
+        p.action = RangeAction::ROLL;
+        REQUIRE(range_map_one(12, p) == 20);
+
+        p.action = RangeAction::SCALE;
+        p.maxout = 1;
+        p.round = true;
+        REQUIRE(range_map_one(5, p) == 1);
+        REQUIRE(range_map_one(-5, p) == -1);
+        REQUIRE(range_map_one(4, p) == 0);
+    }
+
+    SECTION("The vectorized kernel matches the scalar one") {
+        std::mt19937_64 rng(42);
+        std::uniform_real_distribution<double> dist(-500, 500);
+
+        for (auto action : {RangeAction::SCALE, RangeAction::CLAMP, RangeAction::ROLL}) {
+            for (bool round : {false, true}) {
+                RangeParams p{
+                    .minin = -100, .maxin = 100, .minout = 0, .maxout = 1000, .action = action, .round = round};
+
+                // 长度不是向量宽度的整数倍，尾部也要覆盖到
+                std::vector<double> values(1027);
+                for (auto& v : values) {
+                    v = dist(rng);
+                }
+                values[3] = NAN;
+                values[4] = -100.05;
+                values[5] = -0.0;
+
+                auto expected = values;
+                range_map_scalar(expected, p);
+                range_map(values, p);
+
+                for (size_t i = 0; i < values.size(); i++) {
+                    INFO("action=" << static_cast<int>(action) << " round=" << round << " i=" << i);
+                    REQUIRE(same_value(values[i], expected[i]));
+                }
+            }
+        }
+    }
+
+    SECTION("A kernel is always selected") {
+        auto name = range_kernel_name();
+        REQUIRE((name == "avx2" || name == "neon" || name == "scalar"));
+    }
+}
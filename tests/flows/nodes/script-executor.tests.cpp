@@ -0,0 +1,178 @@
+#include <edgelink/edgelink.hpp>
+
+#include "../../../src/flows/nodes/function/script-executor.hpp"
+
+using namespace edgelink;
+
+namespace {
+
+/// @brief 每个工作者里都有一个全局计数器，用来区分工作者
+void setup_counter(js::ScriptWorker& worker) {
+    worker.context().eval("globalThis.counter = 0;");
+}
+
+int eval_int(js::ScriptWorker& worker, const char* code) { return static_cast<int>(worker.context().eval(code)); }
+
+/// @brief 在 `io` 上执行 `async_run_all()`，直到完成
+template <typename TFunc> void run_all(boost::asio::io_context& io, js::ScriptExecutor& executor, TFunc func) {
+    auto done = boost::asio::co_spawn(io, executor.async_run_all(std::move(func)), boost::asio::use_future);
+    io.restart();
+    io.run();
+    done.get();
+}
+
+}; // namespace
+
+TEST_CASE("Test function node script executor") {
+
+    js::RuntimePool pool(2, {});
+
+    SECTION("Exec mode can be parsed") {
+        REQUIRE(js::parse_exec_mode("serialized") == js::ExecMode::SERIALIZED);
+        REQUIRE(js::parse_exec_mode("parallel") == js::ExecMode::PARALLEL);
+        REQUIRE(js::parse_exec_mode("keyed") == js::ExecMode::KEYED);
+        REQUIRE_THROWS_AS(js::parse_exec_mode("whatever"), InvalidDataException);
+    }
+
+    SECTION("Serialized mode always uses one worker") {
+        js::ScriptExecutor executor(js::ExecMode::SERIALIZED, 8, pool, setup_counter);
+        REQUIRE(executor.worker_count() == 1);
+    }
+
+    SECTION("Every worker is set up and has its own global state") {
+        js::ScriptExecutor executor(js::ExecMode::PARALLEL, 3, pool, setup_counter);
+        REQUIRE(executor.worker_count() == 3);
+
+        // 多个工作者使用独占的运行时，不会占用共享池
+        REQUIRE(pool.runtime_count() == 0);
+
+        boost::asio::io_context io;
+        run_all(io, executor, [](js::ScriptWorker& worker) { eval_int(worker, "++counter"); });
+        run_all(io, executor, [](js::ScriptWorker& worker) { REQUIRE(eval_int(worker, "counter") == 1); });
+    }
+
+    SECTION("Executors sharing a runtime run their scripts one at a time") {
+        js::RuntimePool shared_pool(1, {});
+        js::ScriptExecutor first(js::ExecMode::SERIALIZED, 1, shared_pool, setup_counter);
+        js::ScriptExecutor second(js::ExecMode::SERIALIZED, 1, shared_pool, setup_counter);
+        REQUIRE(shared_pool.runtime_count() == 1);
+
+        boost::asio::io_context io(4);
+        first.bind_executor(io.get_executor());
+        second.bind_executor(io.get_executor());
+
+        std::atomic<int> running = 0;
+        std::atomic<int> max_running = 0;
+        auto run_one = [&](js::ScriptExecutor& executor) -> Awaitable<void> {
+            co_await executor.async_run(0, [&](js::ScriptWorker& worker) {
+                auto now = ++running;
+                max_running = std::max(max_running.load(), now);
+                auto result = eval_int(worker, "++counter");
+                running--;
+                return result;
+            });
+        };
+        for (int i = 0; i < 50; i++) {
+            boost::asio::co_spawn(io, run_one(first), boost::asio::detached);
+            boost::asio::co_spawn(io, run_one(second), boost::asio::detached);
+        }
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; i++) {
+            threads.emplace_back([&io] { io.run(); });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        REQUIRE(max_running == 1);
+        int total = 0;
+        run_all(io, first, [&](js::ScriptWorker& worker) { total += eval_int(worker, "counter"); });
+        run_all(io, second, [&](js::ScriptWorker& worker) { total += eval_int(worker, "counter"); });
+        REQUIRE(total == 100);
+    }
+
+    SECTION("Keyed mode sends the same key to the same worker") {
+        js::ScriptExecutor executor(js::ExecMode::KEYED, 4, pool, setup_counter);
+
+        boost::asio::io_context io(4);
+        executor.bind_executor(io.get_executor());
+
+        std::vector<int> counts;
+        auto run = [&]() -> Awaitable<void> {
+            for (int i = 0; i < 10; i++) {
+                counts.push_back(co_await executor.async_run(
+                    42, [](js::ScriptWorker& worker) { return eval_int(worker, "++counter"); }));
+            }
+        };
+        boost::asio::co_spawn(io, run(), boost::asio::detached);
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; i++) {
+            threads.emplace_back([&io] { io.run(); });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        REQUIRE(counts == std::vector<int>{1, 2, 3, 4, 5, 6, 7, 8, 9, 10});
+    }
+
+    SECTION("The caller resumes on its own executor after the script has run") {
+        js::ScriptExecutor executor(js::ExecMode::KEYED, 2, pool, setup_counter);
+
+        boost::asio::io_context io(2);
+        executor.bind_executor(io.get_executor());
+        auto caller = boost::asio::make_strand(io);
+
+        std::atomic<int> resumed_on_caller = 0;
+        auto run = [&]() -> Awaitable<void> {
+            for (int i = 0; i < 10; i++) {
+                co_await executor.async_run(i, [](js::ScriptWorker& worker) { return eval_int(worker, "++counter"); });
+                if (caller.running_in_this_thread()) {
+                    resumed_on_caller++;
+                }
+            }
+        };
+        boost::asio::co_spawn(caller, run(), boost::asio::detached);
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 2; i++) {
+            threads.emplace_back([&io] { io.run(); });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        REQUIRE(resumed_on_caller == 10);
+    }
+
+    SECTION("Parallel mode spreads messages across workers") {
+        js::ScriptExecutor executor(js::ExecMode::PARALLEL, 4, pool, setup_counter);
+
+        boost::asio::io_context io(4);
+        executor.bind_executor(io.get_executor());
+
+        std::atomic<int> done = 0;
+        auto run_one = [&]() -> Awaitable<void> {
+            co_await executor.async_run(0, [](js::ScriptWorker& worker) { return eval_int(worker, "++counter"); });
+            done++;
+        };
+        for (int i = 0; i < 100; i++) {
+            boost::asio::co_spawn(io, run_one(), boost::asio::detached);
+        }
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; i++) {
+            threads.emplace_back([&io] { io.run(); });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        REQUIRE(done == 100);
+        int total = 0;
+        run_all(io, executor, [&](js::ScriptWorker& worker) { total += eval_int(worker, "counter"); });
+        REQUIRE(total == 100);
+    }
+}
@@ -31,4 +31,31 @@ TEST_CASE("Test Property Expression") {
         };
         REQUIRE(result == expected);
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Test compiled Property Expression") {
+
+    SECTION("Compiled path owns its segments") {
+        auto path = pe::PropertyPath(std::string("test1[100] . hello['aaa']"));
+        REQUIRE(path.size() == 4);
+        REQUIRE(path.root() == "test1");
+        REQUIRE(std::get<size_t>(path[1]) == 100);
+        REQUIRE(std::get<std::string>(path[3]) == "aaa");
+    }
+
+    SECTION("Interned paths are shared") {
+        auto p1 = pe::intern("payload.value");
+        auto p2 = pe::intern("payload.value");
+        REQUIRE(p1.get() == p2.get());
+    }
+
+    SECTION("Can read and write a message through a compiled path") {
+        auto msg = Msg();
+        auto path = pe::PropertyPath("payload.values[1].x");
+        msg.set_propex(path, 42);
+        REQUIRE(std::as_const(msg).at_propex(path) == 42);
+        REQUIRE(msg.payload().at("values").as_array().size() == 2);
+    }
+
+    SECTION("Path must start with an identifier") { REQUIRE_THROWS(pe::PropertyPath("[1].x")); }
+}
@@ -0,0 +1,200 @@
+#include <edgelink/edgelink.hpp>
+
+#include "../../src/flows/engine.hpp"
+#include "../../src/flows/flow.hpp"
+#include "../../src/flows/flow-factory.hpp"
+#include "../../src/flows/registry.hpp"
+
+using namespace edgelink;
+
+TEST_CASE("Test flow routing table") {
+    const EdgeLinkSettings settings{
+        .home_path = std::filesystem::temp_directory_path(),
+        .executable_location = std::filesystem::temp_directory_path(),
+        .flows_json_path = "",
+    };
+    Registry registry(settings);
+    flows::FlowFactory flow_factory(registry);
+    Engine engine(settings, flow_factory);
+
+    SECTION("Wires are compiled into per-port routes") {
+        auto flows_config = boost::json::parse(R"(
+            [
+                { "id": "f1", "type": "tab", "label": "Flow 1", "disabled": false },
+                { "id": "j1", "type": "junction", "z": "f1", "name": "", "wires": [["j2", "b1"]] },
+                { "id": "j2", "type": "junction", "z": "f1", "name": "", "wires": [["b1"]] },
+                { "id": "b1", "type": "blackhole", "z": "f1", "name": "", "wires": [] }
+            ]
+        )")
+                                .as_array();
+
+        auto flows = flow_factory.create_flows(flows_config, &engine);
+        REQUIRE(flows.size() == 1);
+        auto const& table = static_cast<flows::Flow*>(flows[0].get())->routing_table();
+        REQUIRE(table.route_count() == 3);
+
+        auto j1 = flows[0]->get_node("j1");
+        auto ports = table.ports_of(j1);
+        REQUIRE(ports.size() == 1);
+        REQUIRE(ports[0].port == &j1->output_ports()[0]);
+
+        auto dests = table.destinations(ports[0]);
+        REQUIRE(dests.size() == 2);
+        REQUIRE(dests[0].node == flows[0]->get_node("j2"));
+        REQUIRE(dests[1].node == flows[0]->get_node("b1"));
+
+        // 每个目标节点一个邮箱，源节点没有邮箱
+        auto flow = static_cast<flows::Flow*>(flows[0].get());
+        REQUIRE(dests[1].mailbox == flow->mailbox_of(flows[0]->get_node("b1")));
+        REQUIRE(dests[0].mailbox != dests[1].mailbox);
+        REQUIRE(flow->mailbox_of(j1) == nullptr);
+
+        REQUIRE(table.ports_of(flows[0]->get_node("b1")).empty());
+
+        // b1 有两条输入连线，不能同步投递
+        REQUIRE_FALSE(ports[0].exclusive);
+        REQUIRE_FALSE(table.ports_of(flows[0]->get_node("j2"))[0].exclusive);
+    }
+
+    SECTION("Single wires into single-input nodes are exclusive") {
+        auto flows_config = boost::json::parse(R"(
+            [
+                { "id": "f1", "type": "tab", "label": "Flow 1", "disabled": false, "syncDelivery": true },
+                { "id": "j1", "type": "junction", "z": "f1", "name": "", "wires": [["b1"]] },
+                { "id": "b1", "type": "blackhole", "z": "f1", "name": "", "wires": [] }
+            ]
+        )")
+                                .as_array();
+
+        auto flows = flow_factory.create_flows(flows_config, &engine);
+        auto flow = static_cast<flows::Flow*>(flows[0].get());
+        REQUIRE(flow->is_sync_delivery());
+        REQUIRE(flow->routing_table().ports_of(flow->get_node("j1"))[0].exclusive);
+    }
+
+    SECTION("Sync routes chain nodes onto the head's strand") {
+        auto flows_config = boost::json::parse(R"(
+            [
+                { "id": "f1", "type": "tab", "label": "Flow 1", "disabled": false, "syncDelivery": true },
+                { "id": "j1", "type": "junction", "z": "f1", "name": "", "wires": [["j2"]] },
+                { "id": "j2", "type": "junction", "z": "f1", "name": "", "wires": [["b1", "b2"]] },
+                { "id": "b1", "type": "blackhole", "z": "f1", "name": "", "wires": [] },
+                { "id": "b2", "type": "blackhole", "z": "f1", "name": "", "wires": [] }
+            ]
+        )")
+                                .as_array();
+
+        auto flows = flow_factory.create_flows(flows_config, &engine);
+        auto flow = static_cast<flows::Flow*>(flows[0].get());
+        auto const& table = flow->routing_table();
+        auto j1 = flow->get_node("j1");
+        auto j2 = flow->get_node("j2");
+
+        REQUIRE(table.destinations(table.ports_of(j1)[0])[0].sync);
+        REQUIRE(table.sync_source_of(j2) == j1);
+        REQUIRE(table.sync_source_of(j1) == nullptr);
+        // j2 的端口连了两个节点，不是独占的
+        REQUIRE(table.sync_source_of(flow->get_node("b1")) == nullptr);
+
+        boost::asio::io_context io;
+        flow->bind_executor(io.get_executor());
+        REQUIRE(j2->executor() == j1->executor());
+        REQUIRE(flow->get_node("b1")->executor() != j1->executor());
+    }
+
+    SECTION("Sync chains are cut at the maximum length") {
+        JsonArray flows_config;
+        flows_config.emplace_back(JsonObject{
+            {"id", "f1"}, {"type", "tab"}, {"label", "Flow 1"}, {"disabled", false}, {"syncDelivery", true}});
+        constexpr size_t CHAIN_LENGTH = flows::RoutingTable::MAX_SYNC_CHAIN_LENGTH + 4;
+        for (size_t i = 0; i < CHAIN_LENGTH; i++) {
+            auto wires = i + 1 < CHAIN_LENGTH ? JsonArray{JsonArray{JsonValue(fmt::format("j{0}", i + 1))}}
+                                              : JsonArray{JsonArray{}};
+            flows_config.emplace_back(JsonObject{
+                {"id", fmt::format("j{0}", i)}, {"type", "junction"}, {"z", "f1"}, {"name", ""}, {"wires", wires}});
+        }
+
+        auto flows = flow_factory.create_flows(flows_config, &engine);
+        auto const& table = static_cast<flows::Flow*>(flows[0].get())->routing_table();
+        auto const cut = flows::RoutingTable::MAX_SYNC_CHAIN_LENGTH;
+        REQUIRE(table.sync_source_of(flows[0]->get_node(fmt::format("j{0}", cut - 1))) != nullptr);
+        REQUIRE(table.sync_source_of(flows[0]->get_node(fmt::format("j{0}", cut))) == nullptr);
+        REQUIRE(table.sync_source_of(flows[0]->get_node(fmt::format("j{0}", cut + 1))) != nullptr);
+    }
+
+    SECTION("Flows without sync delivery have no sync routes") {
+        auto flows_config = boost::json::parse(R"(
+            [
+                { "id": "f1", "type": "tab", "label": "Flow 1", "disabled": false },
+                { "id": "j1", "type": "junction", "z": "f1", "name": "", "wires": [["b1"]] },
+                { "id": "b1", "type": "blackhole", "z": "f1", "name": "", "wires": [] }
+            ]
+        )")
+                                .as_array();
+
+        auto flows = flow_factory.create_flows(flows_config, &engine);
+        auto const& table = static_cast<flows::Flow*>(flows[0].get())->routing_table();
+        REQUIRE_FALSE(table.destinations(table.ports_of(flows[0]->get_node("j1"))[0])[0].sync);
+        REQUIRE(table.sync_source_of(flows[0]->get_node("b1")) == nullptr);
+    }
+
+    SECTION("Nodes are looked up by id through the flow index") {
+        auto flows_config = boost::json::parse(R"(
+            [
+                { "id": "f1", "type": "tab", "label": "Flow 1", "disabled": false },
+                { "id": "j1", "type": "junction", "z": "f1", "name": "", "wires": [["b1"]] },
+                { "id": "b1", "type": "blackhole", "z": "f1", "name": "", "wires": [] }
+            ]
+        )")
+                                .as_array();
+
+        auto flows = flow_factory.create_flows(flows_config, &engine);
+        auto b1 = flows[0]->get_node("b1");
+        REQUIRE(b1->id() == "b1");
+        REQUIRE(flows[0]->get_node("j1")->output_ports()[0].wires()[0] == b1);
+        REQUIRE_THROWS(flows[0]->get_node("missing"));
+    }
+
+    SECTION("Wires that close a loop are marked as back edges") {
+        auto flows_config = boost::json::parse(R"(
+            [
+                { "id": "f1", "type": "tab", "label": "Flow 1", "disabled": false },
+                { "id": "j1", "type": "junction", "z": "f1", "name": "", "wires": [["j1", "j2"]] },
+                { "id": "j2", "type": "junction", "z": "f1", "name": "", "wires": [["j3"]] },
+                { "id": "j3", "type": "junction", "z": "f1", "name": "", "wires": [["j2", "b1"]] },
+                { "id": "b1", "type": "blackhole", "z": "f1", "name": "", "wires": [] }
+            ]
+        )")
+                                .as_array();
+
+        auto flows = flow_factory.create_flows(flows_config, &engine);
+        auto flow = static_cast<flows::Flow*>(flows[0].get());
+        auto const& table = flow->routing_table();
+
+        // 自环
+        auto j1_routes = table.destinations(table.ports_of(flow->get_node("j1"))[0]);
+        REQUIRE(j1_routes[0].node == flow->get_node("j1"));
+        REQUIRE(j1_routes[0].back_edge);
+        REQUIRE_FALSE(j1_routes[1].back_edge);
+
+        // j2 -> j3 -> j2 的环只有指回 j2 的那条连线是回边
+        REQUIRE_FALSE(table.destinations(table.ports_of(flow->get_node("j2"))[0])[0].back_edge);
+        auto j3_routes = table.destinations(table.ports_of(flow->get_node("j3"))[0]);
+        REQUIRE(j3_routes[0].node == flow->get_node("j2"));
+        REQUIRE(j3_routes[0].back_edge);
+        REQUIRE_FALSE(j3_routes[1].back_edge);
+    }
+
+    SECTION("Wires into source nodes are rejected when the flow is built") {
+        auto flows_config = boost::json::parse(R"(
+            [
+                { "id": "f1", "type": "tab", "label": "Flow 1", "disabled": false },
+                { "id": "j1", "type": "junction", "z": "f1", "name": "", "wires": [["i1"]] },
+                { "id": "i1", "type": "inject", "z": "f1", "name": "", "props": [], "once": false, "wires": [[]] }
+            ]
+        )")
+                                .as_array();
+
+        REQUIRE_THROWS_AS(flow_factory.create_flows(flows_config, &engine), BadFlowConfigException);
+    }
+}
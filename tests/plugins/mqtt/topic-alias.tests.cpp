@@ -0,0 +1,80 @@
+#include <edgelink/edgelink.hpp>
+
+#include "../../../plugins/mqtt/src/topic-alias.hpp"
+
+using namespace edgelink;
+using namespace edgelink::plugins::mqtt;
+
+TEST_CASE("Test MQTT topic alias allocator") {
+    TopicAliasAllocator aliases(2);
+
+    SECTION("No aliases are used before the broker allows them") {
+        for (int i = 0; i < 10; i++) {
+            REQUIRE(aliases.assign("/yncic-dangerous/data/test1").alias == 0);
+        }
+    }
+
+    aliases.reset(10);
+
+    SECTION("A repeated topic is registered once and then sent by alias") {
+        REQUIRE(aliases.assign("/yncic-dangerous/data/test1").alias == 0);
+
+        auto first = aliases.assign("/yncic-dangerous/data/test1");
+        REQUIRE(first.alias == 1);
+        REQUIRE_FALSE(first.registered);
+
+        auto second = aliases.assign("/yncic-dangerous/data/test1");
+        REQUIRE(second.alias == 1);
+        REQUIRE(second.registered);
+    }
+
+    SECTION("Topics too short to benefit never get an alias") {
+        for (int i = 0; i < 10; i++) {
+            REQUIRE(aliases.assign("a/b").alias == 0);
+        }
+    }
+
+    SECTION("The local limit caps the number of aliases") {
+        for (auto topic : {"sensors/one", "sensors/two", "sensors/three"}) {
+            aliases.assign(topic);
+            aliases.assign(topic);
+        }
+        REQUIRE(aliases.size() == 2);
+        REQUIRE(aliases.assign("sensors/one").registered);
+        REQUIRE(aliases.assign("sensors/two").registered);
+        REQUIRE(aliases.assign("sensors/three").alias == 0);
+    }
+
+    SECTION("A much more frequent topic takes over the least valuable alias") {
+        for (auto topic : {"sensors/one", "sensors/two"}) {
+            aliases.assign(topic);
+            aliases.assign(topic);
+        }
+        for (int i = 0; i < 3; i++) {
+            aliases.assign("sensors/two");
+        }
+
+        TopicAliasAllocator::Assignment hot;
+        for (int i = 0; i < 5 && hot.alias == 0; i++) {
+            hot = aliases.assign("sensors/hot");
+        }
+        REQUIRE(hot.alias == 1);
+        REQUIRE_FALSE(hot.registered);
+        REQUIRE(aliases.assign("sensors/two").registered);
+
+        // 被抢走别名的主题重新开始登记
+        auto one = aliases.assign("sensors/one");
+        REQUIRE_FALSE(one.registered);
+    }
+
+    SECTION("Aliases are forgotten on reconnect but the counts are kept") {
+        aliases.assign("sensors/one");
+        REQUIRE(aliases.assign("sensors/one").alias == 1);
+
+        aliases.reset(10);
+        REQUIRE(aliases.size() == 0);
+        auto again = aliases.assign("sensors/one");
+        REQUIRE(again.alias == 1);
+        REQUIRE_FALSE(again.registered);
+    }
+}
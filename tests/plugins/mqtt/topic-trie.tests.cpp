@@ -0,0 +1,82 @@
+#include <edgelink/edgelink.hpp>
+
+#include "../../../plugins/mqtt/src/topic-trie.hpp"
+
+using namespace edgelink;
+using namespace edgelink::plugins::mqtt;
+
+namespace {
+
+std::vector<int> matches(const TopicTrie<int>& trie, const std::string_view topic) {
+    std::vector<int> result;
+    trie.match(topic, [&](int v) { result.push_back(v); });
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+}; // namespace
+
+TEST_CASE("Test MQTT topic trie") {
+    TopicTrie<int> trie;
+
+    SECTION("Exact filters only match the same topic") {
+        trie.insert("a/b/c", 1);
+        trie.insert("a/b", 2);
+        REQUIRE(matches(trie, "a/b/c") == std::vector<int>{1});
+        REQUIRE(matches(trie, "a/b") == std::vector<int>{2});
+        REQUIRE(matches(trie, "a/b/c/d").empty());
+        REQUIRE(matches(trie, "a").empty());
+    }
+
+    SECTION("Single level wildcard matches exactly one level") {
+        trie.insert("a/+/c", 1);
+        trie.insert("+/+", 2);
+        REQUIRE(matches(trie, "a/b/c") == std::vector<int>{1});
+        REQUIRE(matches(trie, "a/x") == std::vector<int>{2});
+        REQUIRE(matches(trie, "a//c") == std::vector<int>{1});
+        REQUIRE(matches(trie, "a/b/c/d").empty());
+    }
+
+    SECTION("Multi level wildcard matches the parent and everything below") {
+        trie.insert("a/#", 1);
+        trie.insert("#", 2);
+        trie.insert("a/+/#", 3);
+        REQUIRE(matches(trie, "a") == std::vector<int>{1, 2});
+        REQUIRE(matches(trie, "a/b") == std::vector<int>{1, 2, 3});
+        REQUIRE(matches(trie, "a/b/c/d") == std::vector<int>{1, 2, 3});
+        REQUIRE(matches(trie, "b") == std::vector<int>{2});
+    }
+
+    SECTION("Topics starting with '$' are not matched by leading wildcards") {
+        trie.insert("#", 1);
+        trie.insert("+/info", 2);
+        trie.insert("$SYS/#", 3);
+        REQUIRE(matches(trie, "$SYS/info") == std::vector<int>{3});
+        REQUIRE(matches(trie, "x/info") == std::vector<int>{1, 2});
+    }
+
+    SECTION("Multiple subscribers can share a filter and be removed one by one") {
+        trie.insert("a/+", 1);
+        trie.insert("a/+", 2);
+        REQUIRE(trie.size() == 2);
+        REQUIRE(matches(trie, "a/b") == std::vector<int>{1, 2});
+
+        REQUIRE(trie.erase("a/+", 1));
+        REQUIRE_FALSE(trie.erase("a/+", 1));
+        REQUIRE(matches(trie, "a/b") == std::vector<int>{2});
+
+        REQUIRE(trie.erase("a/+", 2));
+        REQUIRE(trie.empty());
+        REQUIRE(matches(trie, "a/b").empty());
+    }
+
+    SECTION("Invalid filters are rejected") {
+        REQUIRE(TopicTrie<int>::is_valid_filter("a/+/#"));
+        REQUIRE(TopicTrie<int>::is_valid_filter("/a/"));
+        REQUIRE_FALSE(TopicTrie<int>::is_valid_filter(""));
+        REQUIRE_FALSE(TopicTrie<int>::is_valid_filter("a/#/b"));
+        REQUIRE_FALSE(TopicTrie<int>::is_valid_filter("a/b+"));
+        REQUIRE_FALSE(TopicTrie<int>::is_valid_filter("a#"));
+        REQUIRE_THROWS_AS(trie.insert("a/#/b", 1), InvalidDataException);
+    }
+}
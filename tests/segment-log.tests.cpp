@@ -0,0 +1,117 @@
+#include <edgelink/edgelink.hpp>
+
+using namespace edgelink;
+
+namespace {
+
+bool append_text(SegmentLog& log, const std::string_view text) {
+    auto bytes = std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+    return log.append(std::span<const std::span<const uint8_t>>(&bytes, 1));
+}
+
+std::string record_text(std::span<const uint8_t> record) {
+    return std::string(reinterpret_cast<const char*>(record.data()), record.size());
+}
+
+}; // namespace
+
+TEST_CASE("Test segment log") {
+    auto const dir = std::filesystem::temp_directory_path() / "edgelink-segment-log-tests";
+    std::filesystem::remove_all(dir);
+
+    SegmentLogOptions options{.directory = dir, .segment_bytes = 256, .max_bytes = 1024, .fsync = FsyncPolicy::NEVER};
+
+    SECTION("Records are read back in order and consumed") {
+        SegmentLog log(options);
+        REQUIRE(log.empty());
+        REQUIRE(append_text(log, "one"));
+        REQUIRE(append_text(log, "two"));
+        REQUIRE(append_text(log, "three"));
+        REQUIRE(log.size() == 3);
+
+        auto batch = log.peek(2);
+        REQUIRE(batch.first_seq == 0);
+        REQUIRE(batch.records.size() == 2);
+        REQUIRE(record_text(batch.records[0]) == "one");
+        REQUIRE(record_text(batch.records[1]) == "two");
+
+        log.consume(batch.first_seq + batch.records.size());
+        REQUIRE(log.size() == 1);
+        batch = log.peek(16);
+        REQUIRE(batch.first_seq == 2);
+        REQUIRE(batch.records.size() == 1);
+        REQUIRE(record_text(batch.records[0]) == "three");
+    }
+
+    SECTION("Parts are joined into one record and oversized records are rejected") {
+        SegmentLog log(options);
+        const std::array<uint8_t, 2> head{'a', 'b'};
+        const std::array<uint8_t, 3> tail{'c', 'd', 'e'};
+        const std::array<std::span<const uint8_t>, 2> parts{head, tail};
+        REQUIRE(log.append(parts));
+        REQUIRE(record_text(log.peek(1).records[0]) == "abcde");
+
+        REQUIRE_FALSE(append_text(log, std::string(300, 'x')));
+        REQUIRE_FALSE(append_text(log, ""));
+        REQUIRE(log.size() == 1);
+    }
+
+    SECTION("Records and the read cursor survive a reopen") {
+        {
+            SegmentLog log(options);
+            for (int i = 0; i < 20; i++) {
+                REQUIRE(append_text(log, fmt::format("record-{0:02}", i)));
+            }
+            log.consume(5);
+        }
+        SegmentLog log(options);
+        REQUIRE(log.size() == 15);
+        auto batch = log.peek(100);
+        REQUIRE(batch.first_seq == 5);
+        REQUIRE(batch.records.size() == 15);
+        REQUIRE(record_text(batch.records.front()) == "record-05");
+        REQUIRE(record_text(batch.records.back()) == "record-19");
+
+        REQUIRE(append_text(log, "after-reopen"));
+        REQUIRE(record_text(log.peek(100).records.back()) == "after-reopen");
+    }
+
+    SECTION("The oldest segments are dropped when the size cap is reached") {
+        SegmentLog log(options);
+        for (int i = 0; i < 200; i++) {
+            REQUIRE(append_text(log, fmt::format("record-{0:03}", i)));
+        }
+        REQUIRE(log.bytes() <= options.max_bytes);
+        REQUIRE(log.dropped() > 0);
+        REQUIRE(log.size() + log.dropped() == 200);
+
+        auto batch = log.peek(1000);
+        REQUIRE(batch.first_seq == log.dropped());
+        REQUIRE(record_text(batch.records.back()) == "record-199");
+    }
+
+    SECTION("A torn record at the tail is discarded on recovery") {
+        {
+            SegmentLog log(options);
+            REQUIRE(append_text(log, "complete"));
+            REQUIRE(append_text(log, "torn"));
+        }
+        // 破坏最后一条记录的正文，模拟写到一半时掉电
+        auto const segment = dir / fmt::format("{0:020}.seg", 1);
+        {
+            std::fstream file(segment, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekp(16 + 8 + 8 + 8);
+            file.put('X');
+        }
+        SegmentLog log(options);
+        REQUIRE(log.size() == 1);
+        REQUIRE(record_text(log.peek(16).records[0]) == "complete");
+
+        REQUIRE(append_text(log, "next"));
+        auto batch = log.peek(16);
+        REQUIRE(batch.records.size() == 2);
+        REQUIRE(record_text(batch.records[1]) == "next");
+    }
+
+    std::filesystem::remove_all(dir);
+}